@@ -12,8 +12,13 @@ The data structures are completely interchangeable if you use the macros. See ex
 DOCUMENTATION
 
 	ANR_DS_ADD
-		array, linked list: append to end of ds.
+		array, linked list, unrolled list, sequence, gap buffer, deque: append to end of ds.
+		mpmc queue: append to end of ds, fails when the queue is full.
 		hashmap: insert at any open slot.
+		hashtable: insert by key, replaces existing entry with the same key. Returned index is 
+			only valid until the next add, the table might rehash.
+		sorted array: insert after entries that compare equal. anr_sorted_array_merge_sorted adds 
+			a sorted batch in one pass.
 
 	ANR_DS_PRINT
 		print entries. define ANR_DATA_DEBUG to see diff with previous print.
@@ -23,26 +28,146 @@ DOCUMENTATION
 
 	ANR_DS_FIND_BY
 		Returns index of first match of data.
+		hashtable: only the key is compared, ptr only needs to point to the key.
+		sorted array: binary search with the comparator, returns the first equal entry. Created with 
+			eytzinger set it searches a breadth first copy instead. The copy is rebuilt once length/16 
+			lookups ran since the last change, until then and when it can not be allocated lookups use 
+			binary search. It only pays off in optimised builds with tables far past the last level cache 
+			(1.6-2x faster with 10M and 64M ints at -O2), 1M ints and -O0 builds are faster without it.
 
 	ANR_DS_REMOVE_BY
 		Remove entry given the data ptr. Data ptr is assumed to exist in ds.
+		unrolled list, sequence, gap buffer, deque: entries move on insert/remove, data ptrs are only valid until the next change.
 
 	ANR_DS_REMOVE_AT
 		Remove data at index.
 
 	ANR_DS_INSERT
-		array, linked list: Insert at index and move up existing data. Index needs to be <= ds.length
+		array, linked list, unrolled list, sequence: Insert at index and move up existing data. Index needs to be <= ds.length
+		sequence: insert, remove_at and find_at are O(log n), it is a B+tree counting entries per subtree.
+		gap buffer: same as array, but only entries between the previous and current edit move.
+		deque: same as array, but moves the shorter side. Index 0 and ds.length are O(1).
 		hashmap: Insert data at index, replaces existing data. Index needs to be >= 0 and < UINT32_MAX
+		hashtable, sorted array: Index is ignored, same as ANR_DS_ADD.
+
+	ANR_DS_ADD_RANGE, ANR_DS_INSERT_RANGE, ANR_DS_REMOVE_RANGE
+		Bulk add, insert and remove_at for count consecutive entries. data holds count entries.
+		array: one realloc and one memmove per call.
+		linked list: new nodes are linked in, or removed nodes unlinked, as one chain.
+		hashmap: add_range fills free slots a mask word at a time. insert_range and remove_range work on 
+			indices, missing entries in the range are skipped. On fail entries added so far stay.
+		hashtable, concurrent hashtable: remove_range removes the entries in the index range.
+		sorted array: add_range sorts a copy of data and merges it in one pass, insert_range ignores index.
+		other containers: one add, insert or remove_at call per entry.
+
+	ANR_DS_REMOVE_IF
+		Remove every entry the predicate returns non zero for, returns the number removed. 
+		array and sorted array compact in a single pass.
 
 	ANR_DS_LENGTH
 		Return number of entries in ds.
 
+	SORTING
+		anr_array_sort sorts an array in place with a qsort comparator.
+		anr_array_sort_by_key is a stable LSD radix sort on a 32 or 64 bit integer or float key at 
+		key_offset inside every entry. It makes one pass per key byte through one scratch buffer of 
+		the same size, bytes that are equal for all keys are skipped. Floats sort as numbers, NaN is not handled.
+		anr_array_parallel_sort (ANR_DATA_THREADS) sorts one run per thread, then merges pairs of runs 
+		with every merge split over the threads.
+
 	ANR_ITERATE
 		Iterate over ds, given anr_iter .index and .data entries are filled.
+
+	DISPATCH
+		With C11 the macros call the container functions directly when given a typed pointer 
+		(anr_array*, anr_hashmap*, ...), anr_ds* and void* go through the _ds_arr table.
+		Define ANR_DATA_NO_GENERIC to always use the table.
+		ANR_DS_DECLARE(type, name) emits static inline typed functions for anr_array, 
+		iterate them with ANR_DS_FOREACH(type, it, &arr).
 	
 	ANR_DS_FREE
 		Free memory, dont use ds after this.
 
+	MPMC QUEUE
+		anr_mpmc_queue is a bounded ring that producer and consumer threads can share through 
+		anr_mpmc_queue_try_push and anr_mpmc_queue_try_pop, no locks are taken. The ANR_DS_* macros 
+		are for single threaded use, insert and remove_at in the middle move entries like an array.
+
+	CONCURRENT HASHTABLE
+		anr_concurrent_hashtable splits the keys over shards, each an anr_hashtable with its own 
+		spinlock and seqlock. anr_concurrent_hashtable_get takes no lock: it reads the shard and retries 
+		if a writer changed it meanwhile. put, erase, add and remove_at lock one shard, a shard grows on 
+		its own. Blocks freed by a rehash are kept until anr_concurrent_hashtable_reclaim or free, since 
+		a reader might still be probing them. The other ANR_DS_* functions are for single threaded use.
+
+	PARALLEL
+		Define ANR_DATA_THREADS (and link with -pthread on POSIX) for anr_ds_parallel_for and 
+		anr_ds_parallel_reduce. They call fn for every entry from thread_count threads, the calling thread 
+		included. Arrays are split by index, hashmaps by bucket, other containers at iterator positions 
+		found in one walk. Chunks go to the threads up front, a thread that runs out takes chunks from 
+		the others. The threads are started by the first call and wait for the next one.
+		reduce: result holds the identity on entry, every chunk folds into its own copy of it, the 
+		copies are combined into result in chunk order.
+		fn must not add or remove entries, changing the data in place is fine.
+
+	SLOT MAP
+		anr_slot_map hands out 64 bit handles: slot number and generation. Entries are packed in one 
+		array for iteration, slots point into it, so add, remove and handle lookup are O(1). Removing an 
+		entry bumps the generation of its slot, old handles then get NULL from anr_slot_map_get instead 
+		of whatever reuses the slot. A slot that used up its generations is never reused.
+		The ANR_DS_* index is the position in the packed array, remove_at moves the last entry into the hole.
+
+	INTRUSIVE LIST
+		anr_list threads objects the caller already owns: embed an anr_list_link in the struct, link it 
+		with anr_list_push_back/insert_after/..., get the struct back with ANR_CONTAINER_OF(link, type, member). 
+		Nothing is allocated or copied, unlink and splice are O(1). An object can be on several lists 
+		through several links. anr_list has no ds table, use ANR_LIST_ITERATE instead of ANR_ITERATE. 
+		A zeroed anr_list is empty, unlink sets prev and next of the link to NULL.
+
+	BLOOM FILTER
+		anr_bloom_filter answers "never added" or "probably added" for a key. Sized from the expected 
+		number of keys and the false positive rate, more keys than expected raise the rate. Every key 
+		sets its bits in one 512 bit block, a lookup loads one cache line and tests it with SSE2/AVX2. 
+		The counting variant keeps a counter per bit so keys can be removed, at 8 times the memory.
+		anr_filtered puts a filter in front of any container: ANR_DS_FIND_BY only searches the container 
+		when the filter might hold the key, the other ANR_DS_* functions go to the container and keep the 
+		filter up to date. key_size is data_size for arrays and lists, the key size for hashtables. 
+		Without counting removed keys stay in the filter, anr_filtered_rebuild clears them.
+
+	SMALL ARRAY
+		ANR_DS_SMALL_ARRAY(type, count, name) declares an array struct with room for count entries inside 
+		it, anr_array_init_small does the same for any buffer. Adds up to that count never allocate, 
+		longer arrays move to the heap and move back once they shrink to fit again. name.arr is a regular 
+		anr_array for the ANR_DS_* macros, ANR_ITERATE and the table. Initialise in place and dont copy 
+		the struct afterwards, the array points into it.
+
+	FILE BACKED ARRAY
+		Define ANR_DATA_MMAP for file backed arrays and snapshots, they need the OS file mapping headers.
+		Outside of Windows they also need ftruncate and msync, with -std=c99 or -std=c11 define 
+		_POSIX_C_SOURCE 200809L (or _XOPEN_SOURCE 700, or _GNU_SOURCE) before the first #include.
+		anr_array_create_file keeps the entries in a sparse file mapped shared into memory, so the array 
+		can be larger than RAM and the OS pages it in and out. It is a regular anr_array, every ANR_DS_* 
+		macro and ANR_ITERATE work on it. Growing extends the file and remaps it (mremap when 
+		_GNU_SOURCE is defined on Linux). Windows can not cut a mapped file, it keeps its largest size 
+		while open. The hint is passed to madvise, anr_array_advise changes it.
+		anr_array_sync stores the length and flushes the entries, opening the same path with the same 
+		data_size later continues from the last sync. Without a sync the entries reach the file, but a 
+		reopen only sees the length of the last sync.
+
+	SNAPSHOTS
+		anr_ds_save writes an anr_array or anr_hashmap to a file that can be mapped back without 
+		re-adding anything: a versioned header, the entries, and for a hashmap the bucket list and 
+		every bucket block (occupancy masks and data) at file offsets. anr_ds_open_mapped maps the file 
+		copy on write and fills in the ds in mapped->ds (.array or .hashmap), only the bucket list and 
+		directory of a hashmap are rebuilt. Reads come straight from the page cache, writes copy the 
+		touched pages and never reach the file. The file is in the byte order of the machine that wrote it.
+
+	ALLOCATORS
+		All containers take an optional anr_allocator* through their _create_ex function, 
+		NULL uses malloc/realloc/free. The allocator has to outlive the ds.
+		anr_arena is a bump allocator: free only releases the last allocation and realloc 
+		grows the last allocation in place, everything else is released by anr_arena_reset/anr_arena_free.
+
 LICENSE
 	See end of file for license information.
 
@@ -66,11 +191,42 @@ LICENSE
 #define ANRDATA_ASSERT(x) assert(x)
 #endif
 
+#ifndef ANR_ALLOCATOR_DEFINED
+#define ANR_ALLOCATOR_DEFINED
+// Shared by anr_data.h, anr_pdf.h and anr_sc.h. A NULL allocator means malloc/realloc/free.
+typedef struct
+{
+	void* (*alloc)(void* ctx, size_t size);
+	void* (*realloc)(void* ctx, void* ptr, size_t old_size, size_t new_size);
+	void  (*free)(void* ctx, void* ptr);
+	void* ctx;
+} anr_allocator;
+#endif
+
+typedef struct
+{
+	uint8_t* block; // Current block, starts with a pointer to the previous block.
+	size_t block_size; // Size of the current block.
+	size_t used; // Bytes used in the current block.
+	size_t min_block_size;
+	void* last; // Last allocation, can be grown or released in place.
+} anr_arena;
+
 typedef enum
 {
 	ANR_DS_LINKEDLIST = 0,
 	ANR_DS_DYNAMIC_ARRAY = 1,
 	ANR_DS_HASHMAP = 2,
+	ANR_DS_HASHTABLE = 3,
+	ANR_DS_UNROLLED_LIST = 4,
+	ANR_DS_SEQUENCE = 5,
+	ANR_DS_GAP_BUFFER = 6,
+	ANR_DS_DEQUE = 7,
+	ANR_DS_SORTED_ARRAY = 8,
+	ANR_DS_MPMC_QUEUE = 9,
+	ANR_DS_CONCURRENT_HASHTABLE = 10,
+	ANR_DS_FILTERED = 11,
+	ANR_DS_SLOT_MAP = 12,
 } anr_ds_type;
 
 typedef struct
@@ -80,6 +236,10 @@ typedef struct
 	void* data;
 } anr_linked_list_node;
 
+#ifndef ANR_LINKED_LIST_SLAB_SIZE
+#define ANR_LINKED_LIST_SLAB_SIZE 16384 // Bytes per node slab.
+#endif
+
 typedef struct
 {
 	anr_ds_type ds_type;
@@ -87,43 +247,328 @@ typedef struct
 	anr_linked_list_node* last;
 	uint32_t length;
 	uint32_t data_size;
+	anr_allocator* allocator;
 
 	struct // Cache last accessed node.
 	{
 		anr_linked_list_node* node;
 		uint32_t index;
 	} last_access;
+
+	struct // Nodes are carved from slabs and recycled, slabs are released in anr_linked_list_free.
+	{
+		void* slabs; // First pointer of each slab links to the next slab.
+		anr_linked_list_node* free_nodes; // Linked through node->next.
+	} pool;
 	
 } anr_linked_list;
 
+#ifndef ANR_UNROLLED_LIST_NODE_SIZE
+#define ANR_UNROLLED_LIST_NODE_SIZE 256 // Bytes of entries per node, multiple of the cache line size.
+#endif
+
+typedef struct
+{
+	void* prev;
+	void* next;
+	uint32_t length;
+	uint32_t pad[3]; // Keeps entries 16 byte aligned like malloc.
+} anr_unrolled_list_node; // Followed by node_capacity entries.
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	anr_unrolled_list_node* first;
+	anr_unrolled_list_node* last;
+	uint32_t length;
+	uint32_t data_size;
+	uint32_t node_capacity; // Entries per node.
+	anr_allocator* allocator;
+
+	struct // Cache last accessed node.
+	{
+		anr_unrolled_list_node* node;
+		uint32_t start; // Index of first entry in node.
+	} last_access;
+} anr_unrolled_list;
+
+#ifndef ANR_SEQUENCE_LEAF_SIZE
+#define ANR_SEQUENCE_LEAF_SIZE 512 // Bytes of entries per leaf, multiple of the cache line size.
+#endif
+#define ANR_SEQUENCE_FANOUT 32 // Children per inner node.
+
+typedef struct
+{
+	void* prev;
+	void* next;
+	uint32_t length;
+	uint32_t pad[3]; // Keeps entries 16 byte aligned like malloc.
+} anr_sequence_leaf; // Followed by leaf_capacity entries.
+
+typedef struct
+{
+	uint32_t length; // Number of children.
+	uint32_t counts[ANR_SEQUENCE_FANOUT]; // Entries below each child.
+	void* children[ANR_SEQUENCE_FANOUT]; // Leaves on the lowest level, inner nodes above.
+} anr_sequence_inner;
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	void* root; // Leaf when height is 0.
+	anr_sequence_leaf* first; // Leaves are linked in order for iteration.
+	uint32_t height; // Number of inner levels.
+	uint32_t length;
+	uint32_t data_size;
+	uint32_t leaf_capacity; // Entries per leaf.
+	anr_allocator* allocator;
+
+	struct // Cache leaf found by the last find_at.
+	{
+		anr_sequence_leaf* leaf;
+		uint32_t start; // Index of first entry in leaf.
+	} last_access;
+} anr_sequence;
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	void* data; // Entries before gap_start, gap, entries from gap_end to capacity.
+	uint32_t data_size;
+	uint32_t capacity;
+	uint32_t gap_start; // Index of the last edit, inserts here dont move anything.
+	uint32_t gap_end;
+	anr_allocator* allocator;
+} anr_gap_buffer;
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	void* data;
+	uint32_t data_size;
+	uint32_t capacity; // Power of two.
+	uint32_t head; // Slot of index 0.
+	uint32_t length;
+	anr_allocator* allocator;
+} anr_deque;
+
+#ifndef ANR_DATA_CACHE_LINE
+#define ANR_DATA_CACHE_LINE 64
+#endif
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	uint8_t* cells; // Each cell is a uint64_t sequence number followed by the entry.
+	uint32_t data_size;
+	uint32_t cell_size;
+	uint32_t capacity; // Power of two, the queue does not grow.
+	anr_allocator* allocator;
+
+	// Producers and consumers each get their own cache line.
+	uint8_t pad0[ANR_DATA_CACHE_LINE];
+	uint64_t enqueue_pos;
+	uint8_t pad1[ANR_DATA_CACHE_LINE - sizeof(uint64_t)];
+	uint64_t dequeue_pos;
+	uint8_t pad2[ANR_DATA_CACHE_LINE - sizeof(uint64_t)];
+} anr_mpmc_queue;
+
+typedef struct
+{
+	float growth_factor; // Capacity is multiplied by this when full, grows by at least reserve_size.
+	float shrink_threshold; // Capacity is halved when length drops below reserved * shrink_threshold. Below 0.5, 0 to never shrink.
+} anr_array_policy;
+
+#define ANR_ARRAY_POLICY_DEFAULT (anr_array_policy){2.0f, 0.25f}
+
+typedef enum
+{
+	ANR_ACCESS_NORMAL,
+	ANR_ACCESS_SEQUENTIAL, // Read ahead aggressively, drop pages behind.
+	ANR_ACCESS_RANDOM, // No read ahead.
+} anr_access_hint;
+
 typedef struct
 {
 	anr_ds_type ds_type;
 	void* data;
 	int32_t data_size;
-	int32_t reserve_size;
+	int32_t reserve_size; // Minimum capacity and minimum growth step.
 	int32_t reserved;
 	int32_t length;
+	anr_array_policy policy;
+	anr_allocator* allocator;
 } anr_array;
 
+// Allocator of an array with inline storage: hands out storage while the entries fit, the parent allocator after.
+typedef struct
+{
+	anr_allocator allocator;
+	anr_allocator* parent;
+	void* storage;
+	size_t storage_size;
+} anr_small_storage;
+
 typedef struct
 {
 	uint32_t bucket_start;
 	uint32_t length;
+	uint32_t open_position; // Position in open_buckets + 1, 0 if bucket is full.
+	uint64_t* occupied; // One bit per slot, followed by one bit per full mask word. Allocation owner.
 	void* data;
 } anr_hashmap_bucket;
 
+#define ANR_HASHMAP_DIRECTORY_PAGE_BITS 10
+#define ANR_HASHMAP_DIRECTORY_PAGE_SIZE (1 << ANR_HASHMAP_DIRECTORY_PAGE_BITS)
+#define ANR__HASHMAP_RELEASED 0x80000000u // Directory entry flag, bucket positions stay below it.
+
 typedef struct
 {
 	anr_ds_type ds_type;
 	uint32_t bucket_size;
-	anr_array buckets;
+	anr_array buckets; // Unordered list of anr_hashmap_bucket.
+	uint32_t** directory; // Pages of bucket positions + 1, indexed by index / bucket_size. 0 if bucket does not exist, ANR__HASHMAP_RELEASED | position in free_buckets if released.
+	uint32_t directory_length; // Number of pages.
+	anr_array open_buckets; // Numbers of buckets with at least one free slot.
+	anr_array free_buckets; // Numbers of released buckets that do not exist, reused before next_bucket.
+	uint32_t next_bucket; // One past the highest bucket number ever used.
 	uint32_t data_size;
 	uint32_t length;
-	int32_t last_emptied; // Index known to be empty. -1 if none.
-	int32_t next_empty; // Next empty index to append. -1 of none.
+	anr_allocator* allocator;
 } anr_hashmap;
 
+typedef int (*anr_compare_func)(const void* a, const void* b); // qsort style, < 0, 0 or > 0.
+
+typedef enum
+{
+	ANR_KEY_U32,
+	ANR_KEY_I32,
+	ANR_KEY_F32,
+	ANR_KEY_U64,
+	ANR_KEY_I64,
+	ANR_KEY_F64,
+} anr_key_type;
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	anr_array items; // Kept sorted by compare.
+	anr_compare_func compare;
+
+	struct // Optional copy in Eytzinger (breadth first) order, rebuilt by find_by after a change.
+	{
+		uint8_t enabled;
+		uint8_t dirty;
+		uint32_t lookups; // find_by calls while dirty, the rebuild waits until they pay for it.
+		uint32_t reserved;
+		void* data; // Node k at k, children at 2k and 2k+1, 0 unused.
+		uint32_t* index; // Sorted index of node k.
+	} eytzinger;
+} anr_sorted_array;
+
+#define ANR_HASHTABLE_GROUP_WIDTH 16
+
+typedef uint64_t (*anr_hash_func)(const void* key, uint32_t key_size);
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	int8_t* ctrl; // One control byte per slot: empty, deleted, or the low 7 hash bits of a full slot.
+	void* slots;
+	uint32_t data_size;
+	uint32_t key_size; // Key is the first key_size bytes of each entry.
+	uint32_t capacity; // Power of two, multiple of ANR_HASHTABLE_GROUP_WIDTH.
+	uint32_t length;
+	uint32_t growth_left; // Number of empty slots that can be filled before a rehash.
+	anr_hash_func hash;
+	anr_allocator* allocator;
+} anr_hashtable;
+
+#ifndef ANR_CONCURRENT_HASHTABLE_SHARDS
+#define ANR_CONCURRENT_HASHTABLE_SHARDS 64 // Default number of shards, power of two.
+#endif
+
+typedef struct
+{
+	uint64_t lock; // Writers spin on this.
+	uint64_t sequence; // Seqlock, odd while a writer changes the shard. Readers retry when it moved.
+	anr_hashtable table;
+	anr_allocator allocator; // Hands allocations to the parent allocator, keeps freed blocks in retired.
+	anr_allocator* parent;
+	anr_array retired; // Blocks freed by a rehash, readers that started before might still look at them.
+	uint8_t pad[ANR_DATA_CACHE_LINE]; // Keeps the lock and table of the next shard off these cache lines.
+} anr_concurrent_hashtable_shard;
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	anr_concurrent_hashtable_shard* shards; // Picked by the top bits of the hash.
+	uint32_t shard_count; // Power of two.
+	uint32_t shard_bits;
+	uint32_t data_size;
+	uint32_t key_size;
+	anr_hash_func hash;
+	anr_allocator* allocator;
+} anr_concurrent_hashtable;
+
+#define ANR_BLOOM_BLOCK_WORDS 8 // 512 bit blocks, one cache line.
+
+typedef struct
+{
+	uint64_t* bits; // block_count blocks, cache line aligned inside allocation.
+	uint8_t* counts; // Counting variant: one saturating counter per bit, NULL otherwise.
+	void* allocation;
+	uint32_t block_count;
+	uint32_t hash_count; // Bits set per key, all in the same block.
+	uint32_t key_size; // Key is the first key_size bytes of an entry.
+	anr_allocator* allocator;
+} anr_bloom_filter;
+
+// Any container behind a bloom filter, find_by only searches the container if the filter might hold the key.
+typedef struct
+{
+	anr_ds_type ds_type;
+	void* inner; // Freed with the filtered ds.
+	anr_bloom_filter filter;
+} anr_filtered;
+
+typedef uint64_t anr_handle; // Slot in the low 32 bits, generation in the high 32 bits. 0 is never a valid handle.
+
+typedef struct
+{
+	uint32_t generation; // Odd while in use, bumped on add and on remove.
+	uint32_t index; // Dense position while in use, next free slot otherwise.
+} anr_slot_map_slot;
+
+typedef struct
+{
+	anr_ds_type ds_type;
+	void* data; // length entries, packed.
+	uint32_t* dense_slots; // Slot of every dense entry.
+	anr_slot_map_slot* slots;
+	uint32_t data_size;
+	uint32_t length;
+	uint32_t capacity; // Dense entries.
+	uint32_t slot_count;
+	uint32_t slot_capacity;
+	uint32_t free_head; // Most recently freed slot, UINT32_MAX if none.
+	anr_allocator* allocator;
+} anr_slot_map;
+
+// Embedded in the caller's struct, ANR_CONTAINER_OF gets the struct back. A link is on one list at a time.
+typedef struct anr_list_link
+{
+	struct anr_list_link* prev;
+	struct anr_list_link* next;
+} anr_list_link;
+
+typedef struct
+{
+	anr_list_link* first;
+	anr_list_link* last;
+	uint32_t length;
+} anr_list;
+
 typedef struct
 {
 	int32_t index;
@@ -134,6 +579,21 @@ typedef struct
 		{
 			anr_linked_list_node* node;
 		} ll;
+		struct
+		{
+			uint32_t bucket; // Position in hashmap buckets.
+			uint32_t slot; // Next slot in bucket to check.
+		} hm;
+		struct
+		{
+			anr_unrolled_list_node* node;
+			uint32_t slot; // Next slot in node.
+		} ul;
+		struct
+		{
+			anr_sequence_leaf* leaf;
+			uint32_t slot; // Next slot in leaf.
+		} sq;
 	};
 } anr_iter;
 
@@ -142,6 +602,8 @@ typedef union
 	anr_linked_list ds_ll;
 } anr_ds;
 
+typedef int (*anr_predicate_func)(const void* data, void* ctx); // non zero to select the entry.
+
 typedef struct
 {
 	int32_t 	(*add)(void* ds, void* ptr); // returns index on success, -1 on fail
@@ -155,6 +617,10 @@ typedef struct
 	uint32_t 	(*length)(void* ds);
 	anr_iter 	(*iter_start)(void* ds);
 	uint8_t 	(*iter_next)(void* ds, anr_iter* iter); // returns 1 on success, 0 if no more items to iterate
+	uint8_t 	(*add_range)(void* ds, void* data, uint32_t count); // returns 1 on success, 0 on fail
+	uint8_t 	(*insert_range)(void* ds, uint32_t index, void* data, uint32_t count); // returns 1 on success, 0 on fail
+	uint8_t 	(*remove_range)(void* ds, uint32_t index, uint32_t count); // returns 1 on success, 0 on fail
+	uint32_t 	(*remove_if)(void* ds, anr_predicate_func predicate, void* ctx); // returns number of removed entries
 } anr_ds_table;
 
 typedef struct
@@ -165,6 +631,7 @@ typedef struct
 
 // === linked list ===
 ANRDATADEF anr_linked_list 	anr_linked_list_create(uint32_t data_size);
+ANRDATADEF anr_linked_list 	anr_linked_list_create_ex(uint32_t data_size, anr_allocator* allocator);
 ANRDATADEF int32_t	 		anr_linked_list_add(void* ds, void* ptr);
 ANRDATADEF void 			anr_linked_list_free(void* ds);
 ANRDATADEF void 			anr_linked_list_print(void* ds);
@@ -176,9 +643,16 @@ ANRDATADEF uint8_t 			anr_linked_list_insert(void* ds, uint32_t index, void* ptr
 ANRDATADEF uint32_t 		anr_linked_list_length(void* ds);
 ANRDATADEF anr_iter 		anr_linked_list_iter_start(void* ds);
 ANRDATADEF uint8_t 			anr_linked_list_iter_next(void* ds, anr_iter* iter);
+ANRDATADEF uint8_t 			anr_linked_list_add_range(void* ds, void* data, uint32_t count);
+ANRDATADEF uint8_t 			anr_linked_list_insert_range(void* ds, uint32_t index, void* data, uint32_t count);
+ANRDATADEF uint8_t 			anr_linked_list_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 		anr_linked_list_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
 
 // === dynamic array ===
 ANRDATADEF anr_array 	anr_array_create(uint32_t data_size, uint32_t reserve_count);
+ANRDATADEF anr_array 	anr_array_create_ex(uint32_t data_size, uint32_t reserve_count, anr_array_policy policy, anr_allocator* allocator);
+ANRDATADEF uint8_t 		anr_array_reserve(void* ds, uint32_t count); // Grow capacity to at least count, returns 1 on success, 0 on fail
+ANRDATADEF void 		anr_array_shrink_to_fit(void* ds);
 ANRDATADEF int32_t 		anr_array_add(void* ds, void* ptr);
 ANRDATADEF void 		anr_array_free(void* ds);
 ANRDATADEF void 		anr_array_print(void* ds);
@@ -190,9 +664,22 @@ ANRDATADEF uint8_t 		anr_array_insert(void* ds, uint32_t index, void* ptr);
 ANRDATADEF uint32_t 	anr_array_length(void* ds);
 ANRDATADEF anr_iter 	anr_array_iter_start(void* ds);
 ANRDATADEF uint8_t 		anr_array_iter_next(void* ds, anr_iter* iter);
+ANRDATADEF uint8_t 		anr_array_add_range(void* ds, void* data, uint32_t count);
+ANRDATADEF uint8_t 		anr_array_insert_range(void* ds, uint32_t index, void* data, uint32_t count);
+ANRDATADEF uint8_t 		anr_array_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 	anr_array_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
+ANRDATADEF void 		anr_array_sort(void* ds, anr_compare_func compare);
+ANRDATADEF void 		anr_array_init_small(anr_array* arr, anr_small_storage* small, uint32_t data_size, void* storage, uint32_t capacity, anr_allocator* allocator); // arr, small and storage must not move
+#ifdef ANR_DATA_MMAP
+ANRDATADEF anr_array 	anr_array_create_file(const char* path, uint32_t data_size, uint32_t reserve_count, anr_access_hint hint); // data is NULL on fail
+ANRDATADEF uint8_t 		anr_array_sync(void* ds); // Store length in the file and flush, returns 1 on success, 0 on fail
+ANRDATADEF void 		anr_array_advise(void* ds, anr_access_hint hint);
+#endif
+ANRDATADEF uint8_t 		anr_array_sort_by_key(void* ds, uint32_t key_offset, anr_key_type key_type); // Stable radix sort, returns 0 if the scratch buffer can not be allocated
 
 // === hashmap ===
 ANRDATADEF anr_hashmap 	anr_hashmap_create(uint32_t data_size, uint32_t bucket_size);
+ANRDATADEF anr_hashmap 	anr_hashmap_create_ex(uint32_t data_size, uint32_t bucket_size, anr_allocator* allocator);
 ANRDATADEF int32_t	 	anr_hashmap_add(void* ds, void* ptr);
 ANRDATADEF void 		anr_hashmap_free(void* ds);
 ANRDATADEF void 		anr_hashmap_print(void* ds);
@@ -204,6 +691,213 @@ ANRDATADEF uint8_t 		anr_hashmap_insert(void* ds, uint32_t index, void* ptr);
 ANRDATADEF uint32_t 	anr_hashmap_length(void* ds);
 ANRDATADEF anr_iter 	anr_hashmap_iter_start(void* ds);
 ANRDATADEF uint8_t 		anr_hashmap_iter_next(void* ds, anr_iter* iter);
+ANRDATADEF uint8_t 		anr_hashmap_add_range(void* ds, void* data, uint32_t count);
+ANRDATADEF uint8_t 		anr_hashmap_insert_range(void* ds, uint32_t index, void* data, uint32_t count);
+ANRDATADEF uint8_t 		anr_hashmap_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 	anr_hashmap_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
+
+// === hashtable ===
+ANRDATADEF anr_hashtable 	anr_hashtable_create(uint32_t data_size, uint32_t key_size, anr_hash_func hash);
+ANRDATADEF anr_hashtable 	anr_hashtable_create_ex(uint32_t data_size, uint32_t key_size, anr_hash_func hash, anr_allocator* allocator);
+ANRDATADEF int32_t	 		anr_hashtable_add(void* ds, void* ptr);
+ANRDATADEF void 			anr_hashtable_free(void* ds);
+ANRDATADEF void 			anr_hashtable_print(void* ds);
+ANRDATADEF void* 			anr_hashtable_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 		anr_hashtable_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 			anr_hashtable_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 			anr_hashtable_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 			anr_hashtable_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 		anr_hashtable_length(void* ds);
+ANRDATADEF anr_iter 		anr_hashtable_iter_start(void* ds);
+ANRDATADEF uint8_t 			anr_hashtable_iter_next(void* ds, anr_iter* iter);
+ANRDATADEF uint8_t 			anr_hashtable_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 		anr_hashtable_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
+ANRDATADEF uint64_t 		anr_hash_bytes(const void* key, uint32_t key_size);
+
+// === unrolled list ===
+ANRDATADEF anr_unrolled_list 	anr_unrolled_list_create(uint32_t data_size);
+ANRDATADEF anr_unrolled_list 	anr_unrolled_list_create_ex(uint32_t data_size, uint32_t node_capacity, anr_allocator* allocator); // node_capacity 0 uses ANR_UNROLLED_LIST_NODE_SIZE
+ANRDATADEF int32_t	 			anr_unrolled_list_add(void* ds, void* ptr);
+ANRDATADEF void 				anr_unrolled_list_free(void* ds);
+ANRDATADEF void 				anr_unrolled_list_print(void* ds);
+ANRDATADEF void* 				anr_unrolled_list_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 			anr_unrolled_list_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 				anr_unrolled_list_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 				anr_unrolled_list_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 				anr_unrolled_list_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 			anr_unrolled_list_length(void* ds);
+ANRDATADEF anr_iter 			anr_unrolled_list_iter_start(void* ds);
+ANRDATADEF uint8_t 				anr_unrolled_list_iter_next(void* ds, anr_iter* iter);
+
+// === sequence ===
+ANRDATADEF anr_sequence 	anr_sequence_create(uint32_t data_size);
+ANRDATADEF anr_sequence 	anr_sequence_create_ex(uint32_t data_size, uint32_t leaf_capacity, anr_allocator* allocator); // leaf_capacity 0 uses ANR_SEQUENCE_LEAF_SIZE
+ANRDATADEF int32_t	 		anr_sequence_add(void* ds, void* ptr);
+ANRDATADEF void 			anr_sequence_free(void* ds);
+ANRDATADEF void 			anr_sequence_print(void* ds);
+ANRDATADEF void* 			anr_sequence_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 		anr_sequence_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 			anr_sequence_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 			anr_sequence_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 			anr_sequence_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 		anr_sequence_length(void* ds);
+ANRDATADEF anr_iter 		anr_sequence_iter_start(void* ds);
+ANRDATADEF uint8_t 			anr_sequence_iter_next(void* ds, anr_iter* iter);
+
+// === gap buffer ===
+ANRDATADEF anr_gap_buffer 	anr_gap_buffer_create(uint32_t data_size, uint32_t reserve_count);
+ANRDATADEF anr_gap_buffer 	anr_gap_buffer_create_ex(uint32_t data_size, uint32_t reserve_count, anr_allocator* allocator);
+ANRDATADEF int32_t	 		anr_gap_buffer_add(void* ds, void* ptr);
+ANRDATADEF void 			anr_gap_buffer_free(void* ds);
+ANRDATADEF void 			anr_gap_buffer_print(void* ds);
+ANRDATADEF void* 			anr_gap_buffer_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 		anr_gap_buffer_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 			anr_gap_buffer_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 			anr_gap_buffer_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 			anr_gap_buffer_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 		anr_gap_buffer_length(void* ds);
+ANRDATADEF anr_iter 		anr_gap_buffer_iter_start(void* ds);
+ANRDATADEF uint8_t 			anr_gap_buffer_iter_next(void* ds, anr_iter* iter);
+
+// === deque ===
+ANRDATADEF anr_deque 	anr_deque_create(uint32_t data_size, uint32_t reserve_count);
+ANRDATADEF anr_deque 	anr_deque_create_ex(uint32_t data_size, uint32_t reserve_count, anr_allocator* allocator);
+ANRDATADEF int32_t	 	anr_deque_add(void* ds, void* ptr);
+ANRDATADEF void 		anr_deque_free(void* ds);
+ANRDATADEF void 		anr_deque_print(void* ds);
+ANRDATADEF void* 		anr_deque_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 	anr_deque_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 		anr_deque_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 		anr_deque_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 		anr_deque_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 	anr_deque_length(void* ds);
+ANRDATADEF anr_iter 	anr_deque_iter_start(void* ds);
+ANRDATADEF uint8_t 		anr_deque_iter_next(void* ds, anr_iter* iter);
+
+// === sorted array ===
+ANRDATADEF anr_sorted_array 	anr_sorted_array_create(uint32_t data_size, anr_compare_func compare);
+ANRDATADEF anr_sorted_array 	anr_sorted_array_create_ex(uint32_t data_size, uint32_t reserve_count, anr_compare_func compare, uint8_t eytzinger, anr_allocator* allocator);
+ANRDATADEF uint8_t 				anr_sorted_array_merge_sorted(void* ds, void* data, uint32_t count); // data has count entries sorted by compare, returns 1 on success
+ANRDATADEF int32_t	 			anr_sorted_array_add(void* ds, void* ptr);
+ANRDATADEF void 				anr_sorted_array_free(void* ds);
+ANRDATADEF void 				anr_sorted_array_print(void* ds);
+ANRDATADEF void* 				anr_sorted_array_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 			anr_sorted_array_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 				anr_sorted_array_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 				anr_sorted_array_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 				anr_sorted_array_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 			anr_sorted_array_length(void* ds);
+ANRDATADEF anr_iter 			anr_sorted_array_iter_start(void* ds);
+ANRDATADEF uint8_t 				anr_sorted_array_iter_next(void* ds, anr_iter* iter);
+ANRDATADEF uint8_t 				anr_sorted_array_add_range(void* ds, void* data, uint32_t count);
+ANRDATADEF uint8_t 				anr_sorted_array_insert_range(void* ds, uint32_t index, void* data, uint32_t count);
+ANRDATADEF uint8_t 				anr_sorted_array_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 			anr_sorted_array_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
+
+// === concurrent hashtable ===
+// Index is slot * shard_count + shard.
+ANRDATADEF anr_concurrent_hashtable 	anr_concurrent_hashtable_create(uint32_t data_size, uint32_t key_size, anr_hash_func hash);
+ANRDATADEF anr_concurrent_hashtable 	anr_concurrent_hashtable_create_ex(uint32_t data_size, uint32_t key_size, anr_hash_func hash, uint32_t shard_count, anr_allocator* allocator); // shard_count 0 uses ANR_CONCURRENT_HASHTABLE_SHARDS
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_get(void* ds, const void* key, void* out); // Thread safe, lock free. Copies the entry to out, returns 1 if found
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_put(void* ds, void* ptr); // Thread safe, adds or replaces by key, returns 1 on success
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_erase(void* ds, const void* key); // Thread safe, returns 1 if the key was removed
+ANRDATADEF void 						anr_concurrent_hashtable_reclaim(void* ds); // Release blocks retired by rehashes, only call while no thread is reading
+ANRDATADEF int32_t	 					anr_concurrent_hashtable_add(void* ds, void* ptr);
+ANRDATADEF void 						anr_concurrent_hashtable_free(void* ds);
+ANRDATADEF void 						anr_concurrent_hashtable_print(void* ds);
+ANRDATADEF void* 						anr_concurrent_hashtable_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 					anr_concurrent_hashtable_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 					anr_concurrent_hashtable_length(void* ds);
+ANRDATADEF anr_iter 					anr_concurrent_hashtable_iter_start(void* ds);
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_iter_next(void* ds, anr_iter* iter);
+ANRDATADEF uint8_t 						anr_concurrent_hashtable_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 					anr_concurrent_hashtable_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
+
+// === mpmc queue ===
+ANRDATADEF anr_mpmc_queue 	anr_mpmc_queue_create(uint32_t data_size, uint32_t capacity);
+ANRDATADEF anr_mpmc_queue 	anr_mpmc_queue_create_ex(uint32_t data_size, uint32_t capacity, anr_allocator* allocator);
+ANRDATADEF uint8_t 			anr_mpmc_queue_try_push(void* ds, void* ptr); // Thread safe, returns 1 on success, 0 if full
+ANRDATADEF uint8_t 			anr_mpmc_queue_try_pop(void* ds, void* out); // Thread safe, copies the entry to out, returns 1 on success, 0 if empty
+ANRDATADEF int32_t	 		anr_mpmc_queue_add(void* ds, void* ptr);
+ANRDATADEF void 			anr_mpmc_queue_free(void* ds);
+ANRDATADEF void 			anr_mpmc_queue_print(void* ds);
+ANRDATADEF void* 			anr_mpmc_queue_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 		anr_mpmc_queue_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 			anr_mpmc_queue_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 			anr_mpmc_queue_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 			anr_mpmc_queue_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 		anr_mpmc_queue_length(void* ds);
+ANRDATADEF anr_iter 		anr_mpmc_queue_iter_start(void* ds);
+ANRDATADEF uint8_t 			anr_mpmc_queue_iter_next(void* ds, anr_iter* iter);
+
+// === bloom filter ===
+ANRDATADEF anr_bloom_filter anr_bloom_create(uint32_t expected_count, double false_positive_rate, uint32_t key_size, uint8_t counting, anr_allocator* allocator);
+ANRDATADEF void 			anr_bloom_add(anr_bloom_filter* filter, const void* key);
+ANRDATADEF uint8_t 			anr_bloom_remove(anr_bloom_filter* filter, const void* key); // Counting only, key has to be added before. Returns 1 on success
+ANRDATADEF uint8_t 			anr_bloom_contains(const anr_bloom_filter* filter, const void* key); // 0 if key was never added, 1 if it probably was
+ANRDATADEF void 			anr_bloom_clear(anr_bloom_filter* filter);
+ANRDATADEF void 			anr_bloom_free(anr_bloom_filter* filter);
+
+// === filtered ===
+ANRDATADEF anr_filtered 	anr_filtered_create(void* inner, uint32_t key_size, uint32_t expected_count, double false_positive_rate, uint8_t counting);
+ANRDATADEF void 			anr_filtered_rebuild(void* ds); // Refill the filter from the container, drops bits of removed keys
+ANRDATADEF int32_t	 		anr_filtered_add(void* ds, void* ptr);
+ANRDATADEF void 			anr_filtered_free(void* ds);
+ANRDATADEF void 			anr_filtered_print(void* ds);
+ANRDATADEF void* 			anr_filtered_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 		anr_filtered_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 			anr_filtered_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 			anr_filtered_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 			anr_filtered_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 		anr_filtered_length(void* ds);
+ANRDATADEF anr_iter 		anr_filtered_iter_start(void* ds);
+ANRDATADEF uint8_t 			anr_filtered_iter_next(void* ds, anr_iter* iter);
+ANRDATADEF uint8_t 			anr_filtered_add_range(void* ds, void* data, uint32_t count);
+ANRDATADEF uint8_t 			anr_filtered_insert_range(void* ds, uint32_t index, void* data, uint32_t count);
+ANRDATADEF uint8_t 			anr_filtered_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 		anr_filtered_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
+
+// === slot map ===
+// Index is the dense position, remove_at moves the last entry into the hole. Handles stay valid until their entry is removed.
+ANRDATADEF anr_slot_map 	anr_slot_map_create(uint32_t data_size, uint32_t reserve_count);
+ANRDATADEF anr_slot_map 	anr_slot_map_create_ex(uint32_t data_size, uint32_t reserve_count, anr_allocator* allocator);
+ANRDATADEF anr_handle 		anr_slot_map_put(void* ds, void* ptr); // Returns the handle of the new entry, 0 on fail
+ANRDATADEF void* 			anr_slot_map_get(void* ds, anr_handle handle); // NULL if the entry was removed
+ANRDATADEF uint8_t 			anr_slot_map_erase(void* ds, anr_handle handle); // Returns 1 if the entry was removed, 0 for a stale handle
+ANRDATADEF anr_handle 		anr_slot_map_handle_at(void* ds, uint32_t index);
+ANRDATADEF int32_t	 		anr_slot_map_add(void* ds, void* ptr);
+ANRDATADEF void 			anr_slot_map_free(void* ds);
+ANRDATADEF void 			anr_slot_map_print(void* ds);
+ANRDATADEF void* 			anr_slot_map_find_at(void* ds, uint32_t index);
+ANRDATADEF uint32_t 		anr_slot_map_find_by(void* ds, char* ptr);
+ANRDATADEF uint8_t 			anr_slot_map_remove_at(void* ds, uint32_t index);
+ANRDATADEF uint8_t 			anr_slot_map_remove_by(void* ds, void* ptr);
+ANRDATADEF uint8_t 			anr_slot_map_insert(void* ds, uint32_t index, void* ptr);
+ANRDATADEF uint32_t 		anr_slot_map_length(void* ds);
+ANRDATADEF anr_iter 		anr_slot_map_iter_start(void* ds);
+ANRDATADEF uint8_t 			anr_slot_map_iter_next(void* ds, anr_iter* iter);
+
+// === intrusive list ===
+// No allocations and no copies, the caller owns the memory of every link. at == NULL means the end of the list.
+ANRDATADEF anr_list 		anr_list_create(void);
+ANRDATADEF void 			anr_list_push_back(anr_list* list, anr_list_link* link);
+ANRDATADEF void 			anr_list_push_front(anr_list* list, anr_list_link* link);
+ANRDATADEF void 			anr_list_insert_after(anr_list* list, anr_list_link* at, anr_list_link* link); // at == NULL inserts at the front
+ANRDATADEF void 			anr_list_insert_before(anr_list* list, anr_list_link* at, anr_list_link* link); // at == NULL inserts at the back
+ANRDATADEF void 			anr_list_unlink(anr_list* list, anr_list_link* link);
+ANRDATADEF anr_list_link* 	anr_list_pop_front(anr_list* list); // NULL if empty
+ANRDATADEF void 			anr_list_splice(anr_list* list, anr_list_link* at, anr_list* src); // Moves all of src before at, src is left empty
+ANRDATADEF uint32_t 		anr_list_length(anr_list* list);
+
+// === range fallback ===
+// One call per entry through the single entry functions, used by containers without a bulk path.
+ANRDATADEF uint8_t 		anr_ds_generic_add_range(void* ds, void* data, uint32_t count);
+ANRDATADEF uint8_t 		anr_ds_generic_insert_range(void* ds, uint32_t index, void* data, uint32_t count);
+ANRDATADEF uint8_t 		anr_ds_generic_remove_range(void* ds, uint32_t index, uint32_t count);
+ANRDATADEF uint32_t 	anr_ds_generic_remove_if(void* ds, anr_predicate_func predicate, void* ctx);
 
 anr_ds_table _ds_ll = 
 {
@@ -218,6 +912,10 @@ anr_ds_table _ds_ll =
 	anr_linked_list_length,
 	anr_linked_list_iter_start,
 	anr_linked_list_iter_next,
+	anr_linked_list_add_range,
+	anr_linked_list_insert_range,
+	anr_linked_list_remove_range,
+	anr_linked_list_remove_if,
 };
 
 anr_ds_table _ds_array = 
@@ -233,6 +931,10 @@ anr_ds_table _ds_array =
 	anr_array_length,
 	anr_array_iter_start,
 	anr_array_iter_next,
+	anr_array_add_range,
+	anr_array_insert_range,
+	anr_array_remove_range,
+	anr_array_remove_if,
 };
 
 anr_ds_table _ds_hashmap = 
@@ -248,6 +950,200 @@ anr_ds_table _ds_hashmap =
 	anr_hashmap_length,
 	anr_hashmap_iter_start,
 	anr_hashmap_iter_next,
+	anr_hashmap_add_range,
+	anr_hashmap_insert_range,
+	anr_hashmap_remove_range,
+	anr_hashmap_remove_if,
+};
+
+anr_ds_table _ds_hashtable = 
+{
+	anr_hashtable_add,
+	anr_hashtable_free,
+	anr_hashtable_print,
+	anr_hashtable_find_at,
+	anr_hashtable_find_by,
+	anr_hashtable_remove_at,
+	anr_hashtable_remove_by,
+	anr_hashtable_insert,
+	anr_hashtable_length,
+	anr_hashtable_iter_start,
+	anr_hashtable_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_hashtable_remove_range,
+	anr_hashtable_remove_if,
+};
+
+anr_ds_table _ds_unrolled_list = 
+{
+	anr_unrolled_list_add,
+	anr_unrolled_list_free,
+	anr_unrolled_list_print,
+	anr_unrolled_list_find_at,
+	anr_unrolled_list_find_by,
+	anr_unrolled_list_remove_at,
+	anr_unrolled_list_remove_by,
+	anr_unrolled_list_insert,
+	anr_unrolled_list_length,
+	anr_unrolled_list_iter_start,
+	anr_unrolled_list_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_ds_generic_remove_range,
+	anr_ds_generic_remove_if,
+};
+
+anr_ds_table _ds_sequence = 
+{
+	anr_sequence_add,
+	anr_sequence_free,
+	anr_sequence_print,
+	anr_sequence_find_at,
+	anr_sequence_find_by,
+	anr_sequence_remove_at,
+	anr_sequence_remove_by,
+	anr_sequence_insert,
+	anr_sequence_length,
+	anr_sequence_iter_start,
+	anr_sequence_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_ds_generic_remove_range,
+	anr_ds_generic_remove_if,
+};
+
+anr_ds_table _ds_gap_buffer = 
+{
+	anr_gap_buffer_add,
+	anr_gap_buffer_free,
+	anr_gap_buffer_print,
+	anr_gap_buffer_find_at,
+	anr_gap_buffer_find_by,
+	anr_gap_buffer_remove_at,
+	anr_gap_buffer_remove_by,
+	anr_gap_buffer_insert,
+	anr_gap_buffer_length,
+	anr_gap_buffer_iter_start,
+	anr_gap_buffer_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_ds_generic_remove_range,
+	anr_ds_generic_remove_if,
+};
+
+anr_ds_table _ds_deque = 
+{
+	anr_deque_add,
+	anr_deque_free,
+	anr_deque_print,
+	anr_deque_find_at,
+	anr_deque_find_by,
+	anr_deque_remove_at,
+	anr_deque_remove_by,
+	anr_deque_insert,
+	anr_deque_length,
+	anr_deque_iter_start,
+	anr_deque_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_ds_generic_remove_range,
+	anr_ds_generic_remove_if,
+};
+
+anr_ds_table _ds_sorted_array = 
+{
+	anr_sorted_array_add,
+	anr_sorted_array_free,
+	anr_sorted_array_print,
+	anr_sorted_array_find_at,
+	anr_sorted_array_find_by,
+	anr_sorted_array_remove_at,
+	anr_sorted_array_remove_by,
+	anr_sorted_array_insert,
+	anr_sorted_array_length,
+	anr_sorted_array_iter_start,
+	anr_sorted_array_iter_next,
+	anr_sorted_array_add_range,
+	anr_sorted_array_insert_range,
+	anr_sorted_array_remove_range,
+	anr_sorted_array_remove_if,
+};
+
+anr_ds_table _ds_mpmc_queue = 
+{
+	anr_mpmc_queue_add,
+	anr_mpmc_queue_free,
+	anr_mpmc_queue_print,
+	anr_mpmc_queue_find_at,
+	anr_mpmc_queue_find_by,
+	anr_mpmc_queue_remove_at,
+	anr_mpmc_queue_remove_by,
+	anr_mpmc_queue_insert,
+	anr_mpmc_queue_length,
+	anr_mpmc_queue_iter_start,
+	anr_mpmc_queue_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_ds_generic_remove_range,
+	anr_ds_generic_remove_if,
+};
+
+anr_ds_table _ds_concurrent_hashtable = 
+{
+	anr_concurrent_hashtable_add,
+	anr_concurrent_hashtable_free,
+	anr_concurrent_hashtable_print,
+	anr_concurrent_hashtable_find_at,
+	anr_concurrent_hashtable_find_by,
+	anr_concurrent_hashtable_remove_at,
+	anr_concurrent_hashtable_remove_by,
+	anr_concurrent_hashtable_insert,
+	anr_concurrent_hashtable_length,
+	anr_concurrent_hashtable_iter_start,
+	anr_concurrent_hashtable_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_concurrent_hashtable_remove_range,
+	anr_concurrent_hashtable_remove_if,
+};
+
+anr_ds_table _ds_filtered = 
+{
+	anr_filtered_add,
+	anr_filtered_free,
+	anr_filtered_print,
+	anr_filtered_find_at,
+	anr_filtered_find_by,
+	anr_filtered_remove_at,
+	anr_filtered_remove_by,
+	anr_filtered_insert,
+	anr_filtered_length,
+	anr_filtered_iter_start,
+	anr_filtered_iter_next,
+	anr_filtered_add_range,
+	anr_filtered_insert_range,
+	anr_filtered_remove_range,
+	anr_filtered_remove_if,
+};
+
+anr_ds_table _ds_slot_map = 
+{
+	anr_slot_map_add,
+	anr_slot_map_free,
+	anr_slot_map_print,
+	anr_slot_map_find_at,
+	anr_slot_map_find_by,
+	anr_slot_map_remove_at,
+	anr_slot_map_remove_by,
+	anr_slot_map_insert,
+	anr_slot_map_length,
+	anr_slot_map_iter_start,
+	anr_slot_map_iter_next,
+	anr_ds_generic_add_range,
+	anr_ds_generic_insert_range,
+	anr_ds_generic_remove_range,
+	anr_ds_generic_remove_if,
 };
 
 anr_ds_pair _ds_arr[] = 
@@ -255,32 +1151,343 @@ anr_ds_pair _ds_arr[] =
 	{ANR_DS_LINKEDLIST, &_ds_ll},
 	{ANR_DS_DYNAMIC_ARRAY, &_ds_array},
 	{ANR_DS_HASHMAP, &_ds_hashmap},
+	{ANR_DS_HASHTABLE, &_ds_hashtable},
+	{ANR_DS_UNROLLED_LIST, &_ds_unrolled_list},
+	{ANR_DS_SEQUENCE, &_ds_sequence},
+	{ANR_DS_GAP_BUFFER, &_ds_gap_buffer},
+	{ANR_DS_DEQUE, &_ds_deque},
+	{ANR_DS_SORTED_ARRAY, &_ds_sorted_array},
+	{ANR_DS_MPMC_QUEUE, &_ds_mpmc_queue},
+	{ANR_DS_CONCURRENT_HASHTABLE, &_ds_concurrent_hashtable},
+	{ANR_DS_FILTERED, &_ds_filtered},
+	{ANR_DS_SLOT_MAP, &_ds_slot_map},
 };
 
+#ifdef ANR_DATA_MMAP
+// === snapshot ===
+#define ANR_DATA_SNAPSHOT_VERSION 1
+
+typedef struct
+{
+	union
+	{
+		anr_ds_type ds_type;
+		anr_array array;
+		anr_hashmap hashmap;
+	} ds; // First, so an anr_mapped* can be passed as anr_ds*.
+	anr_allocator allocator; // Blocks inside the mapping are copied out when they grow and never freed.
+	void* base;
+	size_t size;
+	void* handle; // File mapping handle on Windows.
+} anr_mapped;
+
+ANRDATADEF uint8_t 		anr_ds_save(void* ds, const char* path); // anr_array or anr_hashmap, returns 1 on success, 0 on fail
+ANRDATADEF anr_mapped* 	anr_ds_open_mapped(const char* path); // NULL if the file is missing or not a snapshot of this version
+ANRDATADEF void 		anr_ds_close_mapped(anr_mapped* mapped); // Frees the ds and unmaps the file.
+#endif
+
+#ifdef ANR_DATA_THREADS
+// === parallel ===
+typedef void (*anr_parallel_func)(void* data, uint32_t index, void* ctx);
+typedef void (*anr_reduce_func)(void* acc, void* data, uint32_t index, void* ctx); // Fold data into acc.
+typedef void (*anr_combine_func)(void* acc, const void* other, void* ctx); // Fold the acc of another chunk into acc.
+
+ANRDATADEF void 	anr_ds_parallel_for(void* ds, anr_parallel_func fn, void* ctx, uint32_t thread_count); // thread_count includes the calling thread
+ANRDATADEF void 	anr_ds_parallel_reduce(void* ds, anr_reduce_func reduce, anr_combine_func combine, void* ctx, void* result, uint32_t result_size, uint32_t thread_count);
+ANRDATADEF void 	anr_ds_parallel_shutdown(); // Stop the pool threads, the next parallel call starts them again.
+ANRDATADEF uint8_t 	anr_array_parallel_sort(void* ds, anr_compare_func compare, uint32_t thread_count); // Returns 0 if the scratch buffer can not be allocated
+#endif
+
+// === arena ===
+ANRDATADEF anr_arena 		anr_arena_create(size_t block_size);
+ANRDATADEF anr_allocator 	anr_arena_allocator(anr_arena* arena); // Allocator handing out memory from arena.
+ANRDATADEF void 			anr_arena_reset(anr_arena* arena); // Drop all allocations, keeps the newest block.
+ANRDATADEF void 			anr_arena_free(anr_arena* arena);
+
 #define ANR_DS_ARRAY(_data_size, _reserve_count) anr_array_create(_data_size, _reserve_count)
 #define ANR_DS_LINKED_LIST(_data_size) anr_linked_list_create(_data_size)
 #define ANR_DS_HASHMAP(_data_size, _bucket_size) anr_hashmap_create(_data_size, _bucket_size)
+#define ANR_DS_HASHTABLE(_data_size, _key_size, _hash) anr_hashtable_create(_data_size, _key_size, _hash)
+#define ANR_DS_UNROLLED_LIST(_data_size) anr_unrolled_list_create(_data_size)
+#define ANR_DS_SEQUENCE(_data_size) anr_sequence_create(_data_size)
+#define ANR_DS_GAP_BUFFER(_data_size, _reserve_count) anr_gap_buffer_create(_data_size, _reserve_count)
+#define ANR_DS_DEQUE(_data_size, _reserve_count) anr_deque_create(_data_size, _reserve_count)
+#define ANR_DS_SORTED_ARRAY(_data_size, _compare) anr_sorted_array_create(_data_size, _compare)
+#define ANR_DS_MPMC_QUEUE(_data_size, _capacity) anr_mpmc_queue_create(_data_size, _capacity)
+#define ANR_DS_CONCURRENT_HASHTABLE(_data_size, _key_size, _hash) anr_concurrent_hashtable_create(_data_size, _key_size, _hash)
+#define ANR_DS_SLOT_MAP(_data_size) anr_slot_map_create(_data_size, 0)
+#define ANR_DS_FILTERED(_inner, _key_size, _expected_count, _false_positive_rate) anr_filtered_create(_inner, _key_size, _expected_count, _false_positive_rate, 0)
+
+// Runtime dispatch through _ds_arr, works for any ds passed as anr_ds* or void*.
+#define ANR__DS_TABLE(__ds) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds
+
+// With C11 a pointer to a known container type calls its function directly so the compiler can inline it.
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(ANR_DATA_NO_GENERIC)
+#define ANR__DS_FUNC(__ds, __op) _Generic((__ds), \
+	anr_linked_list*: anr_linked_list_##__op, \
+	anr_array*: anr_array_##__op, \
+	anr_hashmap*: anr_hashmap_##__op, \
+	anr_hashtable*: anr_hashtable_##__op, \
+	anr_unrolled_list*: anr_unrolled_list_##__op, \
+	anr_sequence*: anr_sequence_##__op, \
+	anr_gap_buffer*: anr_gap_buffer_##__op, \
+	anr_deque*: anr_deque_##__op, \
+	anr_sorted_array*: anr_sorted_array_##__op, \
+	anr_mpmc_queue*: anr_mpmc_queue_##__op, \
+	anr_concurrent_hashtable*: anr_concurrent_hashtable_##__op, \
+	anr_filtered*: anr_filtered_##__op, \
+	anr_slot_map*: anr_slot_map_##__op, \
+	default: ANR__DS_TABLE(__ds)->__op)
+#else
+#define ANR__DS_FUNC(__ds, __op) ANR__DS_TABLE(__ds)->__op
+#endif
 
-#define ANR_DS_ADD(__ds, __ptr) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->add((void*)__ds, (void*)__ptr)
-#define ANR_DS_FREE(__ds) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->free((void*)__ds)
-#define ANR_DS_PRINT(__ds) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->print((void*)__ds)
-#define ANR_DS_FIND_AT(__ds, __index) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->find_at((void*)__ds, __index)
-#define ANR_DS_FIND_BY(__ds, __ptr) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->find_by((void*)__ds, (void*)__ptr)
-#define ANR_DS_REMOVE_BY(__ds, __ptr) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->remove_by((void*)__ds, (void*)__ptr)
-#define ANR_DS_REMOVE_AT(__ds, __index) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->remove_at((void*)__ds, __index)
-#define ANR_DS_INSERT(__ds, __index, __ptr) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->insert((void*)__ds, __index, (void*)__ptr)
-#define ANR_DS_LENGTH(__ds) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->length((void*)__ds)
-#define ANR_DS_ITER_START(__ds) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->iter_start((void*)__ds)
-#define ANR_DS_ITER_NEXT(__ds, __iter) (_ds_arr[(int)(((anr_ds*)__ds)->ds_ll.ds_type)]).ds->iter_next((void*)__ds, __iter)
+#define ANR_DS_ADD(__ds, __ptr) ANR__DS_FUNC(__ds, add)((void*)__ds, (void*)__ptr)
+#define ANR_DS_FREE(__ds) ANR__DS_FUNC(__ds, free)((void*)__ds)
+#define ANR_DS_PRINT(__ds) ANR__DS_FUNC(__ds, print)((void*)__ds)
+#define ANR_DS_FIND_AT(__ds, __index) ANR__DS_FUNC(__ds, find_at)((void*)__ds, __index)
+#define ANR_DS_FIND_BY(__ds, __ptr) ANR__DS_FUNC(__ds, find_by)((void*)__ds, (void*)__ptr)
+#define ANR_DS_REMOVE_BY(__ds, __ptr) ANR__DS_FUNC(__ds, remove_by)((void*)__ds, (void*)__ptr)
+#define ANR_DS_REMOVE_AT(__ds, __index) ANR__DS_FUNC(__ds, remove_at)((void*)__ds, __index)
+#define ANR_DS_INSERT(__ds, __index, __ptr) ANR__DS_FUNC(__ds, insert)((void*)__ds, __index, (void*)__ptr)
+#define ANR_DS_LENGTH(__ds) ANR__DS_FUNC(__ds, length)((void*)__ds)
+#define ANR_DS_ITER_START(__ds) ANR__DS_FUNC(__ds, iter_start)((void*)__ds)
+#define ANR_DS_ITER_NEXT(__ds, __iter) ANR__DS_FUNC(__ds, iter_next)((void*)__ds, __iter)
+
+// Bulk operations always go through the table, not every container has its own.
+#define ANR_DS_ADD_RANGE(__ds, __data, __count) ANR__DS_TABLE(__ds)->add_range((void*)__ds, (void*)__data, __count)
+#define ANR_DS_INSERT_RANGE(__ds, __index, __data, __count) ANR__DS_TABLE(__ds)->insert_range((void*)__ds, __index, (void*)__data, __count)
+#define ANR_DS_REMOVE_RANGE(__ds, __index, __count) ANR__DS_TABLE(__ds)->remove_range((void*)__ds, __index, __count)
+#define ANR_DS_REMOVE_IF(__ds, __predicate, __ctx) ANR__DS_TABLE(__ds)->remove_if((void*)__ds, __predicate, (void*)__ctx)
 
 #define ANR_ITERATE(__iter, __ds) \
-	anr_iter __iter = ANR_DS_ITER_START((void*)__ds); \
-	while (ANR_DS_ITER_NEXT((void*)__ds, &__iter))
+	anr_iter __iter = ANR_DS_ITER_START(__ds); \
+	while (ANR_DS_ITER_NEXT(__ds, &__iter))
+
+#define ANR_CONTAINER_OF(__link, __type, __member) ((__type*)((uint8_t*)(__link) - offsetof(__type, __member)))
+
+// The current link can be unlinked inside the loop, the next one is read before the body runs.
+#define ANR_LIST_ITERATE(__link, __list) \
+	for (anr_list_link* __link = (__list)->first, *__link##_next = __link ? __link->next : NULL; __link; \
+		__link = __link##_next, __link##_next = __link ? __link->next : NULL)
+
+// Typed array functions with a compile time element size, all static inline.
+// ANR_DS_DECLARE(int, intarr) gives intarr_create, intarr_add, intarr_at, intarr_find, ...
+// The array is a regular anr_array so it still works with the ANR_DS_* macros.
+#define ANR_DS_DECLARE(__type, __name) \
+	static inline anr_array __name##_create(uint32_t reserve_count) { return anr_array_create(sizeof(__type), reserve_count); } \
+	static inline void __name##_free(anr_array* arr) { anr_array_free(arr); } \
+	static inline uint32_t __name##_length(const anr_array* arr) { return arr->length; } \
+	static inline __type* __name##_data(const anr_array* arr) { return (__type*)arr->data; } \
+	static inline __type* __name##_at(const anr_array* arr, uint32_t index) { \
+		return index < (uint32_t)arr->length ? (__type*)arr->data + index : NULL; \
+	} \
+	static inline int32_t __name##_add(anr_array* arr, __type value) { \
+		if (arr->length < arr->reserved) { ((__type*)arr->data)[arr->length] = value; return arr->length++; } \
+		return anr_array_add(arr, &value); \
+	} \
+	static inline int32_t __name##_find(const anr_array* arr, __type value) { \
+		const __type* data = (const __type*)arr->data; \
+		for (int32_t i = 0; i < arr->length; i++) if (memcmp(data + i, &value, sizeof(__type)) == 0) return i; \
+		return -1; \
+	} \
+	static inline uint8_t __name##_insert(anr_array* arr, uint32_t index, __type value) { return anr_array_insert(arr, index, &value); } \
+	static inline uint8_t __name##_remove_at(anr_array* arr, uint32_t index) { return anr_array_remove_at(arr, index); }
+
+// Array with the first __count entries inside the struct, only longer arrays allocate.
+// ANR_DS_SMALL_ARRAY(int, 8, smallints) gives the struct smallints and smallints_init(smallints*),
+// use .arr with the ANR_DS_* macros and ANR_DS_DECLARE functions. The struct must not be copied once initialised.
+#define ANR_DS_SMALL_ARRAY(__type, __count, __name) \
+	typedef struct \
+	{ \
+		anr_array arr; \
+		anr_small_storage small; \
+		__type storage[__count]; \
+	} __name; \
+	static inline void __name##_init(__name* a) { anr_array_init_small(&a->arr, &a->small, sizeof(__type), a->storage, __count, NULL); }
+
+// Iterate a typed array, __it is a __type* to the current entry.
+#define ANR_DS_FOREACH(__type, __it, __arr) \
+	for (__type* __it = (__type*)(__arr)->data; __it < (__type*)(__arr)->data + (__arr)->length; __it++)
 
 #endif // INCLUDE_ANR_DATA_H
 
 #ifdef ANR_DATA_IMPLEMENTATION
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANR__DATA_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(ANR__DATA_SSE2) && defined(__AVX2__)
+#define ANR__DATA_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static uint32_t anr__ctz32(uint32_t x) { unsigned long r; _BitScanForward(&r, x); return r; }
+static uint32_t anr__ctz64(uint64_t x) { unsigned long r; _BitScanForward64(&r, x); return r; }
+static uint32_t anr__popcount64(uint64_t x) { return (uint32_t)__popcnt64(x); }
+#if defined(_M_ARM64)
+// Weakly ordered: ldar/stlr give acquire loads and release stores, dmb the fences.
+static uint64_t anr__atomic_load(uint64_t* p) { return __ldar64((volatile unsigned __int64*)p); }
+static void anr__atomic_store(uint64_t* p, uint64_t value) { __stlr64((volatile unsigned __int64*)p, value); }
+static void anr__atomic_fence_acquire() { __dmb(_ARM64_BARRIER_ISHLD); }
+static void anr__atomic_fence_release() { __dmb(_ARM64_BARRIER_ISH); }
+#else
+// x86 and x64 do not reorder loads with loads or stores with stores, only the compiler has to be held back.
+static uint64_t anr__atomic_load(uint64_t* p) { uint64_t value = *(volatile uint64_t*)p; _ReadWriteBarrier(); return value; }
+static void anr__atomic_store(uint64_t* p, uint64_t value) { _ReadWriteBarrier(); *(volatile uint64_t*)p = value; }
+static void anr__atomic_fence_acquire() { _ReadWriteBarrier(); }
+static void anr__atomic_fence_release() { _ReadWriteBarrier(); }
+#endif
+static int anr__atomic_cas(uint64_t* p, uint64_t* expected, uint64_t desired) {
+	uint64_t prev = (uint64_t)_InterlockedCompareExchange64((volatile __int64*)p, (__int64)desired, (__int64)*expected);
+	if (prev == *expected) return 1;
+	*expected = prev;
+	return 0;
+}
+static uint64_t anr__atomic_exchange(uint64_t* p, uint64_t value) { return (uint64_t)_InterlockedExchange64((volatile __int64*)p, (__int64)value); }
+#ifdef ANR_DATA_THREADS
+static uint64_t anr__atomic_fetch_add(uint64_t* p, uint64_t value) { return (uint64_t)_InterlockedExchangeAdd64((volatile __int64*)p, (__int64)value); }
+#endif
+#else
+static uint32_t anr__ctz32(uint32_t x) { return __builtin_ctz(x); }
+static uint32_t anr__ctz64(uint64_t x) { return __builtin_ctzll(x); }
+static uint32_t anr__popcount64(uint64_t x) { return __builtin_popcountll(x); }
+static uint64_t anr__atomic_load(uint64_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void anr__atomic_store(uint64_t* p, uint64_t value) { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+static int anr__atomic_cas(uint64_t* p, uint64_t* expected, uint64_t desired) {
+	return __atomic_compare_exchange_n(p, expected, desired, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+static uint64_t anr__atomic_exchange(uint64_t* p, uint64_t value) { return __atomic_exchange_n(p, value, __ATOMIC_ACQ_REL); }
+#ifdef ANR_DATA_THREADS
+static uint64_t anr__atomic_fetch_add(uint64_t* p, uint64_t value) { return __atomic_fetch_add(p, value, __ATOMIC_RELAXED); }
+#endif
+static void anr__atomic_fence_acquire() { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+static void anr__atomic_fence_release() { __atomic_thread_fence(__ATOMIC_RELEASE); }
+#endif
+
+#ifdef ANR__DATA_SSE2
+#define ANR__CPU_RELAX() _mm_pause() // Spin wait hint.
+#else
+#define ANR__CPU_RELAX() ((void)0)
+#endif
+
+// Compare one entry, sizes that fit an integer avoid the memcmp call.
+static inline int anr__data_equal(const void* a, const void* b, uint32_t data_size)
+{
+	switch (data_size)
+	{
+		case 1: return *(const uint8_t*)a == *(const uint8_t*)b;
+		case 2: { uint16_t x, y; memcpy(&x, a, 2); memcpy(&y, b, 2); return x == y; }
+		case 4: { uint32_t x, y; memcpy(&x, a, 4); memcpy(&y, b, 4); return x == y; }
+		case 8: { uint64_t x, y; memcpy(&x, a, 8); memcpy(&y, b, 8); return x == y; }
+		default: return memcmp(a, b, data_size) == 0;
+	}
+}
+
+// Bit i is set when entry i of data equals key, count <= 64. Sizes 1, 2, 4, 8 and 16 compare
+// a broadcast key against a whole vector at once, the tail and other sizes compare one by one.
+static uint64_t anr__match_block(const uint8_t* data, uint32_t count, const void* key, uint32_t data_size)
+{
+	uint64_t result = 0;
+	uint32_t i = 0;
+
+	#ifdef ANR__DATA_SSE2
+	switch (data_size)
+	{
+		case 1: {
+			#ifdef ANR__DATA_AVX2
+			__m256i key32 = _mm256_set1_epi8(*(const char*)key);
+			for (; i + 32 <= count; i += 32) {
+				__m256i c = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), key32);
+				result |= (uint64_t)(uint32_t)_mm256_movemask_epi8(c) << i;
+			}
+			#endif
+			__m128i key16 = _mm_set1_epi8(*(const char*)key);
+			for (; i + 16 <= count; i += 16) {
+				__m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), key16);
+				result |= (uint64_t)_mm_movemask_epi8(c) << i;
+			}
+		} break;
+		case 2: {
+			uint16_t k;
+			memcpy(&k, key, 2);
+			__m128i key8 = _mm_set1_epi16((short)k);
+			for (; i + 8 <= count; i += 8) {
+				__m128i c = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(data + i*2)), key8);
+				result |= (uint64_t)(_mm_movemask_epi8(_mm_packs_epi16(c, _mm_setzero_si128())) & 0xFF) << i;
+			}
+		} break;
+		case 4: {
+			uint32_t k;
+			memcpy(&k, key, 4);
+			#ifdef ANR__DATA_AVX2
+			__m256i key8 = _mm256_set1_epi32((int)k);
+			for (; i + 8 <= count; i += 8) {
+				__m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(data + i*4)), key8);
+				result |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(c)) << i;
+			}
+			#endif
+			__m128i key4 = _mm_set1_epi32((int)k);
+			for (; i + 4 <= count; i += 4) {
+				__m128i c = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(data + i*4)), key4);
+				result |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(c)) << i;
+			}
+		} break;
+		case 8: {
+			#ifdef ANR__DATA_AVX2
+			int64_t k;
+			memcpy(&k, key, 8);
+			__m256i key4 = _mm256_set1_epi64x(k);
+			for (; i + 4 <= count; i += 4) {
+				__m256i c = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(data + i*8)), key4);
+				result |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(c)) << i;
+			}
+			#endif
+			// SSE2 has no 64 bit compare, both 32 bit halves have to match.
+			__m128i key1 = _mm_loadl_epi64((const __m128i*)key);
+			__m128i key2 = _mm_unpacklo_epi64(key1, key1);
+			for (; i + 2 <= count; i += 2) {
+				__m128i c = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(data + i*8)), key2);
+				c = _mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+				result |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(c)) << i;
+			}
+		} break;
+		case 16: {
+			__m128i key1 = _mm_loadu_si128((const __m128i*)key);
+			for (; i < count; i++) {
+				__m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i*16)), key1);
+				result |= (uint64_t)(_mm_movemask_epi8(c) == 0xFFFF) << i;
+			}
+		} break;
+	}
+	#endif
+
+	for (; i < count; i++) {
+		if (anr__data_equal(data + (size_t)i*data_size, key, data_size)) result |= (uint64_t)1 << i;
+	}
+	return result;
+}
+
+// Index of the first entry equal to key, -1 if there is none.
+static int64_t anr__find_first(const uint8_t* data, uint32_t count, const void* key, uint32_t data_size)
+{
+	for (uint32_t i = 0; i < count; i += 64)
+	{
+		uint32_t n = count - i < 64 ? count - i : 64;
+		uint64_t match = anr__match_block(data + (size_t)i*data_size, n, key, data_size);
+		if (match) return i + anr__ctz64(match);
+	}
+	return -1;
+}
+
+#define ANR__DATA_ALLOC(_allocator, _size) ((_allocator) ? (_allocator)->alloc((_allocator)->ctx, _size) : malloc(_size))
+#define ANR__DATA_REALLOC(_allocator, _ptr, _old_size, _new_size) ((_allocator) ? (_allocator)->realloc((_allocator)->ctx, _ptr, _old_size, _new_size) : realloc(_ptr, _new_size))
+#define ANR__DATA_FREE(_allocator, _ptr) ((_allocator) ? (_allocator)->free((_allocator)->ctx, _ptr) : free(_ptr))
+
 #ifdef ANR_DATA_DEBUG
 anr_linked_list curr_print = (anr_linked_list){ANR_DS_LINKEDLIST, 0, 0, 0, 200};
 anr_linked_list prev_print = (anr_linked_list){ANR_DS_LINKEDLIST, 0, 0, 0, 200};
@@ -378,19 +1585,55 @@ uint8_t anr_linked_list_iter_next(void* ds, anr_iter* iter)
 	return iter->ll.node != NULL;
 }
 
+#define ANR__LINKED_LIST_SLAB_HEADER 16 // Keeps node data 16 byte aligned like malloc.
+#define ANR__LINKED_LIST_NODE_SIZE(_list) ((sizeof(anr_linked_list_node) + (_list)->data_size - sizeof(void*) + 15) & ~(size_t)15)
+
+static anr_linked_list_node* anr__linked_list_alloc_node(anr_linked_list* list)
+{
+	if (!list->pool.free_nodes)
+	{
+		size_t node_size = ANR__LINKED_LIST_NODE_SIZE(list);
+		size_t node_count = (ANR_LINKED_LIST_SLAB_SIZE - ANR__LINKED_LIST_SLAB_HEADER) / node_size;
+		if (node_count == 0) node_count = 1;
+
+		uint8_t* slab = ANR__DATA_ALLOC(list->allocator, ANR__LINKED_LIST_SLAB_HEADER + node_count*node_size);
+		if (!slab) return 0;
+		*(void**)slab = list->pool.slabs;
+		list->pool.slabs = slab;
+
+		// Push in reverse so nodes are handed out in address order.
+		for (size_t i = node_count; i > 0; i--)
+		{
+			anr_linked_list_node* node = (anr_linked_list_node*)(slab + ANR__LINKED_LIST_SLAB_HEADER + (i-1)*node_size);
+			node->next = list->pool.free_nodes;
+			list->pool.free_nodes = node;
+		}
+	}
+
+	anr_linked_list_node* node = list->pool.free_nodes;
+	list->pool.free_nodes = node->next;
+	return node;
+}
+
+static void anr__linked_list_free_node(anr_linked_list* list, anr_linked_list_node* node)
+{
+	node->next = list->pool.free_nodes;
+	list->pool.free_nodes = node;
+}
+
 void anr_linked_list_free(void* ds)
 {
 	ANRDATA_ASSERT(ds);
 	anr_linked_list* list = ds;
-	anr_linked_list_node* iter = list->last;
-	anr_linked_list_node* last = iter;
-	while (iter)
+	void* slab = list->pool.slabs;
+	while (slab)
 	{
-		last = iter;
-		free(iter->next);
-		iter = iter->prev;
+		void* next = *(void**)slab;
+		ANR__DATA_FREE(list->allocator, slab);
+		slab = next;
 	}
-	free(last);
+	list->pool.slabs = 0;
+	list->pool.free_nodes = 0;
 }
 
 uint8_t anr_linked_list_insert(void* ds, uint32_t index, void* ptr)
@@ -427,7 +1670,7 @@ uint8_t anr_linked_list_insert(void* ds, uint32_t index, void* ptr)
 		next = iter;
 	}
 
-	anr_linked_list_node* node = malloc(sizeof(anr_linked_list_node) + list->data_size - sizeof(void*));
+	anr_linked_list_node* node = anr__linked_list_alloc_node(list);
 	if (!node) return 0;
 	memcpy(((uint8_t*)node)+offsetof(anr_linked_list_node, data), ptr, list->data_size);
 	node->prev = prev;
@@ -494,7 +1737,7 @@ uint8_t anr_linked_list_remove_by(void* ds, void* ptr)
 		((anr_linked_list_node*)(iter->next))->prev = iter->prev;
 	}
 
-	free(iter);
+	anr__linked_list_free_node(list, iter);
 	list->length--;
 	return 1;
 }
@@ -509,7 +1752,7 @@ uint32_t anr_linked_list_find_by(void* ds, char* ptr)
 	while (iter)
 	{
 		void* data = ((uint8_t*)iter)+offsetof(anr_linked_list_node, data);
-		if (memcmp(data, ptr, list->data_size) == 0) {
+		if (anr__data_equal(data, ptr, list->data_size)) {
 			return count;
 		}
 		count++;
@@ -563,54 +1806,215 @@ void* anr_linked_list_find_at(void* ds, uint32_t index)
 
 anr_linked_list anr_linked_list_create(uint32_t data_size)
 {
-	return (anr_linked_list){ANR_DS_LINKEDLIST, 0, 0, 0, data_size, {0}};
+	return anr_linked_list_create_ex(data_size, NULL);
+}
+
+anr_linked_list anr_linked_list_create_ex(uint32_t data_size, anr_allocator* allocator)
+{
+	return (anr_linked_list){ANR_DS_LINKEDLIST, 0, 0, 0, data_size, allocator, {0}, {0}};
 }
 
 int32_t anr_linked_list_add(void* ds, void* ptr)
 {
-	// We dont need to iterate here..
 	ANRDATA_ASSERT(ds);
 	ANRDATA_ASSERT(ptr);
 	anr_linked_list* list = ds;
-	anr_linked_list_node* iter = list->first;
-	do
+	anr_linked_list_node* node = anr__linked_list_alloc_node(list);
+	if (!node) return -1;
+	memcpy(((uint8_t*)node)+offsetof(anr_linked_list_node, data), ptr, list->data_size);
+	node->prev = list->last;
+	node->next = NULL;
+	list->last == NULL ? (list->first = node) : (list->last->next = node);
+	list->last = node;
+	list->length++;
+	return list->length-1;
+}
+
+// Link count new nodes between prev and next as one chain. Nothing is linked if a node can not be allocated.
+static uint8_t anr__linked_list_link_range(anr_linked_list* list, anr_linked_list_node* prev, anr_linked_list_node* next, uint8_t* data, uint32_t count)
+{
+	anr_linked_list_node* first = NULL;
+	anr_linked_list_node* last = NULL;
+	for (uint32_t i = 0; i < count; i++)
 	{
-		if (iter == NULL || iter->next == NULL) {
-			anr_linked_list_node* node = malloc(sizeof(anr_linked_list_node) + list->data_size - sizeof(void*));
-			if (!node) return -1;
-			memcpy(((uint8_t*)node)+offsetof(anr_linked_list_node, data), ptr, list->data_size);
-			node->prev = iter;
-			node->next = NULL;
-			iter == NULL ? (list->first = node) : (iter->next = node);
-			list->last = node;
-			list->length++;
-			return list->length-1;
+		anr_linked_list_node* node = anr__linked_list_alloc_node(list);
+		if (!node) {
+			while (last) {
+				anr_linked_list_node* chain_prev = last->prev;
+				anr__linked_list_free_node(list, last);
+				last = chain_prev;
+			}
+			return 0;
 		}
+		memcpy(((uint8_t*)node)+offsetof(anr_linked_list_node, data), data + (size_t)i*list->data_size, list->data_size);
+		node->prev = last;
+		node->next = NULL;
+		last ? (last->next = node) : (first = node);
+		last = node;
+	}
 
-		iter = iter->next;
-	} while (iter);
-	
-	ANRDATA_ASSERT(0);
-	return -1;
+	first->prev = prev;
+	last->next = next;
+	prev ? (prev->next = first) : (list->first = first);
+	next ? (next->prev = last) : (list->last = last);
+	list->length += count;
+	return 1;
+}
+
+uint8_t anr_linked_list_add_range(void* ds, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_linked_list* list = ds;
+	if (count == 0) return 1;
+	return anr__linked_list_link_range(list, list->last, NULL, data, count);
+}
+
+uint8_t anr_linked_list_insert_range(void* ds, uint32_t index, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_linked_list* list = ds;
+	if (index > list->length) return 0;
+	if (count == 0) return 1;
+	if (index == list->length) return anr__linked_list_link_range(list, list->last, NULL, data, count);
+
+	anr_linked_list_node* next = (anr_linked_list_node*)((uint8_t*)anr_linked_list_find_at(ds, index) - offsetof(anr_linked_list_node, data));
+	list->last_access.index = 0;
+	list->last_access.node = 0;
+	return anr__linked_list_link_range(list, next->prev, next, data, count);
+}
+
+uint8_t anr_linked_list_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_linked_list* list = ds;
+	if ((uint64_t)index + count > list->length) return 0;
+	if (count == 0) return 1;
+
+	anr_linked_list_node* first = (anr_linked_list_node*)((uint8_t*)anr_linked_list_find_at(ds, index) - offsetof(anr_linked_list_node, data));
+	anr_linked_list_node* prev = first->prev;
+	anr_linked_list_node* iter = first;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		anr_linked_list_node* next = iter->next;
+		anr__linked_list_free_node(list, iter);
+		iter = next;
+	}
+
+	prev ? (prev->next = iter) : (list->first = iter);
+	iter ? (iter->prev = prev) : (list->last = prev);
+	list->length -= count;
+	list->last_access.index = 0;
+	list->last_access.node = 0;
+	return 1;
+}
+
+uint32_t anr_linked_list_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(predicate);
+	anr_linked_list* list = ds;
+	uint32_t removed = 0;
+	anr_linked_list_node* iter = list->first;
+	anr_linked_list_node* prev = NULL; // Last kept node.
+
+	while (iter)
+	{
+		anr_linked_list_node* next = iter->next;
+		if (predicate(((uint8_t*)iter)+offsetof(anr_linked_list_node, data), ctx)) {
+			anr__linked_list_free_node(list, iter);
+			removed++;
+		}
+		else {
+			iter->prev = prev;
+			prev ? (prev->next = iter) : (list->first = iter);
+			prev = iter;
+		}
+		iter = next;
+	}
+
+	prev ? (prev->next = NULL) : (list->first = NULL);
+	list->last = prev;
+	list->length -= removed;
+	list->last_access.index = 0;
+	list->last_access.node = 0;
+	return removed;
 }
 
 anr_array anr_array_create(uint32_t data_size, uint32_t reserve_count)
+{
+	return anr_array_create_ex(data_size, reserve_count, ANR_ARRAY_POLICY_DEFAULT, NULL);
+}
+
+anr_array anr_array_create_ex(uint32_t data_size, uint32_t reserve_count, anr_array_policy policy, anr_allocator* allocator)
 {
 	ANRDATA_ASSERT(data_size > 0);
 	ANRDATA_ASSERT(reserve_count > 0);
+	ANRDATA_ASSERT(policy.growth_factor >= 1.0f);
+	ANRDATA_ASSERT(policy.shrink_threshold >= 0.0f && policy.shrink_threshold < 0.5f);
 
-	anr_array arr = (anr_array){ANR_DS_DYNAMIC_ARRAY, .data = 0, .data_size = data_size, .length = 0, .reserve_size = reserve_count, .reserved = 0};
+	anr_array arr = (anr_array){ANR_DS_DYNAMIC_ARRAY, .data = 0, .data_size = data_size, .length = 0, .reserve_size = reserve_count, .reserved = 0, .policy = policy, .allocator = allocator};
 	arr.reserved = reserve_count;
-	arr.data = malloc(arr.reserved*data_size);
+	arr.data = ANR__DATA_ALLOC(allocator, (size_t)arr.reserved*data_size);
 	if (!arr.data) {
-		arr.reserve_size = 1;
-		arr.data = malloc(arr.reserved*data_size); // Try again with smallest possible size.
+		arr.reserved = 1;
+		arr.data = ANR__DATA_ALLOC(allocator, (size_t)arr.reserved*data_size); // Try again with smallest possible size.
 		ANRDATA_ASSERT(arr.data);
 	}
 
 	return arr;
 }
 
+static uint8_t anr__array_set_capacity(anr_array* arr, uint32_t capacity)
+{
+	void* b = ANR__DATA_REALLOC(arr->allocator, arr->data, (size_t)arr->reserved*arr->data_size, (size_t)capacity*arr->data_size);
+	if (!b) return 0;
+	arr->data = b;
+	arr->reserved = capacity;
+	return 1;
+}
+
+// Grow to fit at least min_count entries, following the growth policy.
+static uint8_t anr__array_grow(anr_array* arr, uint32_t min_count)
+{
+	if (min_count <= arr->reserved) return 1;
+	uint64_t capacity = (uint64_t)(arr->reserved * arr->policy.growth_factor);
+	if (capacity < (uint64_t)arr->reserved + arr->reserve_size) capacity = (uint64_t)arr->reserved + arr->reserve_size;
+	if (capacity < min_count) capacity = min_count;
+	if (capacity > INT32_MAX) capacity = INT32_MAX;
+	if (capacity < min_count) return 0;
+	return anr__array_set_capacity(arr, (uint32_t)capacity);
+}
+
+// Halve capacity once length drops below the shrink threshold. Threshold is below 1/2 so
+// an add right after a shrink does not grow again.
+static void anr__array_shrink(anr_array* arr)
+{
+	if (arr->length >= arr->reserved * arr->policy.shrink_threshold) return;
+	uint32_t capacity = arr->reserved / 2;
+	if (capacity < arr->reserve_size) capacity = arr->reserve_size;
+	if (capacity < arr->length) capacity = arr->length;
+	if (capacity >= arr->reserved) return;
+	anr__array_set_capacity(arr, capacity);
+}
+
+uint8_t anr_array_reserve(void* ds, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_array* arr = (anr_array*)ds;
+	if (count <= arr->reserved) return 1;
+	return anr__array_set_capacity(arr, count);
+}
+
+void anr_array_shrink_to_fit(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_array* arr = (anr_array*)ds;
+	uint32_t capacity = arr->length ? arr->length : 1;
+	if (capacity < arr->reserved) anr__array_set_capacity(arr, capacity);
+}
+
 int32_t anr_array_add(void* ds, void* ptr)
 {
 	ANRDATA_ASSERT(ds);
@@ -618,16 +2022,9 @@ int32_t anr_array_add(void* ds, void* ptr)
 
 	anr_array* arr = (anr_array*)ds;
 
+	if (!anr__array_grow(arr, arr->length+1)) return -1;
+	memcpy(arr->data + ((size_t)arr->length * arr->data_size), ptr, arr->data_size);
 	arr->length++;
-	if (arr->reserved < arr->length)
-	{
-		arr->reserved += arr->reserve_size;
-		void* b = realloc(arr->data, arr->reserved*arr->data_size);
-		if (b) arr->data = b;
-		else return -1;
-	}
-
-	memcpy(arr->data + ((arr->length-1) * arr->data_size), ptr, arr->data_size);
 
 	return arr->length-1;
 }
@@ -637,7 +2034,7 @@ void anr_array_free(void* ds)
 	ANRDATA_ASSERT(ds);
 
 	anr_array* arr = (anr_array*)ds;
-	free(arr->data);
+	ANR__DATA_FREE(arr->allocator, arr->data);
 }
 
 #ifdef ANR_DATA_DEBUG
@@ -680,7 +2077,7 @@ void* anr_array_find_at(void* ds, uint32_t index)
 	anr_array* arr = ds;
 	if(index >= arr->length) return 0;
 
-	return arr->data + (index * arr->data_size);
+	return arr->data + ((size_t)index * arr->data_size);
 }
 
 uint32_t anr_array_find_by(void* ds, char* ptr)
@@ -688,16 +2085,7 @@ uint32_t anr_array_find_by(void* ds, char* ptr)
 	ANRDATA_ASSERT(ds);
 	ANRDATA_ASSERT(ptr);
 	anr_array* arr = (anr_array*)ds;
-
-	for (int i = 0; i < arr->length; i++)
-	{
-		void* data = anr_array_find_at(ds, i);
-		if (memcmp(data, ptr, arr->data_size) == 0) {
-			return i;
-		}
-	}
-
-	return -1;
+	return (uint32_t)anr__find_first(arr->data, arr->length, ptr, arr->data_size);
 }
 
 uint8_t anr_array_remove_at(void* ds, uint32_t index)
@@ -706,17 +2094,13 @@ uint8_t anr_array_remove_at(void* ds, uint32_t index)
 	anr_array* arr = (anr_array*)ds;
 	if (index >= arr->length) return 0;
 	if (index < 0) return 0;
-	uint32_t mem_to_move = (arr->length - index - 1) * arr->data_size;
-	uint32_t mem_to_overwrite = index * arr->data_size;
-	uint32_t mem_to_copy = (index+1) * arr->data_size;
+	size_t mem_to_move = (size_t)(arr->length - index - 1) * arr->data_size;
+	size_t mem_to_overwrite = (size_t)index * arr->data_size;
+	size_t mem_to_copy = (size_t)(index+1) * arr->data_size;
 	memmove(arr->data + mem_to_overwrite, arr->data + mem_to_copy, mem_to_move);
 	arr->length--;
 
-	if (arr->length < arr->reserved / 2) {
-		arr->reserved /= 2;
-		void* b = realloc(arr->data, arr->reserved*arr->data_size);
-		if (b) arr->data = b;
-	}
+	anr__array_shrink(arr);
 	return 1;
 }
 
@@ -744,21 +2128,14 @@ uint8_t anr_array_insert(void* ds, uint32_t index, void* ptr)
 	if (index > arr->length) return 0;
 	if (index < 0) return 0;
 
-	if (arr->length >= arr->reserved)
-	{
-		arr->reserved += arr->reserve_size;
-		void* b = realloc(arr->data, arr->reserved*arr->data_size);
-		if (b) arr->data = b;
-		else return 0;
-	}
-
-	if (index == arr->length) return anr_array_add(ds, ptr);
+	if (!anr__array_grow(arr, arr->length+1)) return 0;
+	if (index == arr->length) return anr_array_add(ds, ptr) != -1;
 
-	uint32_t mem_to_move = (arr->length - index) * arr->data_size;
-	uint32_t mem_to_overwrite = (index+1) * arr->data_size;
-	uint32_t mem_to_copy = (index) * arr->data_size;
+	size_t mem_to_move = (size_t)(arr->length - index) * arr->data_size;
+	size_t mem_to_overwrite = (size_t)(index+1) * arr->data_size;
+	size_t mem_to_copy = (size_t)index * arr->data_size;
 	memmove(arr->data + mem_to_overwrite, arr->data + mem_to_copy, mem_to_move);
-	memcpy(arr->data + index*arr->data_size, ptr, arr->data_size);
+	memcpy(arr->data + (size_t)index*arr->data_size, ptr, arr->data_size);
 	arr->length++;
 	return 1;
 }
@@ -787,77 +2164,454 @@ uint8_t anr_array_iter_next(void* ds, anr_iter* iter)
 	return iter->data != NULL;
 }
 
-anr_hashmap anr_hashmap_create(uint32_t data_size, uint32_t bucket_size)
+uint8_t anr_array_add_range(void* ds, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_array* arr = (anr_array*)ds;
+	return anr_array_insert_range(ds, arr->length, data, count);
+}
+
+uint8_t anr_array_insert_range(void* ds, uint32_t index, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_array* arr = (anr_array*)ds;
+	if (index > arr->length) return 0;
+	if (count == 0) return 1;
+	if ((uint64_t)arr->length + count > INT32_MAX) return 0;
+
+	if (!anr__array_grow(arr, arr->length+count)) return 0;
+	size_t mem_to_move = (size_t)(arr->length - index) * arr->data_size;
+	memmove(arr->data + (size_t)(index+count)*arr->data_size, arr->data + (size_t)index*arr->data_size, mem_to_move);
+	memcpy(arr->data + (size_t)index*arr->data_size, data, (size_t)count*arr->data_size);
+	arr->length += count;
+	return 1;
+}
+
+uint8_t anr_array_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_array* arr = (anr_array*)ds;
+	if ((uint64_t)index + count > (uint64_t)arr->length) return 0;
+	if (count == 0) return 1;
+
+	size_t mem_to_move = (size_t)(arr->length - index - count) * arr->data_size;
+	memmove(arr->data + (size_t)index*arr->data_size, arr->data + (size_t)(index+count)*arr->data_size, mem_to_move);
+	arr->length -= count;
+
+	anr__array_shrink(arr);
+	return 1;
+}
+
+// Kept entries are moved down a run at a time, runs before the first removed entry dont move.
+uint32_t anr_array_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(predicate);
+	anr_array* arr = (anr_array*)ds;
+	uint8_t* data = arr->data;
+	size_t size = arr->data_size;
+	uint32_t write = 0;
+	uint32_t run_start = 0;
+
+	for (uint32_t i = 0; i < (uint32_t)arr->length; i++)
+	{
+		if (!predicate(data + i*size, ctx)) continue;
+		if (run_start != write) memmove(data + write*size, data + run_start*size, (i - run_start)*size);
+		write += i - run_start;
+		run_start = i+1;
+	}
+	if (run_start == 0) return 0;
+	if (run_start != write) memmove(data + write*size, data + run_start*size, (arr->length - run_start)*size);
+	write += arr->length - run_start;
+
+	uint32_t removed = arr->length - write;
+	arr->length = write;
+	anr__array_shrink(arr);
+	return removed;
+}
+
+static void* anr__small_alloc(void* ctx, size_t size)
+{
+	anr_small_storage* small = ctx;
+	return ANR__DATA_ALLOC(small->parent, size);
+}
+
+static void* anr__small_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+	anr_small_storage* small = ctx;
+	size_t keep = old_size < new_size ? old_size : new_size;
+	if (ptr == small->storage)
+	{
+		if (new_size <= small->storage_size) return ptr;
+		void* heap = ANR__DATA_ALLOC(small->parent, new_size);
+		if (heap) memcpy(heap, ptr, keep);
+		return heap;
+	}
+	if (new_size <= small->storage_size) {
+		// Shrunk back to fit, the entries move into storage again.
+		memcpy(small->storage, ptr, keep);
+		ANR__DATA_FREE(small->parent, ptr);
+		return small->storage;
+	}
+	return ANR__DATA_REALLOC(small->parent, ptr, old_size, new_size);
+}
+
+static void anr__small_free(void* ctx, void* ptr)
 {
+	anr_small_storage* small = ctx;
+	if (ptr != small->storage) ANR__DATA_FREE(small->parent, ptr);
+}
+
+void anr_array_init_small(anr_array* arr, anr_small_storage* small, uint32_t data_size, void* storage, uint32_t capacity, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(arr && small && storage);
 	ANRDATA_ASSERT(data_size > 0);
-	ANRDATA_ASSERT(bucket_size > 0);
-	anr_hashmap hashmap = (anr_hashmap){.ds_type = ANR_DS_HASHMAP, .bucket_size = bucket_size, .data_size = data_size};
-	hashmap.buckets = anr_array_create(sizeof(anr_hashmap_bucket), 1);
-	hashmap.last_emptied = -1;
-	hashmap.next_empty = -1;
-	return hashmap;
+	ANRDATA_ASSERT(capacity > 0);
+	*small = (anr_small_storage){{anr__small_alloc, anr__small_realloc, anr__small_free, small}, allocator, storage, (size_t)capacity*data_size};
+	*arr = (anr_array){ANR_DS_DYNAMIC_ARRAY, .data = storage, .data_size = data_size, .length = 0, .reserve_size = capacity, .reserved = capacity, .policy = ANR_ARRAY_POLICY_DEFAULT, .allocator = &small->allocator};
 }
 
-int32_t anr_hashmap_add(void* ds, void* ptr)
+void anr_array_sort(void* ds, anr_compare_func compare)
 {
 	ANRDATA_ASSERT(ds);
-	ANRDATA_ASSERT(ptr);
-	anr_hashmap* hashmap = (anr_hashmap*)ds;
-	uint32_t item_size = hashmap->data_size + 1;
+	ANRDATA_ASSERT(compare);
+	anr_array* arr = (anr_array*)ds;
+	if (arr->length > 1) qsort(arr->data, arr->length, arr->data_size, compare);
+}
 
-	if (hashmap->last_emptied != -1) {
-		int32_t index = hashmap->last_emptied;
-		anr_hashmap_insert(ds, index, ptr);
-		return index;
+// Key bits in an order where unsigned compare matches the key compare.
+static uint64_t anr__radix_key(const uint8_t* ptr, anr_key_type key_type)
+{
+	if (key_type <= ANR_KEY_F32)
+	{
+		uint32_t key;
+		memcpy(&key, ptr, sizeof(key));
+		if (key_type == ANR_KEY_I32) return key ^ 0x80000000u;
+		if (key_type == ANR_KEY_F32) return key ^ ((key >> 31) ? 0xFFFFFFFFu : 0x80000000u); // Negative floats count down.
+		return key;
 	}
-	if (hashmap->next_empty != -1) {
-		int32_t index = hashmap->next_empty;
-		anr_hashmap_insert(ds, index, ptr);
-		return index;
+	uint64_t key;
+	memcpy(&key, ptr, sizeof(key));
+	if (key_type == ANR_KEY_I64) return key ^ 0x8000000000000000ull;
+	if (key_type == ANR_KEY_F64) return key ^ ((key >> 63) ? ~0ull : 0x8000000000000000ull);
+	return key;
+}
+
+// Constant sizes let the compiler turn the entry copy into a few moves.
+#define ANR__RADIX_SCATTER(_size) \
+	for (uint32_t i = 0; i < n; i++) \
+	{ \
+		const uint8_t* entry = src + (size_t)i*(_size); \
+		uint32_t digit = (anr__radix_key(entry + key_offset, key_type) >> shift) & 0xFF; \
+		memcpy(dst + (size_t)offsets[digit]++*(_size), entry, _size); \
 	}
 
-	uint32_t highest_bucket_start = 0;
-	ANR_ITERATE(iter, &hashmap->buckets)
+uint8_t anr_array_sort_by_key(void* ds, uint32_t key_offset, anr_key_type key_type)
+{
+	ANRDATA_ASSERT(ds);
+	anr_array* arr = (anr_array*)ds;
+	uint32_t key_bytes = key_type <= ANR_KEY_F32 ? 4 : 8;
+	uint32_t size = arr->data_size;
+	ANRDATA_ASSERT(key_offset + key_bytes <= size);
+	uint32_t n = arr->length;
+	if (n < 2) return 1;
+
+	// All digit counts in one read pass.
+	uint32_t counts[8][256] = {0};
+	for (uint32_t i = 0; i < n; i++)
 	{
-		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter.data;
-		if (bb->bucket_start > highest_bucket_start) highest_bucket_start = bb->bucket_start;
-		for (int i = 0; i < hashmap->bucket_size; i++)
+		uint64_t key = anr__radix_key((uint8_t*)arr->data + (size_t)i*size + key_offset, key_type);
+		for (uint32_t b = 0; b < key_bytes; b++) counts[b][(key >> (b*8)) & 0xFF]++;
+	}
+
+	uint8_t* scratch = ANR__DATA_ALLOC(arr->allocator, (size_t)n*size);
+	if (!scratch) return 0;
+	uint8_t* src = arr->data;
+	uint8_t* dst = scratch;
+	uint64_t first_key = anr__radix_key(src + key_offset, key_type);
+	for (uint32_t b = 0; b < key_bytes; b++)
+	{
+		uint32_t shift = b*8;
+		if (counts[b][(first_key >> shift) & 0xFF] == n) continue; // Every key has the same byte here.
+
+		uint32_t offsets[256];
+		uint32_t sum = 0;
+		for (uint32_t d = 0; d < 256; d++)
 		{
-			char* data = bb->data + (i * item_size);
-			if (data[0] == 1) continue;
-			memcpy(data+1, ptr, hashmap->data_size);
-			data[0] = 1;
-			hashmap->length++;
-			bb->length++;
-
-			// Check if next slot is empty.
-			int32_t next_index = i+1;
-			if (next_index < hashmap->bucket_size) {
-				char* data = bb->data + (next_index * item_size);
-				if (data[0] == 0) hashmap->next_empty = next_index;
-			}
+			offsets[d] = sum;
+			sum += counts[b][d];
+		}
 
-			return bb->bucket_start + i;
+		switch (size)
+		{
+			case 4: ANR__RADIX_SCATTER(4); break;
+			case 8: ANR__RADIX_SCATTER(8); break;
+			case 16: ANR__RADIX_SCATTER(16); break;
+			default: ANR__RADIX_SCATTER(size); break;
 		}
+		uint8_t* swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != arr->data) memcpy(arr->data, src, (size_t)n*size);
+	ANR__DATA_FREE(arr->allocator, scratch);
+	return 1;
+}
+#undef ANR__RADIX_SCATTER
+
+#define ANR__HASHMAP_MASK_WORDS(_bucket_size) (((_bucket_size) + 63) / 64)
+#define ANR__HASHMAP_SUMMARY_WORDS(_bucket_size) ((ANR__HASHMAP_MASK_WORDS(_bucket_size) + 63) / 64)
+#define ANR__HASHMAP_SLOT_USED(_bb, _i) (((_bb)->occupied[(_i) >> 6] >> ((_i) & 63)) & 1)
+
+// Returns the directory entry for bucket_nr, allocates the page when create is set.
+static uint32_t* anr__hashmap_directory_entry(anr_hashmap* hashmap, uint32_t bucket_nr, uint8_t create)
+{
+	uint32_t page = bucket_nr >> ANR_HASHMAP_DIRECTORY_PAGE_BITS;
+	if (page >= hashmap->directory_length)
+	{
+		if (!create) return 0;
+		uint32_t new_length = hashmap->directory_length*2;
+		if (new_length <= page) new_length = page+1;
+		uint32_t** b = ANR__DATA_REALLOC(hashmap->allocator, hashmap->directory, hashmap->directory_length*sizeof(uint32_t*), new_length*sizeof(uint32_t*));
+		if (!b) return 0;
+		memset(b + hashmap->directory_length, 0, (new_length - hashmap->directory_length)*sizeof(uint32_t*));
+		hashmap->directory = b;
+		hashmap->directory_length = new_length;
+	}
+	if (!hashmap->directory[page])
+	{
+		if (!create) return 0;
+		hashmap->directory[page] = ANR__DATA_ALLOC(hashmap->allocator, ANR_HASHMAP_DIRECTORY_PAGE_SIZE*sizeof(uint32_t));
+		if (!hashmap->directory[page]) return 0;
+		memset(hashmap->directory[page], 0, ANR_HASHMAP_DIRECTORY_PAGE_SIZE*sizeof(uint32_t));
+	}
+	return &hashmap->directory[page][bucket_nr & (ANR_HASHMAP_DIRECTORY_PAGE_SIZE-1)];
+}
+
+static anr_hashmap_bucket* anr__hashmap_find_bucket(anr_hashmap* hashmap, uint32_t index)
+{
+	uint32_t* entry = anr__hashmap_directory_entry(hashmap, index / hashmap->bucket_size, 0);
+	if (!entry || *entry == 0 || (*entry & ANR__HASHMAP_RELEASED)) return 0;
+	return anr_array_find_at(&hashmap->buckets, *entry - 1);
+}
+
+// Can not fail, create_bucket keeps room in open_buckets for every bucket.
+static void anr__hashmap_open_bucket(anr_hashmap* hashmap, anr_hashmap_bucket* bucket)
+{
+	uint32_t bucket_nr = bucket->bucket_start / hashmap->bucket_size;
+	int32_t position = anr_array_add(&hashmap->open_buckets, &bucket_nr);
+	ANRDATA_ASSERT(position != -1);
+	bucket->open_position = position + 1;
+}
+
+static void anr__hashmap_close_bucket(anr_hashmap* hashmap, anr_hashmap_bucket* bucket)
+{
+	uint32_t position = bucket->open_position - 1;
+	uint32_t last = hashmap->open_buckets.length - 1;
+	if (position != last) {
+		uint32_t moved_nr = *(uint32_t*)anr_array_find_at(&hashmap->open_buckets, last);
+		*(uint32_t*)anr_array_find_at(&hashmap->open_buckets, position) = moved_nr;
+		anr__hashmap_find_bucket(hashmap, moved_nr * hashmap->bucket_size)->open_position = position + 1;
+	}
+	anr_array_remove_at(&hashmap->open_buckets, last);
+	bucket->open_position = 0;
+}
+
+// Takes a released bucket off the free list, the last number moves into its position.
+static void anr__hashmap_unrelease_bucket(anr_hashmap* hashmap, uint32_t* entry)
+{
+	uint32_t position = *entry & ~ANR__HASHMAP_RELEASED;
+	uint32_t last = hashmap->free_buckets.length - 1;
+	if (position != last) {
+		uint32_t moved_nr = *(uint32_t*)anr_array_find_at(&hashmap->free_buckets, last);
+		*(uint32_t*)anr_array_find_at(&hashmap->free_buckets, position) = moved_nr;
+		*anr__hashmap_directory_entry(hashmap, moved_nr, 0) = ANR__HASHMAP_RELEASED | position;
 	}
+	anr_array_remove_at(&hashmap->free_buckets, last);
+	*entry = 0;
+}
 
-	// All buckets are full, create new one.
+static anr_hashmap_bucket* anr__hashmap_create_bucket(anr_hashmap* hashmap, uint32_t bucket_start)
+{
+	uint32_t bucket_nr = bucket_start / hashmap->bucket_size;
+	uint32_t* entry = anr__hashmap_directory_entry(hashmap, bucket_nr, 1);
+	if (!entry) return 0;
+	uint32_t open_needed = hashmap->buckets.length + 1;
+	if (open_needed > (uint32_t)hashmap->open_buckets.reserved && !anr_array_reserve(&hashmap->open_buckets, open_needed * 2)) return 0;
+
+	// Occupancy mask, summary mask and data share one allocation.
+	uint32_t mask_words = ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size);
+	uint32_t summary_words = ANR__HASHMAP_SUMMARY_WORDS(hashmap->bucket_size);
+	uint32_t mask_size = (mask_words + summary_words) * sizeof(uint64_t);
 	anr_hashmap_bucket new_bucket;
-	new_bucket.bucket_start = highest_bucket_start;
+	new_bucket.bucket_start = bucket_start;
 	new_bucket.length = 0;
-	uint32_t alloc_size = (hashmap->bucket_size * hashmap->data_size) + hashmap->bucket_size;
-	new_bucket.data = malloc(alloc_size);
-	if (!new_bucket.data) return -1;
-	memset(new_bucket.data, 0, alloc_size);
-	uint32_t bucket_index = anr_array_add(&hashmap->buckets, &new_bucket);
-	if (bucket_index == -1) return -1;
+	new_bucket.open_position = 0;
+	new_bucket.occupied = ANR__DATA_ALLOC(hashmap->allocator, mask_size + ((size_t)hashmap->bucket_size * hashmap->data_size));
+	if (!new_bucket.occupied) return 0;
+	memset(new_bucket.occupied, 0, mask_size);
+	new_bucket.data = (uint8_t*)new_bucket.occupied + mask_size;
+
+	// Summary bits past the last mask word are marked full so they are never picked.
+	if (mask_words % 64) new_bucket.occupied[mask_words + summary_words - 1] = ~0ULL << (mask_words % 64);
+
+	int32_t bucket_index = anr_array_add(&hashmap->buckets, &new_bucket);
+	if (bucket_index == -1) {
+		ANR__DATA_FREE(hashmap->allocator, new_bucket.occupied);
+		return 0;
+	}
+	if (*entry & ANR__HASHMAP_RELEASED) anr__hashmap_unrelease_bucket(hashmap, entry);
+	*entry = bucket_index + 1;
+	if (bucket_nr >= hashmap->next_bucket) hashmap->next_bucket = bucket_nr + 1;
+
 	anr_hashmap_bucket* bucket = anr_array_find_at(&hashmap->buckets, bucket_index);
-	hashmap->next_empty = new_bucket.bucket_start+1; // Bucket was just created so were sure its empty.
-	hashmap->length++;
-	char* data = bucket->data + (0 * item_size);
-	memcpy(data+1, ptr, hashmap->data_size);
-	data[0] = 1;
-	return new_bucket.bucket_start;
+	anr__hashmap_open_bucket(hashmap, bucket);
+	return bucket;
+}
+
+// Swap the last bucket into the removed position so the bucket list stays dense.
+static void anr__hashmap_remove_bucket(anr_hashmap* hashmap, anr_hashmap_bucket* bucket)
+{
+	uint32_t bucket_nr = bucket->bucket_start / hashmap->bucket_size;
+	if (bucket->open_position) anr__hashmap_close_bucket(hashmap, bucket);
+
+	// Without room on the free list the number is only lost for reuse, next_bucket still moves on.
+	int32_t free_position = anr_array_add(&hashmap->free_buckets, &bucket_nr);
+	uint32_t position = bucket - (anr_hashmap_bucket*)hashmap->buckets.data;
+	uint32_t last = hashmap->buckets.length - 1;
+	*anr__hashmap_directory_entry(hashmap, bucket_nr, 0) = free_position == -1 ? 0 : ANR__HASHMAP_RELEASED | free_position;
+	ANR__DATA_FREE(hashmap->allocator, bucket->occupied);
+
+	if (position != last) {
+		anr_hashmap_bucket* moved = anr_array_find_at(&hashmap->buckets, last);
+		*bucket = *moved;
+		*anr__hashmap_directory_entry(hashmap, moved->bucket_start / hashmap->bucket_size, 0) = position + 1;
+	}
+	anr_array_remove_at(&hashmap->buckets, last);
+}
+
+// Bits past bucket_size in the last mask word.
+static uint64_t anr__hashmap_word_padding(anr_hashmap* hashmap, uint32_t word)
+{
+	if (word == ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size)-1 && hashmap->bucket_size % 64) {
+		return ~0ULL << (hashmap->bucket_size % 64);
+	}
+	return 0;
+}
+
+// A mask word is full when all its slots below bucket_size are used.
+static uint8_t anr__hashmap_word_full(anr_hashmap* hashmap, anr_hashmap_bucket* bucket, uint32_t word)
+{
+	return (bucket->occupied[word] | anr__hashmap_word_padding(hashmap, word)) == ~0ULL;
+}
+
+// Mark the slots in bits of mask word as used, bits must be free slots.
+static void anr__hashmap_set_slots(anr_hashmap* hashmap, anr_hashmap_bucket* bucket, uint32_t word, uint64_t bits)
+{
+	if (!bits) return;
+	uint64_t* summary = bucket->occupied + ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size);
+	uint32_t count = anr__popcount64(bits);
+	bucket->occupied[word] |= bits;
+	if (anr__hashmap_word_full(hashmap, bucket, word)) summary[word >> 6] |= 1ULL << (word & 63);
+	bucket->length += count;
+	hashmap->length += count;
+	if (bucket->length == hashmap->bucket_size && bucket->open_position) anr__hashmap_close_bucket(hashmap, bucket);
+}
+
+// Mark the slots in bits of mask word as free, bits must be used slots.
+static void anr__hashmap_clear_slots(anr_hashmap* hashmap, anr_hashmap_bucket* bucket, uint32_t word, uint64_t bits)
+{
+	if (!bits) return;
+	uint64_t* summary = bucket->occupied + ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size);
+	uint32_t count = anr__popcount64(bits);
+	if (bucket->length == hashmap->bucket_size) anr__hashmap_open_bucket(hashmap, bucket);
+	bucket->occupied[word] &= ~bits;
+	summary[word >> 6] &= ~(1ULL << (word & 63));
+	bucket->length -= count;
+	hashmap->length -= count;
+}
+
+static void anr__hashmap_set_slot(anr_hashmap* hashmap, anr_hashmap_bucket* bucket, uint32_t slot)
+{
+	anr__hashmap_set_slots(hashmap, bucket, slot >> 6, 1ULL << (slot & 63));
+}
+
+static void anr__hashmap_clear_slot(anr_hashmap* hashmap, anr_hashmap_bucket* bucket, uint32_t slot)
+{
+	anr__hashmap_clear_slots(hashmap, bucket, slot >> 6, 1ULL << (slot & 63));
+}
+
+// Bits for slots from..to-1 of one mask word, from < to <= from/64*64 + 64.
+static uint64_t anr__hashmap_range_bits(uint32_t from, uint32_t to)
+{
+	uint32_t count = to - from;
+	return (count == 64 ? ~0ULL : ((1ULL << count) - 1)) << (from & 63);
+}
+
+// First free slot through the summary mask, bucket is assumed to have one.
+static uint32_t anr__hashmap_find_free_slot(anr_hashmap* hashmap, anr_hashmap_bucket* bucket)
+{
+	uint64_t* summary = bucket->occupied + ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size);
+	for (uint32_t s = 0; s < ANR__HASHMAP_SUMMARY_WORDS(hashmap->bucket_size); s++)
+	{
+		if (summary[s] == ~0ULL) continue;
+		uint32_t word = s*64 + anr__ctz64(~summary[s]);
+		return word*64 + anr__ctz64(~bucket->occupied[word]);
+	}
+	ANRDATA_ASSERT(0);
+	return 0;
+}
+
+anr_hashmap anr_hashmap_create(uint32_t data_size, uint32_t bucket_size)
+{
+	return anr_hashmap_create_ex(data_size, bucket_size, NULL);
+}
+
+anr_hashmap anr_hashmap_create_ex(uint32_t data_size, uint32_t bucket_size, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	ANRDATA_ASSERT(bucket_size > 0);
+	anr_hashmap hashmap = (anr_hashmap){.ds_type = ANR_DS_HASHMAP, .bucket_size = bucket_size, .data_size = data_size, .allocator = allocator};
+	hashmap.buckets = anr_array_create_ex(sizeof(anr_hashmap_bucket), 1, ANR_ARRAY_POLICY_DEFAULT, allocator);
+	hashmap.open_buckets = anr_array_create_ex(sizeof(uint32_t), 1, (anr_array_policy){2.0f, 0.0f}, allocator); // Never shrinks, see anr__hashmap_open_bucket.
+	hashmap.free_buckets = anr_array_create_ex(sizeof(uint32_t), 1, ANR_ARRAY_POLICY_DEFAULT, allocator);
+	hashmap.directory = NULL;
+	hashmap.directory_length = 0;
+	hashmap.next_bucket = 0;
+	return hashmap;
+}
+
+// Bucket with at least one free slot for add, creates one when all buckets are full.
+static anr_hashmap_bucket* anr__hashmap_add_bucket(anr_hashmap* hashmap)
+{
+	if (hashmap->open_buckets.length) {
+		uint32_t bucket_nr = *(uint32_t*)anr_array_find_at(&hashmap->open_buckets, hashmap->open_buckets.length-1);
+		return anr__hashmap_find_bucket(hashmap, bucket_nr * hashmap->bucket_size);
+	}
+
+	// All buckets are full, reuse a released bucket number or take the next one. Creating it takes it off the free list.
+	uint32_t bucket_nr = hashmap->next_bucket;
+	if (hashmap->free_buckets.length) {
+		bucket_nr = *(uint32_t*)anr_array_find_at(&hashmap->free_buckets, hashmap->free_buckets.length-1);
+	}
+	if ((uint64_t)bucket_nr * hashmap->bucket_size >= UINT32_MAX) return 0;
+	return anr__hashmap_create_bucket(hashmap, bucket_nr * hashmap->bucket_size);
+}
+
+int32_t anr_hashmap_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_hashmap* hashmap = (anr_hashmap*)ds;
+	anr_hashmap_bucket* bucket = anr__hashmap_add_bucket(hashmap);
+	if (!bucket) return -1;
+
+	uint32_t slot = anr__hashmap_find_free_slot(hashmap, bucket);
+	uint32_t index = bucket->bucket_start + slot;
+	memcpy((uint8_t*)bucket->data + ((size_t)slot * hashmap->data_size), ptr, hashmap->data_size);
+	anr__hashmap_set_slot(hashmap, bucket, slot);
+	return index;
 }
 
 void anr_hashmap_free(void* ds)
@@ -867,9 +2621,16 @@ void anr_hashmap_free(void* ds)
 	ANR_ITERATE(iter, &hashmap->buckets)
 	{
 		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter.data;
-		free(bb->data);
+		ANR__DATA_FREE(hashmap->allocator, bb->occupied);
 	}
 	ANR_DS_FREE(&hashmap->buckets);
+	ANR_DS_FREE(&hashmap->open_buckets);
+	ANR_DS_FREE(&hashmap->free_buckets);
+
+	for (uint32_t i = 0; i < hashmap->directory_length; i++) {
+		if (hashmap->directory[i]) ANR__DATA_FREE(hashmap->allocator, hashmap->directory[i]);
+	}
+	if (hashmap->directory) ANR__DATA_FREE(hashmap->allocator, hashmap->directory);
 }
 
 void anr_hashmap_print(void* ds)
@@ -891,21 +2652,12 @@ void* anr_hashmap_find_at(void* ds, uint32_t index)
 	ANRDATA_ASSERT(ds);
 	
 	anr_hashmap* hashmap = (anr_hashmap*)ds;
+	anr_hashmap_bucket* bb = anr__hashmap_find_bucket(hashmap, index);
+	if (!bb) return 0;
 
-	int bucket_start = (index / hashmap->bucket_size) * hashmap->bucket_size;
-	int inner_index = index % hashmap->bucket_size;
-	uint32_t item_size = hashmap->data_size + 1;
-
-	ANR_ITERATE(iter, &hashmap->buckets)
-	{
-		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter.data;
-		if (bb->bucket_start == bucket_start) {
-			char* data = bb->data + (inner_index * item_size);
-			if (data[0] == 1) return data+1;
-			
-		}
-	}
-	return 0;
+	uint32_t inner_index = index % hashmap->bucket_size;
+	if (!ANR__HASHMAP_SLOT_USED(bb, inner_index)) return 0;
+	return (uint8_t*)bb->data + ((size_t)inner_index * hashmap->data_size);
 }
 
 uint32_t anr_hashmap_find_by(void* ds, char* ptr)
@@ -913,17 +2665,18 @@ uint32_t anr_hashmap_find_by(void* ds, char* ptr)
 	ANRDATA_ASSERT(ds);
 	if (ptr == NULL) return -1;
 	anr_hashmap* hashmap = (anr_hashmap*)ds;
-	uint32_t item_size = hashmap->data_size + 1;
 
-	ANR_ITERATE(iter, &hashmap->buckets)
+	for (int32_t b = 0; b < hashmap->buckets.length; b++)
 	{
-		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter.data;
-		for (int i = 0; i < hashmap->bucket_size; i++)
+		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)hashmap->buckets.data + b;
+		for (uint32_t w = 0; w < ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size); w++)
 		{
-			char* data = bb->data + (i * item_size);
-			if (data[0] == 1) {
-				if (memcmp(data+1, ptr, hashmap->data_size) == 0) return bb->bucket_start + i;
-			}
+			// Compare 64 slots at once, matches in empty slots are masked out.
+			if (!bb->occupied[w]) continue;
+			uint32_t count = hashmap->bucket_size - w*64 < 64 ? hashmap->bucket_size - w*64 : 64;
+			uint64_t match = anr__match_block((uint8_t*)bb->data + ((size_t)w*64 * hashmap->data_size), count, ptr, hashmap->data_size);
+			match &= bb->occupied[w];
+			if (match) return bb->bucket_start + w*64 + anr__ctz64(match);
 		}
 	}
 
@@ -934,30 +2687,17 @@ uint8_t anr_hashmap_remove_at(void* ds, uint32_t index)
 {
 	ANRDATA_ASSERT(ds);
 	anr_hashmap* hashmap = (anr_hashmap*)ds;
+	anr_hashmap_bucket* bb = anr__hashmap_find_bucket(hashmap, index);
+	if (!bb) return 0;
 
-	int bucket_start = (index / hashmap->bucket_size) * hashmap->bucket_size;
-	int inner_index = index % hashmap->bucket_size;
+	uint32_t inner_index = index % hashmap->bucket_size;
+	if (!ANR__HASHMAP_SLOT_USED(bb, inner_index)) return 0;
 
-	ANR_ITERATE(iter, &hashmap->buckets)
-	{
-		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter.data;
-		if (bb->bucket_start == bucket_start) {
-			uint32_t item_size = hashmap->data_size + 1;
-			char* data = bb->data + (inner_index * item_size);
-			if (data[0] == 1) {
-				data[0] = 0;
-				hashmap->length--;
-				bb->length--;
-				hashmap->last_emptied = index;
-
-				if (bb->length == 0) {
-					ANR_DS_REMOVE_AT(&hashmap->buckets, iter.index);
-				}
-				return 1;
-			}
-		}
+	anr__hashmap_clear_slot(hashmap, bb, inner_index);
+	if (bb->length == 0) {
+		anr__hashmap_remove_bucket(hashmap, bb);
 	}
-	return 0;
+	return 1;
 }
 
 uint8_t anr_hashmap_remove_by(void* ds, void* ptr)
@@ -965,17 +2705,16 @@ uint8_t anr_hashmap_remove_by(void* ds, void* ptr)
 	ANRDATA_ASSERT(ds);
 	if (!ptr) return 0;
 	anr_hashmap* hashmap = (anr_hashmap*)ds;
-	uint32_t item_size = hashmap->data_size + 1;
 
-	ANR_ITERATE(iter, &hashmap->buckets)
+	for (int32_t b = 0; b < hashmap->buckets.length; b++)
 	{
-		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter.data;
-		void* bucket_start = bb->data;
-		void* bucket_end = bb->data + (hashmap->bucket_size*item_size);
+		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)hashmap->buckets.data + b;
+		uint8_t* bucket_start = bb->data;
+		uint8_t* bucket_end = bucket_start + ((size_t)hashmap->bucket_size * hashmap->data_size);
 
-		if (ptr >= bucket_start && ptr <= bucket_end)
+		if ((uint8_t*)ptr >= bucket_start && (uint8_t*)ptr < bucket_end)
 		{
-			return anr_hashmap_remove_at(ds, bb->bucket_start + ((ptr - bucket_start) / item_size));
+			return anr_hashmap_remove_at(ds, bb->bucket_start + (((uint8_t*)ptr - bucket_start) / hashmap->data_size));
 		}
 	}
 
@@ -988,49 +2727,144 @@ uint8_t anr_hashmap_insert(void* ds, uint32_t index, void* ptr)
 	ANRDATA_ASSERT(ptr);
 	anr_hashmap* hashmap = (anr_hashmap*)ds;
 
-	int bucket_start = (index / hashmap->bucket_size) * hashmap->bucket_size;
-	int inner_index = index % hashmap->bucket_size;
+	uint32_t bucket_start = (index / hashmap->bucket_size) * hashmap->bucket_size;
+	uint32_t inner_index = index % hashmap->bucket_size;
 
-	if (hashmap->last_emptied == index) {
-		hashmap->last_emptied = -1;
-	}
-	if (hashmap->next_empty == index) {
-		hashmap->next_empty = -1;
+	anr_hashmap_bucket* bucket = anr__hashmap_find_bucket(hashmap, index);
+	if (!bucket) {
+		// Bucket does not exist yet. create one.
+		bucket = anr__hashmap_create_bucket(hashmap, bucket_start);
+		if (!bucket) return 0;
 	}
 
-	anr_hashmap_bucket* bucket = NULL;
-	ANR_ITERATE(iter, &hashmap->buckets)
+	memcpy((uint8_t*)bucket->data + ((size_t)inner_index * hashmap->data_size), ptr, hashmap->data_size);
+	if (!ANR__HASHMAP_SLOT_USED(bucket, inner_index)) {
+		anr__hashmap_set_slot(hashmap, bucket, inner_index);
+	}
+	return 1;
+}
+
+uint8_t anr_hashmap_add_range(void* ds, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_hashmap* hashmap = (anr_hashmap*)ds;
+	uint8_t* src = data;
+
+	while (count)
 	{
-		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter.data;
-		if (bb->bucket_start == bucket_start) {
-			bucket = bb;
-			break;
+		anr_hashmap_bucket* bucket = anr__hashmap_add_bucket(hashmap);
+		if (!bucket) return 0;
+
+		// Fill the free slots of each mask word, then mark them used at once.
+		for (uint32_t w = 0; w < ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size) && count; w++)
+		{
+			uint64_t free_slots = ~(bucket->occupied[w] | anr__hashmap_word_padding(hashmap, w));
+			uint64_t bits = 0;
+			while (free_slots && count)
+			{
+				uint32_t slot = w*64 + anr__ctz64(free_slots);
+				memcpy((uint8_t*)bucket->data + ((size_t)slot * hashmap->data_size), src, hashmap->data_size);
+				src += hashmap->data_size;
+				count--;
+				bits |= free_slots & (~free_slots + 1);
+				free_slots &= free_slots - 1;
+			}
+			anr__hashmap_set_slots(hashmap, bucket, w, bits);
 		}
 	}
+	return 1;
+}
 
-	if (!bucket) {
-		// Bucket does not exist yet. create one.
-		anr_hashmap_bucket new_bucket;
-		new_bucket.bucket_start = bucket_start;
-		new_bucket.length = 0;
-		uint32_t alloc_size = (hashmap->bucket_size * hashmap->data_size) + hashmap->bucket_size;
-		new_bucket.data = malloc(alloc_size);
-		if (!new_bucket.data) return 0;
-		memset(new_bucket.data, 0, alloc_size);
-		int32_t bucket_index = anr_array_add(&hashmap->buckets, &new_bucket);
-		if (bucket_index == -1) return 0;
-		bucket = anr_array_find_at(&hashmap->buckets, bucket_index);
-	}
-
-	uint32_t item_size = hashmap->data_size + 1;
-	hashmap->length++;
-	bucket->length++;
-	char* data = bucket->data + (inner_index * item_size);
-	data[0] = 1;
-	memcpy(data+1, ptr, hashmap->data_size);
+uint8_t anr_hashmap_insert_range(void* ds, uint32_t index, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_hashmap* hashmap = (anr_hashmap*)ds;
+	if ((uint64_t)index + count > UINT32_MAX) return 0;
+	uint8_t* src = data;
+
+	while (count)
+	{
+		uint32_t inner_index = index % hashmap->bucket_size;
+		uint32_t bucket_count = hashmap->bucket_size - inner_index < count ? hashmap->bucket_size - inner_index : count;
+		anr_hashmap_bucket* bucket = anr__hashmap_find_bucket(hashmap, index);
+		if (!bucket) {
+			bucket = anr__hashmap_create_bucket(hashmap, index - inner_index);
+			if (!bucket) return 0;
+		}
+
+		memcpy((uint8_t*)bucket->data + ((size_t)inner_index * hashmap->data_size), src, (size_t)bucket_count * hashmap->data_size);
+		for (uint32_t slot = inner_index; slot < inner_index + bucket_count;)
+		{
+			uint32_t end = (slot | 63) + 1 < inner_index + bucket_count ? (slot | 63) + 1 : inner_index + bucket_count;
+			anr__hashmap_set_slots(hashmap, bucket, slot >> 6, anr__hashmap_range_bits(slot, end) & ~bucket->occupied[slot >> 6]);
+			slot = end;
+		}
+
+		src += (size_t)bucket_count * hashmap->data_size;
+		index += bucket_count;
+		count -= bucket_count;
+	}
+	return 1;
+}
+
+uint8_t anr_hashmap_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_hashmap* hashmap = (anr_hashmap*)ds;
+	if ((uint64_t)index + count > UINT32_MAX) return 0;
+
+	while (count)
+	{
+		uint32_t inner_index = index % hashmap->bucket_size;
+		uint32_t bucket_count = hashmap->bucket_size - inner_index < count ? hashmap->bucket_size - inner_index : count;
+		anr_hashmap_bucket* bucket = anr__hashmap_find_bucket(hashmap, index);
+		if (bucket) {
+			for (uint32_t slot = inner_index; slot < inner_index + bucket_count;)
+			{
+				uint32_t end = (slot | 63) + 1 < inner_index + bucket_count ? (slot | 63) + 1 : inner_index + bucket_count;
+				anr__hashmap_clear_slots(hashmap, bucket, slot >> 6, anr__hashmap_range_bits(slot, end) & bucket->occupied[slot >> 6]);
+				slot = end;
+			}
+			if (bucket->length == 0) anr__hashmap_remove_bucket(hashmap, bucket);
+		}
+
+		index += bucket_count;
+		count -= bucket_count;
+	}
 	return 1;
 }
 
+uint32_t anr_hashmap_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(predicate);
+	anr_hashmap* hashmap = (anr_hashmap*)ds;
+	uint32_t removed = 0;
+
+	// Walk backwards, removing an empty bucket moves the last bucket into its position.
+	for (int32_t b = hashmap->buckets.length-1; b >= 0; b--)
+	{
+		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)hashmap->buckets.data + b;
+		for (uint32_t w = 0; w < ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size); w++)
+		{
+			uint64_t mask = bb->occupied[w];
+			uint64_t bits = 0;
+			while (mask)
+			{
+				uint32_t i = anr__ctz64(mask);
+				if (predicate((uint8_t*)bb->data + ((size_t)(w*64 + i) * hashmap->data_size), ctx)) bits |= 1ULL << i;
+				mask &= mask - 1;
+			}
+			removed += anr__popcount64(bits);
+			anr__hashmap_clear_slots(hashmap, bb, w, bits);
+		}
+		if (bb->length == 0) anr__hashmap_remove_bucket(hashmap, bb);
+	}
+	return removed;
+}
+
 uint32_t anr_hashmap_length(void* ds)
 {
 	ANRDATA_ASSERT(ds);
@@ -1044,6 +2878,8 @@ anr_iter anr_hashmap_iter_start(void* ds)
 	anr_iter iter;
 	iter.data = NULL;
 	iter.index = -1;
+	iter.hm.bucket = 0;
+	iter.hm.slot = 0;
 	return iter;
 }
 
@@ -1052,26 +2888,4089 @@ uint8_t anr_hashmap_iter_next(void* ds, anr_iter* iter)
 	ANRDATA_ASSERT(ds);
 	ANRDATA_ASSERT(iter);
 	anr_hashmap* hashmap = (anr_hashmap*)ds;
-	uint32_t item_size = hashmap->data_size + 1;
+	uint32_t mask_words = ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size);
+
+	while (iter->hm.bucket < hashmap->buckets.length)
+	{
+		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)hashmap->buckets.data + iter->hm.bucket;
+		for (uint32_t w = iter->hm.slot >> 6; w < mask_words; w++)
+		{
+			uint64_t mask = bb->occupied[w];
+			if (w == iter->hm.slot >> 6) mask &= ~0ULL << (iter->hm.slot & 63);
+			if (!mask) continue;
+
+			uint32_t i = w*64 + anr__ctz64(mask);
+			iter->hm.slot = i+1;
+			iter->index = bb->bucket_start + i;
+			iter->data = (uint8_t*)bb->data + ((size_t)i * hashmap->data_size);
+			return 1;
+		}
+		iter->hm.bucket++;
+		iter->hm.slot = 0;
+	}
+	iter->data = NULL;
+	return 0;
+}
+
+#define ANR__CTRL_EMPTY ((int8_t)-128)
+#define ANR__CTRL_DELETED ((int8_t)-2)
+
+uint64_t anr_hash_bytes(const void* key, uint32_t key_size)
+{
+	const uint8_t* p = key;
+	uint64_t h = 0xcbf29ce484222325ULL ^ key_size;
+	uint64_t w;
+	while (key_size >= 8)
+	{
+		memcpy(&w, p, 8);
+		h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+		h ^= h >> 29;
+		p += 8;
+		key_size -= 8;
+	}
+	if (key_size) {
+		w = 0;
+		memcpy(&w, p, key_size);
+		h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+	}
+
+	// Final mix so both the low 7 bits (control byte) and the group bits are usable.
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// Returns a bitmask with a bit set for every control byte in the group that equals value.
+static uint32_t anr__hashtable_match(const int8_t* group, int8_t value)
+{
+	#ifdef ANR__DATA_SSE2
+	__m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+	#else
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < ANR_HASHTABLE_GROUP_WIDTH; i++) {
+		if (group[i] == value) mask |= 1u << i;
+	}
+	return mask;
+	#endif
+}
+
+// Empty and deleted control bytes have their sign bit set, full slots do not.
+static uint32_t anr__hashtable_match_free(const int8_t* group)
+{
+	#ifdef ANR__DATA_SSE2
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+	#else
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < ANR_HASHTABLE_GROUP_WIDTH; i++) {
+		if (group[i] < 0) mask |= 1u << i;
+	}
+	return mask;
+	#endif
+}
+
+static uint8_t anr__hashtable_alloc(anr_hashtable* table, uint32_t capacity)
+{
+	int8_t* ctrl = ANR__DATA_ALLOC(table->allocator, capacity);
+	if (!ctrl) return 0;
+	void* slots = ANR__DATA_ALLOC(table->allocator, (size_t)capacity*table->data_size);
+	if (!slots) {
+		ANR__DATA_FREE(table->allocator, ctrl);
+		return 0;
+	}
+	memset(ctrl, ANR__CTRL_EMPTY, capacity);
+	table->ctrl = ctrl;
+	table->slots = slots;
+	table->capacity = capacity;
+	table->growth_left = capacity - (capacity / 8) - table->length; // Max load factor of 7/8.
+	return 1;
+}
+
+// Returns the first empty or deleted slot on the probe sequence of hash.
+static uint32_t anr__hashtable_find_hash(anr_hashtable* table, const void* ptr, uint64_t hash);
+static int32_t anr__hashtable_add_hash(anr_hashtable* table, void* ptr, uint64_t hash);
+
+static uint32_t anr__hashtable_find_free(anr_hashtable* table, uint64_t hash)
+{
+	uint32_t group_mask = (table->capacity / ANR_HASHTABLE_GROUP_WIDTH) - 1;
+	uint32_t group = (uint32_t)(hash >> 7) & group_mask;
+	for (uint32_t step = 1;; step++)
+	{
+		uint32_t mask = anr__hashtable_match_free(table->ctrl + group*ANR_HASHTABLE_GROUP_WIDTH);
+		if (mask) return group*ANR_HASHTABLE_GROUP_WIDTH + anr__ctz32(mask);
+		group = (group + step) & group_mask; // Triangular probing visits every group.
+	}
+}
+
+static uint8_t anr__hashtable_rehash(anr_hashtable* table, uint32_t capacity)
+{
+	int8_t* old_ctrl = table->ctrl;
+	uint8_t* old_slots = table->slots;
+	uint32_t old_capacity = table->capacity;
+	if (!anr__hashtable_alloc(table, capacity)) return 0;
+
+	for (uint32_t i = 0; i < old_capacity; i++)
+	{
+		if (old_ctrl[i] < 0) continue;
+		void* data = old_slots + ((size_t)i*table->data_size);
+		uint64_t hash = table->hash(data, table->key_size);
+		uint32_t slot = anr__hashtable_find_free(table, hash);
+		table->ctrl[slot] = (int8_t)(hash & 0x7F);
+		memcpy((uint8_t*)table->slots + ((size_t)slot*table->data_size), data, table->data_size);
+	}
+
+	ANR__DATA_FREE(table->allocator, old_ctrl);
+	ANR__DATA_FREE(table->allocator, old_slots);
+	return 1;
+}
+
+anr_hashtable anr_hashtable_create(uint32_t data_size, uint32_t key_size, anr_hash_func hash)
+{
+	return anr_hashtable_create_ex(data_size, key_size, hash, NULL);
+}
+
+anr_hashtable anr_hashtable_create_ex(uint32_t data_size, uint32_t key_size, anr_hash_func hash, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	ANRDATA_ASSERT(key_size > 0 && key_size <= data_size);
+	anr_hashtable table = (anr_hashtable){.ds_type = ANR_DS_HASHTABLE, .data_size = data_size, .key_size = key_size, .allocator = allocator};
+	table.hash = hash ? hash : anr_hash_bytes;
+	uint8_t result = anr__hashtable_alloc(&table, ANR_HASHTABLE_GROUP_WIDTH);
+	ANRDATA_ASSERT(result);
+	return table;
+}
+
+int32_t anr_hashtable_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_hashtable* table = (anr_hashtable*)ds;
+	return anr__hashtable_add_hash(table, ptr, table->hash(ptr, table->key_size));
+}
+
+// add with the hash of ptr already computed, lookup and insert share it.
+static int32_t anr__hashtable_add_hash(anr_hashtable* table, void* ptr, uint64_t hash)
+{
+	uint32_t index = anr__hashtable_find_hash(table, ptr, hash);
+	if (index != -1) {
+		memcpy((uint8_t*)table->slots + ((size_t)index*table->data_size), ptr, table->data_size);
+		return index;
+	}
+
+	index = anr__hashtable_find_free(table, hash);
+	if (table->ctrl[index] == ANR__CTRL_EMPTY && table->growth_left == 0) {
+		// Only grow when more than half of the usable slots are full, otherwise just clear out tombstones.
+		uint32_t capacity = table->capacity;
+		if (table->length >= (capacity - capacity/8) / 2) capacity *= 2;
+		if (!anr__hashtable_rehash(table, capacity)) return -1;
+		index = anr__hashtable_find_free(table, hash);
+	}
+
+	if (table->ctrl[index] == ANR__CTRL_EMPTY) table->growth_left--;
+	table->ctrl[index] = (int8_t)(hash & 0x7F);
+	memcpy((uint8_t*)table->slots + ((size_t)index*table->data_size), ptr, table->data_size);
+	table->length++;
+	return index;
+}
+
+void anr_hashtable_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_hashtable* table = (anr_hashtable*)ds;
+	ANR__DATA_FREE(table->allocator, table->ctrl);
+	ANR__DATA_FREE(table->allocator, table->slots);
+}
+
+void anr_hashtable_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+}
 
-	ANR_ITERATE(iter2, &hashmap->buckets)
+void* anr_hashtable_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_hashtable* table = (anr_hashtable*)ds;
+	if (index >= table->capacity) return 0;
+	if (table->ctrl[index] < 0) return 0;
+	return (uint8_t*)table->slots + ((size_t)index*table->data_size);
+}
+
+uint32_t anr_hashtable_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	if (ptr == NULL) return -1;
+	anr_hashtable* table = (anr_hashtable*)ds;
+	return anr__hashtable_find_hash(table, ptr, table->hash(ptr, table->key_size));
+}
+
+// find_by with the hash of ptr already computed.
+static uint32_t anr__hashtable_find_hash(anr_hashtable* table, const void* ptr, uint64_t hash)
+{
+	int8_t h2 = (int8_t)(hash & 0x7F);
+	uint32_t group_mask = (table->capacity / ANR_HASHTABLE_GROUP_WIDTH) - 1;
+	uint32_t group = (uint32_t)(hash >> 7) & group_mask;
+	for (uint32_t step = 1; step <= group_mask+1; step++)
 	{
-		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)iter2.data;
-		for (int i = 0; i < hashmap->bucket_size; i++)
+		int8_t* ctrl = table->ctrl + group*ANR_HASHTABLE_GROUP_WIDTH;
+		uint32_t match = anr__hashtable_match(ctrl, h2);
+		while (match)
 		{
-			int32_t abs_index = bb->bucket_start + i;
-			char* data = bb->data + (i * item_size);
-			if (data[0] == 0) continue;
-			if (abs_index <= iter->index) continue;
+			uint32_t index = group*ANR_HASHTABLE_GROUP_WIDTH + anr__ctz32(match);
+			void* data = (uint8_t*)table->slots + ((size_t)index*table->data_size);
+			if (memcmp(data, ptr, table->key_size) == 0) return index;
+			match &= match - 1;
+		}
+
+		// A probe sequence never continues past a group with an empty slot.
+		if (anr__hashtable_match(ctrl, ANR__CTRL_EMPTY)) return -1;
+		group = (group + step) & group_mask;
+	}
+	return -1;
+}
+
+uint8_t anr_hashtable_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_hashtable* table = (anr_hashtable*)ds;
+	if (index >= table->capacity) return 0;
+	if (table->ctrl[index] < 0) return 0;
+
+	// If the group still has an empty slot no probe went past it, so the slot can become empty instead of a tombstone.
+	int8_t* group = table->ctrl + (index / ANR_HASHTABLE_GROUP_WIDTH)*ANR_HASHTABLE_GROUP_WIDTH;
+	if (anr__hashtable_match(group, ANR__CTRL_EMPTY)) {
+		table->ctrl[index] = ANR__CTRL_EMPTY;
+		table->growth_left++;
+	}
+	else {
+		table->ctrl[index] = ANR__CTRL_DELETED;
+	}
+	table->length--;
+	return 1;
+}
+
+uint8_t anr_hashtable_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	if (!ptr) return 0;
+	anr_hashtable* table = (anr_hashtable*)ds;
+	if ((uint8_t*)ptr < (uint8_t*)table->slots) return 0;
+	return anr_hashtable_remove_at(ds, ((uint8_t*)ptr - (uint8_t*)table->slots) / table->data_size);
+}
+
+uint8_t anr_hashtable_insert(void* ds, uint32_t index, void* ptr)
+{
+	(void)index;
+	return anr_hashtable_add(ds, ptr) != -1;
+}
+
+uint32_t anr_hashtable_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_hashtable* table = (anr_hashtable*)ds;
+	return table->length;
+}
+
+anr_iter anr_hashtable_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_iter iter;
+	iter.data = NULL;
+	iter.index = -1;
+	return iter;
+}
+
+uint8_t anr_hashtable_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(iter);
+	anr_hashtable* table = (anr_hashtable*)ds;
 
-			iter->index = i;
-			iter->data = data+1;
+	uint32_t index = iter->index + 1;
+	while (index < table->capacity)
+	{
+		// Skip a whole group at a time using the control bytes.
+		uint32_t group = index / ANR_HASHTABLE_GROUP_WIDTH;
+		uint32_t full = ~anr__hashtable_match_free(table->ctrl + group*ANR_HASHTABLE_GROUP_WIDTH) & 0xFFFF;
+		full &= 0xFFFFu << (index % ANR_HASHTABLE_GROUP_WIDTH);
+		if (full) {
+			iter->index = group*ANR_HASHTABLE_GROUP_WIDTH + anr__ctz32(full);
+			iter->data = (uint8_t*)table->slots + ((size_t)iter->index*table->data_size);
 			return 1;
 		}
+		index = (group+1)*ANR_HASHTABLE_GROUP_WIDTH;
 	}
+	iter->data = NULL;
 	return 0;
 }
 
+uint8_t anr_hashtable_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_hashtable* table = (anr_hashtable*)ds;
+	uint64_t end = (uint64_t)index + count < table->capacity ? (uint64_t)index + count : table->capacity;
+	for (uint64_t i = index; i < end; i++) {
+		if (table->ctrl[i] >= 0) anr_hashtable_remove_at(ds, (uint32_t)i);
+	}
+	return 1;
+}
+
+// Entries never move on remove, so removing while iterating is safe.
+uint32_t anr_hashtable_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(predicate);
+	uint32_t removed = 0;
+	ANR_ITERATE(iter, (anr_hashtable*)ds)
+	{
+		if (predicate(iter.data, ctx)) removed += anr_hashtable_remove_at(ds, iter.index);
+	}
+	return removed;
+}
+
+#define ANR__UNROLLED_LIST_DATA(_node) ((uint8_t*)(_node) + sizeof(anr_unrolled_list_node))
+#define ANR__UNROLLED_LIST_AT(_list, _node, _slot) (ANR__UNROLLED_LIST_DATA(_node) + (size_t)(_slot)*(_list)->data_size)
+
+anr_unrolled_list anr_unrolled_list_create(uint32_t data_size)
+{
+	return anr_unrolled_list_create_ex(data_size, 0, NULL);
+}
+
+anr_unrolled_list anr_unrolled_list_create_ex(uint32_t data_size, uint32_t node_capacity, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	if (node_capacity == 0) {
+		// Round up to whole cache lines, at least 4 entries per node so splits leave both halves useful.
+		size_t bytes = ANR_UNROLLED_LIST_NODE_SIZE;
+		if (bytes < (size_t)data_size*4) bytes = (((size_t)data_size*4) + 63) & ~(size_t)63;
+		node_capacity = bytes / data_size;
+	}
+	ANRDATA_ASSERT(node_capacity >= 2);
+	return (anr_unrolled_list){.ds_type = ANR_DS_UNROLLED_LIST, .data_size = data_size, .node_capacity = node_capacity, .allocator = allocator};
+}
+
+static anr_unrolled_list_node* anr__unrolled_list_new_node(anr_unrolled_list* list, anr_unrolled_list_node* prev)
+{
+	anr_unrolled_list_node* node = ANR__DATA_ALLOC(list->allocator, sizeof(anr_unrolled_list_node) + (size_t)list->node_capacity*list->data_size);
+	if (!node) return 0;
+	node->length = 0;
+	node->prev = prev;
+	node->next = prev ? prev->next : list->first;
+	if (node->next) ((anr_unrolled_list_node*)node->next)->prev = node;
+	else list->last = node;
+	if (prev) prev->next = node;
+	else list->first = node;
+	return node;
+}
+
+static void anr__unrolled_list_unlink(anr_unrolled_list* list, anr_unrolled_list_node* node)
+{
+	if (node->prev) ((anr_unrolled_list_node*)node->prev)->next = node->next;
+	else list->first = node->next;
+	if (node->next) ((anr_unrolled_list_node*)node->next)->prev = node->prev;
+	else list->last = node->prev;
+	ANR__DATA_FREE(list->allocator, node);
+}
+
+// Find the node holding index, starting from whichever of first, last or the last accessed node is closest.
+static anr_unrolled_list_node* anr__unrolled_list_locate(anr_unrolled_list* list, uint32_t index, uint32_t* start)
+{
+	if (index >= list->length) return 0;
+
+	anr_unrolled_list_node* node = list->first;
+	uint32_t node_start = 0;
+	uint32_t dist = index;
+	uint32_t last_start = list->length - list->last->length;
+	if (list->length - index < dist) {
+		node = list->last;
+		node_start = last_start;
+		dist = list->length - index;
+	}
+	if (list->last_access.node) {
+		uint32_t cached = list->last_access.start;
+		uint32_t cached_dist = cached > index ? cached - index : index - cached;
+		if (cached_dist < dist) {
+			node = list->last_access.node;
+			node_start = cached;
+		}
+	}
+
+	while (index < node_start)
+	{
+		node = node->prev;
+		node_start -= node->length;
+	}
+	while (index >= node_start + node->length)
+	{
+		node_start += node->length;
+		node = node->next;
+	}
+
+	list->last_access.node = node;
+	list->last_access.start = node_start;
+	*start = node_start;
+	return node;
+}
+
+int32_t anr_unrolled_list_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_unrolled_list* list = ds;
+	anr_unrolled_list_node* node = list->last;
+	if (!node || node->length == list->node_capacity) {
+		node = anr__unrolled_list_new_node(list, list->last);
+		if (!node) return -1;
+	}
+	memcpy(ANR__UNROLLED_LIST_AT(list, node, node->length), ptr, list->data_size);
+	node->length++;
+	list->length++;
+	return list->length-1;
+}
+
+void anr_unrolled_list_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_unrolled_list* list = ds;
+	anr_unrolled_list_node* node = list->first;
+	while (node)
+	{
+		anr_unrolled_list_node* next = node->next;
+		ANR__DATA_FREE(list->allocator, node);
+		node = next;
+	}
+	list->first = 0;
+	list->last = 0;
+	list->length = 0;
+	list->last_access.node = 0;
+}
+
+#ifdef ANR_DATA_DEBUG
+void anr_unrolled_list_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_unrolled_list* list = ds;
+	anr_unrolled_list_node* node = list->first;
+	uint32_t count = 0;
+
+	char* buffer = malloc(200);
+	snprintf(buffer, 200, "Unrolled list %p has %d items, %d per node\n", list, list->length, list->node_capacity);
+	ANR_DS_ADD(&curr_print, buffer);
+	while (node)
+	{
+		char* buffer = malloc(200);
+		snprintf(buffer, 200, "#%d %p length: %d prev: %p next: %p\n", count, node, node->length, node->prev, node->next);
+		ANR_DS_ADD(&curr_print, buffer);
+		node = node->next;
+		count++;
+	}
+	anr__print_diff();
+}
+#else
+void anr_unrolled_list_print(void* ds)
+{
+	(void)ds;
+}
+#endif
+
+void* anr_unrolled_list_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_unrolled_list* list = ds;
+	uint32_t start;
+	anr_unrolled_list_node* node = anr__unrolled_list_locate(list, index, &start);
+	if (!node) return 0;
+	return ANR__UNROLLED_LIST_AT(list, node, index - start);
+}
+
+uint32_t anr_unrolled_list_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_unrolled_list* list = ds;
+	uint32_t start = 0;
+	for (anr_unrolled_list_node* node = list->first; node; node = node->next)
+	{
+		int64_t i = anr__find_first(ANR__UNROLLED_LIST_DATA(node), node->length, ptr, list->data_size);
+		if (i != -1) return start + i;
+		start += node->length;
+	}
+	return -1;
+}
+
+uint8_t anr_unrolled_list_insert(void* ds, uint32_t index, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_unrolled_list* list = ds;
+	if (index > list->length) return 0;
+	if (index == list->length) return anr_unrolled_list_add(ds, ptr) != -1;
+
+	uint32_t start;
+	anr_unrolled_list_node* node = anr__unrolled_list_locate(list, index, &start);
+	uint32_t slot = index - start;
+
+	// Inserting in front of a node, the end of the previous node might have room.
+	anr_unrolled_list_node* prev = node->prev;
+	if (slot == 0 && prev && prev->length < list->node_capacity) {
+		node = prev;
+		start -= prev->length;
+		slot = prev->length;
+	}
+	else if (node->length == list->node_capacity) {
+		// Split, upper half moves to a new node.
+		anr_unrolled_list_node* split = anr__unrolled_list_new_node(list, node);
+		if (!split) return 0;
+		uint32_t keep = list->node_capacity / 2;
+		split->length = node->length - keep;
+		memcpy(ANR__UNROLLED_LIST_DATA(split), ANR__UNROLLED_LIST_AT(list, node, keep), (size_t)split->length*list->data_size);
+		node->length = keep;
+		if (slot > keep) {
+			start += keep;
+			slot -= keep;
+			node = split;
+		}
+	}
+
+	uint8_t* at = ANR__UNROLLED_LIST_AT(list, node, slot);
+	memmove(at + list->data_size, at, (size_t)(node->length - slot)*list->data_size);
+	memcpy(at, ptr, list->data_size);
+	node->length++;
+	list->length++;
+
+	list->last_access.node = node;
+	list->last_access.start = start;
+	return 1;
+}
+
+// Merge node with a neighbour once it is less than half full and both fit in one node.
+static void anr__unrolled_list_merge(anr_unrolled_list* list, anr_unrolled_list_node* node, uint32_t start)
+{
+	if (node->length >= list->node_capacity / 2) return;
+
+	anr_unrolled_list_node* next = node->next;
+	anr_unrolled_list_node* prev = node->prev;
+	if (next && node->length + next->length <= list->node_capacity) {
+		memcpy(ANR__UNROLLED_LIST_AT(list, node, node->length), ANR__UNROLLED_LIST_DATA(next), (size_t)next->length*list->data_size);
+		node->length += next->length;
+		anr__unrolled_list_unlink(list, next);
+	}
+	else if (prev && node->length + prev->length <= list->node_capacity) {
+		memcpy(ANR__UNROLLED_LIST_AT(list, prev, prev->length), ANR__UNROLLED_LIST_DATA(node), (size_t)node->length*list->data_size);
+		start -= prev->length;
+		prev->length += node->length;
+		anr__unrolled_list_unlink(list, node);
+		node = prev;
+	}
+
+	list->last_access.node = node;
+	list->last_access.start = start;
+}
+
+uint8_t anr_unrolled_list_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_unrolled_list* list = ds;
+	uint32_t start;
+	anr_unrolled_list_node* node = anr__unrolled_list_locate(list, index, &start);
+	if (!node) return 0;
+
+	uint32_t slot = index - start;
+	uint8_t* at = ANR__UNROLLED_LIST_AT(list, node, slot);
+	memmove(at, at + list->data_size, (size_t)(node->length - slot - 1)*list->data_size);
+	node->length--;
+	list->length--;
+
+	if (node->length == 0) {
+		list->last_access.node = 0;
+		anr__unrolled_list_unlink(list, node);
+	}
+	else {
+		anr__unrolled_list_merge(list, node, start);
+	}
+	return 1;
+}
+
+uint8_t anr_unrolled_list_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_unrolled_list* list = ds;
+
+	// Find the node owning ptr, data pointers dont carry their index.
+	uint32_t start = 0;
+	for (anr_unrolled_list_node* node = list->first; node; node = node->next)
+	{
+		uint8_t* data = ANR__UNROLLED_LIST_DATA(node);
+		if ((uint8_t*)ptr >= data && (uint8_t*)ptr < data + (size_t)node->length*list->data_size) {
+			return anr_unrolled_list_remove_at(ds, start + ((uint8_t*)ptr - data) / list->data_size);
+		}
+		start += node->length;
+	}
+	return 0;
+}
+
+uint32_t anr_unrolled_list_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_unrolled_list* list = ds;
+	return list->length;
+}
+
+anr_iter anr_unrolled_list_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_unrolled_list* list = ds;
+	anr_iter iter;
+	iter.index = -1;
+	iter.data = NULL;
+	iter.ul.node = list->first;
+	iter.ul.slot = 0;
+	return iter;
+}
+
+uint8_t anr_unrolled_list_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(iter);
+	anr_unrolled_list* list = ds;
+	anr_unrolled_list_node* node = iter->ul.node;
+	if (node && iter->ul.slot == node->length) {
+		node = node->next;
+		iter->ul.node = node;
+		iter->ul.slot = 0;
+	}
+	if (!node) {
+		iter->data = NULL;
+		return 0;
+	}
+	iter->data = ANR__UNROLLED_LIST_AT(list, node, iter->ul.slot);
+	iter->ul.slot++;
+	iter->index++;
+	return 1;
+}
+
+#define ANR__SEQUENCE_MAX_HEIGHT 16
+#define ANR__SEQUENCE_DATA(_leaf) ((uint8_t*)(_leaf) + sizeof(anr_sequence_leaf))
+#define ANR__SEQUENCE_AT(_seq, _leaf, _slot) (ANR__SEQUENCE_DATA(_leaf) + (size_t)(_slot)*(_seq)->data_size)
+
+typedef struct
+{
+	anr_sequence_inner* node;
+	uint32_t slot; // Child taken in node.
+} anr__sequence_step;
+
+anr_sequence anr_sequence_create(uint32_t data_size)
+{
+	return anr_sequence_create_ex(data_size, 0, NULL);
+}
+
+anr_sequence anr_sequence_create_ex(uint32_t data_size, uint32_t leaf_capacity, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	if (leaf_capacity == 0) {
+		size_t bytes = ANR_SEQUENCE_LEAF_SIZE;
+		if (bytes < (size_t)data_size*4) bytes = (((size_t)data_size*4) + 63) & ~(size_t)63;
+		leaf_capacity = bytes / data_size;
+	}
+	ANRDATA_ASSERT(leaf_capacity >= 2);
+	return (anr_sequence){.ds_type = ANR_DS_SEQUENCE, .data_size = data_size, .leaf_capacity = leaf_capacity, .allocator = allocator};
+}
+
+static anr_sequence_leaf* anr__sequence_new_leaf(anr_sequence* seq)
+{
+	anr_sequence_leaf* leaf = ANR__DATA_ALLOC(seq->allocator, sizeof(anr_sequence_leaf) + (size_t)seq->leaf_capacity*seq->data_size);
+	if (!leaf) return 0;
+	leaf->prev = 0;
+	leaf->next = 0;
+	leaf->length = 0;
+	return leaf;
+}
+
+static void anr__sequence_unlink_leaf(anr_sequence* seq, anr_sequence_leaf* leaf)
+{
+	if (leaf->prev) ((anr_sequence_leaf*)leaf->prev)->next = leaf->next;
+	else seq->first = leaf->next;
+	if (leaf->next) ((anr_sequence_leaf*)leaf->next)->prev = leaf->prev;
+	ANR__DATA_FREE(seq->allocator, leaf);
+}
+
+static uint32_t anr__sequence_inner_count(anr_sequence_inner* inner)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < inner->length; i++) count += inner->counts[i];
+	return count;
+}
+
+// Walk down to the leaf holding index and return the slot in that leaf. index == length ends
+// at the end of the last leaf. path receives the child taken on every inner level, can be NULL.
+static anr_sequence_leaf* anr__sequence_descend(anr_sequence* seq, uint32_t index, anr__sequence_step* path, uint32_t* slot)
+{
+	void* node = seq->root;
+	for (uint32_t level = 0; level < seq->height; level++)
+	{
+		anr_sequence_inner* inner = node;
+		uint32_t i = 0;
+		while (i < inner->length-1 && index >= inner->counts[i])
+		{
+			index -= inner->counts[i];
+			i++;
+		}
+		if (path) path[level] = (anr__sequence_step){inner, i};
+		node = inner->children[i];
+	}
+	*slot = index;
+	return node;
+}
+
+int32_t anr_sequence_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sequence* seq = ds;
+	if (!anr_sequence_insert(ds, seq->length, ptr)) return -1;
+	return seq->length-1;
+}
+
+static void anr__sequence_free_node(anr_sequence* seq, void* node, uint32_t level)
+{
+	if (level < seq->height) {
+		anr_sequence_inner* inner = node;
+		for (uint32_t i = 0; i < inner->length; i++) anr__sequence_free_node(seq, inner->children[i], level+1);
+	}
+	ANR__DATA_FREE(seq->allocator, node);
+}
+
+void anr_sequence_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sequence* seq = ds;
+	if (seq->root) anr__sequence_free_node(seq, seq->root, 0);
+	seq->root = 0;
+	seq->first = 0;
+	seq->height = 0;
+	seq->length = 0;
+	seq->last_access.leaf = 0;
+}
+
+#ifdef ANR_DATA_DEBUG
+void anr_sequence_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sequence* seq = ds;
+	anr_sequence_leaf* leaf = seq->first;
+	uint32_t count = 0;
+
+	char* buffer = malloc(200);
+	snprintf(buffer, 200, "Sequence %p has %d items, height %d, %d per leaf\n", seq, seq->length, seq->height, seq->leaf_capacity);
+	ANR_DS_ADD(&curr_print, buffer);
+	while (leaf)
+	{
+		char* buffer = malloc(200);
+		snprintf(buffer, 200, "#%d %p length: %d prev: %p next: %p\n", count, leaf, leaf->length, leaf->prev, leaf->next);
+		ANR_DS_ADD(&curr_print, buffer);
+		leaf = leaf->next;
+		count++;
+	}
+	anr__print_diff();
+}
+#else
+void anr_sequence_print(void* ds)
+{
+	(void)ds;
+}
+#endif
+
+void* anr_sequence_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sequence* seq = ds;
+	if (index >= seq->length) return 0;
+
+	anr_sequence_leaf* leaf = seq->last_access.leaf;
+	if (leaf && index >= seq->last_access.start && index < seq->last_access.start + leaf->length) {
+		return ANR__SEQUENCE_AT(seq, leaf, index - seq->last_access.start);
+	}
+
+	uint32_t slot;
+	leaf = anr__sequence_descend(seq, index, NULL, &slot);
+	seq->last_access.leaf = leaf;
+	seq->last_access.start = index - slot;
+	return ANR__SEQUENCE_AT(seq, leaf, slot);
+}
+
+uint32_t anr_sequence_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_sequence* seq = ds;
+	uint32_t start = 0;
+	for (anr_sequence_leaf* leaf = seq->first; leaf; leaf = leaf->next)
+	{
+		int64_t i = anr__find_first(ANR__SEQUENCE_DATA(leaf), leaf->length, ptr, seq->data_size);
+		if (i != -1) return start + i;
+		start += leaf->length;
+	}
+	return -1;
+}
+
+uint8_t anr_sequence_insert(void* ds, uint32_t index, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_sequence* seq = ds;
+	if (index > seq->length) return 0;
+
+	if (!seq->root) {
+		anr_sequence_leaf* leaf = anr__sequence_new_leaf(seq);
+		if (!leaf) return 0;
+		seq->root = leaf;
+		seq->first = leaf;
+	}
+
+	anr__sequence_step path[ANR__SEQUENCE_MAX_HEIGHT];
+	uint32_t slot;
+	anr_sequence_leaf* leaf = anr__sequence_descend(seq, index, path, &slot);
+	seq->last_access.leaf = 0;
+
+	// A full leaf splits, and so does every full inner node above it. Allocate all new nodes
+	// up front so running out of memory leaves the tree untouched.
+	void* spare[ANR__SEQUENCE_MAX_HEIGHT+2];
+	uint32_t spare_count = 0;
+	if (leaf->length == seq->leaf_capacity)
+	{
+		spare[spare_count++] = anr__sequence_new_leaf(seq);
+		int32_t level = seq->height-1;
+		while (level >= 0 && path[level].node->length == ANR_SEQUENCE_FANOUT)
+		{
+			spare[spare_count++] = ANR__DATA_ALLOC(seq->allocator, sizeof(anr_sequence_inner));
+			level--;
+		}
+		if (level < 0) {
+			ANRDATA_ASSERT(seq->height+1 < ANR__SEQUENCE_MAX_HEIGHT);
+			spare[spare_count++] = ANR__DATA_ALLOC(seq->allocator, sizeof(anr_sequence_inner)); // New root.
+		}
+
+		for (uint32_t i = 0; i < spare_count; i++)
+		{
+			if (spare[i]) continue;
+			for (uint32_t x = 0; x < spare_count; x++) if (spare[x]) ANR__DATA_FREE(seq->allocator, spare[x]);
+			return 0;
+		}
+	}
+	uint32_t next_spare = 0;
+
+	// Split the leaf in half, upper half moves to a new leaf.
+	void* split = 0;
+	if (spare_count)
+	{
+		anr_sequence_leaf* right = spare[next_spare++];
+		uint32_t keep = seq->leaf_capacity / 2;
+		right->length = leaf->length - keep;
+		memcpy(ANR__SEQUENCE_DATA(right), ANR__SEQUENCE_AT(seq, leaf, keep), (size_t)right->length*seq->data_size);
+		leaf->length = keep;
+		right->prev = leaf;
+		right->next = leaf->next;
+		if (leaf->next) ((anr_sequence_leaf*)leaf->next)->prev = right;
+		leaf->next = right;
+		split = right;
+		if (slot > keep) {
+			leaf = right;
+			slot -= keep;
+		}
+	}
+
+	uint8_t* at = ANR__SEQUENCE_AT(seq, leaf, slot);
+	memmove(at + seq->data_size, at, (size_t)(leaf->length - slot)*seq->data_size);
+	memcpy(at, ptr, seq->data_size);
+	leaf->length++;
+	seq->length++;
+
+	// Walk back up, counting the new entry and adding split nodes to their parents.
+	uint32_t split_count = split ? ((anr_sequence_leaf*)split)->length : 0;
+	for (int32_t level = seq->height-1; level >= 0; level--)
+	{
+		anr_sequence_inner* inner = path[level].node;
+		uint32_t i = path[level].slot;
+		if (!split) {
+			inner->counts[i]++;
+			continue;
+		}
+
+		void* left = inner->children[i];
+		inner->counts[i] = level == (int32_t)seq->height-1 ? ((anr_sequence_leaf*)left)->length : anr__sequence_inner_count(left);
+
+		void* new_split = 0;
+		if (inner->length == ANR_SEQUENCE_FANOUT)
+		{
+			anr_sequence_inner* right = spare[next_spare++];
+			uint32_t keep = ANR_SEQUENCE_FANOUT / 2;
+			right->length = inner->length - keep;
+			memcpy(right->counts, inner->counts + keep, right->length*sizeof(uint32_t));
+			memcpy(right->children, inner->children + keep, right->length*sizeof(void*));
+			inner->length = keep;
+			new_split = right;
+			if (i >= keep) {
+				inner = right;
+				i -= keep;
+			}
+		}
+
+		memmove(inner->counts + i + 2, inner->counts + i + 1, (inner->length - i - 1)*sizeof(uint32_t));
+		memmove(inner->children + i + 2, inner->children + i + 1, (inner->length - i - 1)*sizeof(void*));
+		inner->counts[i+1] = split_count;
+		inner->children[i+1] = split;
+		inner->length++;
+
+		split = new_split;
+		split_count = split ? anr__sequence_inner_count(split) : 0;
+	}
+
+	// Root split, tree grows one level.
+	if (split)
+	{
+		anr_sequence_inner* root = spare[next_spare++];
+		root->length = 2;
+		root->children[0] = seq->root;
+		root->children[1] = split;
+		root->counts[1] = split_count;
+		root->counts[0] = seq->length - split_count;
+		seq->root = root;
+		seq->height++;
+	}
+	ANRDATA_ASSERT(next_spare == spare_count);
+	return 1;
+}
+
+// Merge child j+1 of inner into child j.
+static void anr__sequence_merge(anr_sequence* seq, anr_sequence_inner* inner, uint32_t j, uint8_t leaves)
+{
+	if (leaves) {
+		anr_sequence_leaf* left = inner->children[j];
+		anr_sequence_leaf* right = inner->children[j+1];
+		memcpy(ANR__SEQUENCE_AT(seq, left, left->length), ANR__SEQUENCE_DATA(right), (size_t)right->length*seq->data_size);
+		left->length += right->length;
+		anr__sequence_unlink_leaf(seq, right);
+	}
+	else {
+		anr_sequence_inner* left = inner->children[j];
+		anr_sequence_inner* right = inner->children[j+1];
+		memcpy(left->counts + left->length, right->counts, right->length*sizeof(uint32_t));
+		memcpy(left->children + left->length, right->children, right->length*sizeof(void*));
+		left->length += right->length;
+		ANR__DATA_FREE(seq->allocator, right);
+	}
+
+	inner->counts[j] += inner->counts[j+1];
+	memmove(inner->counts + j + 1, inner->counts + j + 2, (inner->length - j - 2)*sizeof(uint32_t));
+	memmove(inner->children + j + 1, inner->children + j + 2, (inner->length - j - 2)*sizeof(void*));
+	inner->length--;
+}
+
+uint8_t anr_sequence_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sequence* seq = ds;
+	if (index >= seq->length) return 0;
+
+	anr__sequence_step path[ANR__SEQUENCE_MAX_HEIGHT];
+	uint32_t slot;
+	anr_sequence_leaf* leaf = anr__sequence_descend(seq, index, path, &slot);
+	seq->last_access.leaf = 0;
+
+	uint8_t* at = ANR__SEQUENCE_AT(seq, leaf, slot);
+	memmove(at, at + seq->data_size, (size_t)(leaf->length - slot - 1)*seq->data_size);
+	leaf->length--;
+	seq->length--;
+	for (uint32_t level = 0; level < seq->height; level++) path[level].node->counts[path[level].slot]--;
+
+	// Bottom up: drop empty children and merge children under a quarter full with a neighbour.
+	for (int32_t level = seq->height-1; level >= 0; level--)
+	{
+		anr_sequence_inner* inner = path[level].node;
+		uint32_t i = path[level].slot;
+		uint8_t leaves = level == (int32_t)seq->height-1;
+		#define ANR__SEQUENCE_CHILD_LENGTH(_j) (leaves ? ((anr_sequence_leaf*)inner->children[_j])->length : ((anr_sequence_inner*)inner->children[_j])->length)
+		uint32_t capacity = leaves ? seq->leaf_capacity : ANR_SEQUENCE_FANOUT;
+		uint32_t length = ANR__SEQUENCE_CHILD_LENGTH(i);
+
+		if (length == 0) {
+			if (leaves) anr__sequence_unlink_leaf(seq, inner->children[i]);
+			else ANR__DATA_FREE(seq->allocator, inner->children[i]);
+			memmove(inner->counts + i, inner->counts + i + 1, (inner->length - i - 1)*sizeof(uint32_t));
+			memmove(inner->children + i, inner->children + i + 1, (inner->length - i - 1)*sizeof(void*));
+			inner->length--;
+		}
+		else if (length >= capacity / 4) break;
+		else if (i+1 < inner->length && length + ANR__SEQUENCE_CHILD_LENGTH(i+1) <= capacity) anr__sequence_merge(seq, inner, i, leaves);
+		else if (i > 0 && length + ANR__SEQUENCE_CHILD_LENGTH(i-1) <= capacity) anr__sequence_merge(seq, inner, i-1, leaves);
+		else break;
+		#undef ANR__SEQUENCE_CHILD_LENGTH
+	}
+
+	// Root with a single child, tree shrinks one level.
+	while (seq->height > 0 && ((anr_sequence_inner*)seq->root)->length <= 1)
+	{
+		anr_sequence_inner* root = seq->root;
+		seq->root = root->length ? root->children[0] : 0;
+		seq->height = root->length ? seq->height-1 : 0;
+		ANR__DATA_FREE(seq->allocator, root);
+	}
+	if (seq->root && seq->height == 0 && ((anr_sequence_leaf*)seq->root)->length == 0) {
+		ANR__DATA_FREE(seq->allocator, seq->root);
+		seq->root = 0;
+	}
+	if (!seq->root) seq->first = 0;
+	return 1;
+}
+
+uint8_t anr_sequence_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_sequence* seq = ds;
+
+	// Pointers usually come from find_at, check its leaf before walking all leaves.
+	anr_sequence_leaf* leaf = seq->last_access.leaf;
+	if (leaf) {
+		uint8_t* data = ANR__SEQUENCE_DATA(leaf);
+		if ((uint8_t*)ptr >= data && (uint8_t*)ptr < data + (size_t)leaf->length*seq->data_size) {
+			return anr_sequence_remove_at(ds, seq->last_access.start + ((uint8_t*)ptr - data) / seq->data_size);
+		}
+	}
+
+	uint32_t start = 0;
+	for (leaf = seq->first; leaf; leaf = leaf->next)
+	{
+		uint8_t* data = ANR__SEQUENCE_DATA(leaf);
+		if ((uint8_t*)ptr >= data && (uint8_t*)ptr < data + (size_t)leaf->length*seq->data_size) {
+			return anr_sequence_remove_at(ds, start + ((uint8_t*)ptr - data) / seq->data_size);
+		}
+		start += leaf->length;
+	}
+	return 0;
+}
+
+uint32_t anr_sequence_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sequence* seq = ds;
+	return seq->length;
+}
+
+anr_iter anr_sequence_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sequence* seq = ds;
+	anr_iter iter;
+	iter.index = -1;
+	iter.data = NULL;
+	iter.sq.leaf = seq->first;
+	iter.sq.slot = 0;
+	return iter;
+}
+
+uint8_t anr_sequence_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(iter);
+	anr_sequence* seq = ds;
+	anr_sequence_leaf* leaf = iter->sq.leaf;
+	if (leaf && iter->sq.slot == leaf->length) {
+		leaf = leaf->next;
+		iter->sq.leaf = leaf;
+		iter->sq.slot = 0;
+	}
+	if (!leaf) {
+		iter->data = NULL;
+		return 0;
+	}
+	iter->data = ANR__SEQUENCE_AT(seq, leaf, iter->sq.slot);
+	iter->sq.slot++;
+	iter->index++;
+	return 1;
+}
+
+#define ANR__GAP_BUFFER_AT(_buffer, _position) ((uint8_t*)(_buffer)->data + (size_t)(_position)*(_buffer)->data_size)
+#define ANR__GAP_BUFFER_GAP(_buffer) ((_buffer)->gap_end - (_buffer)->gap_start)
+
+anr_gap_buffer anr_gap_buffer_create(uint32_t data_size, uint32_t reserve_count)
+{
+	return anr_gap_buffer_create_ex(data_size, reserve_count, NULL);
+}
+
+anr_gap_buffer anr_gap_buffer_create_ex(uint32_t data_size, uint32_t reserve_count, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	ANRDATA_ASSERT(reserve_count > 0);
+	anr_gap_buffer buffer = (anr_gap_buffer){.ds_type = ANR_DS_GAP_BUFFER, .data_size = data_size, .allocator = allocator};
+	buffer.data = ANR__DATA_ALLOC(allocator, (size_t)reserve_count*data_size);
+	ANRDATA_ASSERT(buffer.data);
+	buffer.capacity = reserve_count;
+	buffer.gap_start = 0;
+	buffer.gap_end = reserve_count;
+	return buffer;
+}
+
+// Move the gap so it starts at index, only the entries between the old and new position move.
+static void anr__gap_buffer_move_gap(anr_gap_buffer* buffer, uint32_t index)
+{
+	uint32_t gap = ANR__GAP_BUFFER_GAP(buffer);
+	if (index < buffer->gap_start) {
+		uint32_t count = buffer->gap_start - index;
+		memmove(ANR__GAP_BUFFER_AT(buffer, index + gap), ANR__GAP_BUFFER_AT(buffer, index), (size_t)count*buffer->data_size);
+	}
+	else if (index > buffer->gap_start) {
+		uint32_t count = index - buffer->gap_start;
+		memmove(ANR__GAP_BUFFER_AT(buffer, buffer->gap_start), ANR__GAP_BUFFER_AT(buffer, buffer->gap_end), (size_t)count*buffer->data_size);
+	}
+	buffer->gap_start = index;
+	buffer->gap_end = index + gap;
+}
+
+// Double capacity, entries after the gap move to the end of the new block.
+static uint8_t anr__gap_buffer_grow(anr_gap_buffer* buffer)
+{
+	uint64_t capacity = (uint64_t)buffer->capacity*2;
+	if (capacity > UINT32_MAX) capacity = UINT32_MAX;
+	if (capacity == buffer->capacity) return 0;
+
+	void* b = ANR__DATA_REALLOC(buffer->allocator, buffer->data, (size_t)buffer->capacity*buffer->data_size, (size_t)capacity*buffer->data_size);
+	if (!b) return 0;
+	buffer->data = b;
+
+	uint32_t tail = buffer->capacity - buffer->gap_end;
+	uint32_t new_gap_end = (uint32_t)capacity - tail;
+	memmove(ANR__GAP_BUFFER_AT(buffer, new_gap_end), ANR__GAP_BUFFER_AT(buffer, buffer->gap_end), (size_t)tail*buffer->data_size);
+	buffer->gap_end = new_gap_end;
+	buffer->capacity = (uint32_t)capacity;
+	return 1;
+}
+
+int32_t anr_gap_buffer_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	uint32_t length = anr_gap_buffer_length(ds);
+	if (!anr_gap_buffer_insert(ds, length, ptr)) return -1;
+	return length;
+}
+
+void anr_gap_buffer_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_gap_buffer* buffer = ds;
+	ANR__DATA_FREE(buffer->allocator, buffer->data);
+	buffer->data = 0;
+	buffer->capacity = 0;
+	buffer->gap_start = 0;
+	buffer->gap_end = 0;
+}
+
+#ifdef ANR_DATA_DEBUG
+void anr_gap_buffer_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_gap_buffer* buffer = ds;
+	char* line = malloc(200);
+	snprintf(line, 200, "gap buffer %p has %d items, %d reserved, gap %d-%d\n", buffer, anr_gap_buffer_length(ds), buffer->capacity, buffer->gap_start, buffer->gap_end);
+	ANR_DS_ADD(&curr_print, line);
+	for (uint32_t i = 0; i < anr_gap_buffer_length(ds); i++)
+	{
+		char* line = malloc(200);
+		snprintf(line, 200, "#%d ", i);
+		uint8_t* data = anr_gap_buffer_find_at(ds, i);
+		for (uint32_t x = 0; x < buffer->data_size; x++) {
+			snprintf(line+strlen(line), 200-strlen(line), "%x", data[x]);
+		}
+		snprintf(line+strlen(line), 200-strlen(line), "\n");
+		ANR_DS_ADD(&curr_print, line);
+	}
+	anr__print_diff();
+}
+#else
+void anr_gap_buffer_print(void* ds)
+{
+	(void)ds;
+}
+#endif
+
+void* anr_gap_buffer_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_gap_buffer* buffer = ds;
+	if (index < buffer->gap_start) return ANR__GAP_BUFFER_AT(buffer, index);
+	uint64_t position = (uint64_t)index + ANR__GAP_BUFFER_GAP(buffer);
+	if (position >= buffer->capacity) return 0;
+	return ANR__GAP_BUFFER_AT(buffer, position);
+}
+
+uint32_t anr_gap_buffer_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_gap_buffer* buffer = ds;
+	int64_t i = anr__find_first(buffer->data, buffer->gap_start, ptr, buffer->data_size);
+	if (i != -1) return i;
+	i = anr__find_first(ANR__GAP_BUFFER_AT(buffer, buffer->gap_end), buffer->capacity - buffer->gap_end, ptr, buffer->data_size);
+	if (i != -1) return buffer->gap_start + i;
+	return -1;
+}
+
+uint8_t anr_gap_buffer_insert(void* ds, uint32_t index, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_gap_buffer* buffer = ds;
+	if (index > anr_gap_buffer_length(ds)) return 0;
+	if (buffer->gap_start == buffer->gap_end && !anr__gap_buffer_grow(buffer)) return 0;
+
+	anr__gap_buffer_move_gap(buffer, index);
+	memcpy(ANR__GAP_BUFFER_AT(buffer, buffer->gap_start), ptr, buffer->data_size);
+	buffer->gap_start++;
+	return 1;
+}
+
+uint8_t anr_gap_buffer_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_gap_buffer* buffer = ds;
+	if (index >= anr_gap_buffer_length(ds)) return 0;
+
+	// Removing right before the gap (backspace) needs no move.
+	if (index + 1 == buffer->gap_start) {
+		buffer->gap_start--;
+		return 1;
+	}
+	anr__gap_buffer_move_gap(buffer, index);
+	buffer->gap_end++;
+	return 1;
+}
+
+uint8_t anr_gap_buffer_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_gap_buffer* buffer = ds;
+	if ((uint8_t*)ptr < (uint8_t*)buffer->data) return 0;
+	size_t position = ((uint8_t*)ptr - (uint8_t*)buffer->data) / buffer->data_size;
+	if (position < buffer->gap_start) return anr_gap_buffer_remove_at(ds, position);
+	if (position >= buffer->gap_end && position < buffer->capacity) return anr_gap_buffer_remove_at(ds, position - ANR__GAP_BUFFER_GAP(buffer));
+	return 0;
+}
+
+uint32_t anr_gap_buffer_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_gap_buffer* buffer = ds;
+	return buffer->capacity - ANR__GAP_BUFFER_GAP(buffer);
+}
+
+anr_iter anr_gap_buffer_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_iter iter;
+	iter.index = -1;
+	iter.data = NULL;
+	return iter;
+}
+
+uint8_t anr_gap_buffer_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(iter);
+	iter->index++;
+	iter->data = anr_gap_buffer_find_at(ds, iter->index);
+	return iter->data != NULL;
+}
+
+#define ANR__DEQUE_AT(_deque, _index) ((uint8_t*)(_deque)->data + (size_t)(((_deque)->head + (_index)) & ((_deque)->capacity-1))*(_deque)->data_size)
+
+anr_deque anr_deque_create(uint32_t data_size, uint32_t reserve_count)
+{
+	return anr_deque_create_ex(data_size, reserve_count, NULL);
+}
+
+anr_deque anr_deque_create_ex(uint32_t data_size, uint32_t reserve_count, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	ANRDATA_ASSERT(reserve_count > 0 && reserve_count <= (1u << 31));
+	uint32_t capacity = 1;
+	while (capacity < reserve_count) capacity <<= 1;
+
+	anr_deque deque = (anr_deque){.ds_type = ANR_DS_DEQUE, .data_size = data_size, .capacity = capacity, .allocator = allocator};
+	deque.data = ANR__DATA_ALLOC(allocator, (size_t)capacity*data_size);
+	ANRDATA_ASSERT(deque.data);
+	return deque;
+}
+
+// Double capacity. The wrapped part of the ring moves behind the old end so entries are in order again.
+static uint8_t anr__deque_grow(anr_deque* deque)
+{
+	if (deque->capacity == (1u << 31)) return 0;
+	uint32_t capacity = deque->capacity*2;
+	void* b = ANR__DATA_REALLOC(deque->allocator, deque->data, (size_t)deque->capacity*deque->data_size, (size_t)capacity*deque->data_size);
+	if (!b) return 0;
+	deque->data = b;
+
+	if (deque->head + deque->length > deque->capacity) {
+		uint32_t wrapped = deque->head + deque->length - deque->capacity;
+		memcpy((uint8_t*)deque->data + (size_t)deque->capacity*deque->data_size, deque->data, (size_t)wrapped*deque->data_size);
+	}
+	deque->capacity = capacity;
+	return 1;
+}
+
+// Move count entries one index down (-1) or up (+1), starting at index from. Runs that are contiguous
+// on both sides of the ring are moved with one memmove, in the order that does not overwrite unread entries.
+static void anr__deque_shift(anr_deque* deque, uint32_t from, uint32_t count, int32_t direction)
+{
+	uint32_t mask = deque->capacity-1;
+	while (count)
+	{
+		uint32_t src, dst, run;
+		if (direction < 0) {
+			src = (deque->head + from) & mask;
+			dst = (src - 1) & mask;
+			run = count;
+			if (run > deque->capacity - src) run = deque->capacity - src;
+			if (run > deque->capacity - dst) run = deque->capacity - dst;
+			from += run;
+		}
+		else {
+			uint32_t src_last = (deque->head + from + count - 1) & mask;
+			uint32_t dst_last = (src_last + 1) & mask;
+			run = count;
+			if (run > src_last+1) run = src_last+1;
+			if (run > dst_last+1) run = dst_last+1;
+			src = src_last + 1 - run;
+			dst = dst_last + 1 - run;
+		}
+		memmove((uint8_t*)deque->data + (size_t)dst*deque->data_size, (uint8_t*)deque->data + (size_t)src*deque->data_size, (size_t)run*deque->data_size);
+		count -= run;
+	}
+}
+
+int32_t anr_deque_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_deque* deque = ds;
+	if (deque->length == deque->capacity && !anr__deque_grow(deque)) return -1;
+	memcpy(ANR__DEQUE_AT(deque, deque->length), ptr, deque->data_size);
+	deque->length++;
+	return deque->length-1;
+}
+
+void anr_deque_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_deque* deque = ds;
+	ANR__DATA_FREE(deque->allocator, deque->data);
+	deque->data = 0;
+	deque->length = 0;
+	deque->head = 0;
+}
+
+#ifdef ANR_DATA_DEBUG
+void anr_deque_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_deque* deque = ds;
+	char* line = malloc(200);
+	snprintf(line, 200, "deque %p has %d items, %d reserved, head %d\n", deque, deque->length, deque->capacity, deque->head);
+	ANR_DS_ADD(&curr_print, line);
+	for (uint32_t i = 0; i < deque->length; i++)
+	{
+		char* line = malloc(200);
+		snprintf(line, 200, "#%d ", i);
+		uint8_t* data = ANR__DEQUE_AT(deque, i);
+		for (uint32_t x = 0; x < deque->data_size; x++) {
+			snprintf(line+strlen(line), 200-strlen(line), "%x", data[x]);
+		}
+		snprintf(line+strlen(line), 200-strlen(line), "\n");
+		ANR_DS_ADD(&curr_print, line);
+	}
+	anr__print_diff();
+}
+#else
+void anr_deque_print(void* ds)
+{
+	(void)ds;
+}
+#endif
+
+void* anr_deque_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_deque* deque = ds;
+	if (index >= deque->length) return 0;
+	return ANR__DEQUE_AT(deque, index);
+}
+
+uint32_t anr_deque_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_deque* deque = ds;
+
+	// At most two contiguous runs, head to the end of the block and the wrapped part.
+	uint32_t first_run = deque->capacity - deque->head;
+	if (first_run > deque->length) first_run = deque->length;
+	int64_t i = anr__find_first(ANR__DEQUE_AT(deque, 0), first_run, ptr, deque->data_size);
+	if (i != -1) return i;
+	i = anr__find_first(deque->data, deque->length - first_run, ptr, deque->data_size);
+	if (i != -1) return first_run + i;
+	return -1;
+}
+
+uint8_t anr_deque_insert(void* ds, uint32_t index, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_deque* deque = ds;
+	if (index > deque->length) return 0;
+	if (deque->length == deque->capacity && !anr__deque_grow(deque)) return 0;
+
+	// Move whichever side of index is shorter, index 0 and length move nothing.
+	if (index < deque->length - index) {
+		deque->head = (deque->head - 1) & (deque->capacity-1);
+		anr__deque_shift(deque, 1, index, -1);
+	}
+	else {
+		anr__deque_shift(deque, index, deque->length - index, 1);
+	}
+	memcpy(ANR__DEQUE_AT(deque, index), ptr, deque->data_size);
+	deque->length++;
+	return 1;
+}
+
+uint8_t anr_deque_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_deque* deque = ds;
+	if (index >= deque->length) return 0;
+
+	if (index < deque->length - index - 1) {
+		anr__deque_shift(deque, 0, index, 1);
+		deque->head = (deque->head + 1) & (deque->capacity-1);
+	}
+	else {
+		anr__deque_shift(deque, index+1, deque->length - index - 1, -1);
+	}
+	deque->length--;
+	if (deque->length == 0) deque->head = 0;
+	return 1;
+}
+
+uint8_t anr_deque_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_deque* deque = ds;
+	if ((uint8_t*)ptr < (uint8_t*)deque->data) return 0;
+	size_t position = ((uint8_t*)ptr - (uint8_t*)deque->data) / deque->data_size;
+	if (position >= deque->capacity) return 0;
+	return anr_deque_remove_at(ds, (position - deque->head) & (deque->capacity-1));
+}
+
+uint32_t anr_deque_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_deque* deque = ds;
+	return deque->length;
+}
+
+anr_iter anr_deque_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_iter iter;
+	iter.index = -1;
+	iter.data = NULL;
+	return iter;
+}
+
+uint8_t anr_deque_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(iter);
+	anr_deque* deque = ds;
+	if ((uint32_t)(iter->index+1) >= deque->length) {
+		iter->data = NULL;
+		return 0;
+	}
+	iter->index++;
+	iter->data = ANR__DEQUE_AT(deque, iter->index);
+	return 1;
+}
+
+#define ANR__SORTED_ARRAY_AT(_sarr, _index) ((uint8_t*)(_sarr)->items.data + (size_t)(_index)*(_sarr)->items.data_size)
+
+anr_sorted_array anr_sorted_array_create(uint32_t data_size, anr_compare_func compare)
+{
+	return anr_sorted_array_create_ex(data_size, 1, compare, 0, NULL);
+}
+
+anr_sorted_array anr_sorted_array_create_ex(uint32_t data_size, uint32_t reserve_count, anr_compare_func compare, uint8_t eytzinger, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(compare);
+	anr_sorted_array sarr = (anr_sorted_array){.ds_type = ANR_DS_SORTED_ARRAY, .compare = compare};
+	sarr.items = anr_array_create_ex(data_size, reserve_count, ANR_ARRAY_POLICY_DEFAULT, allocator);
+	sarr.eytzinger.enabled = eytzinger;
+	sarr.eytzinger.dirty = 1;
+	return sarr;
+}
+
+// First index whose entry is not less than key (or greater than key with upper set). The loop
+// always runs log2(n) times and only moves base with a conditional move, so it does not mispredict.
+static uint32_t anr__sorted_array_bound(anr_sorted_array* sarr, const void* key, uint8_t upper)
+{
+	uint32_t n = sarr->items.length;
+	if (n == 0) return 0;
+	uint32_t size = sarr->items.data_size;
+	int32_t limit = upper ? 1 : 0; // lower bound moves on compare < 0, upper bound on compare <= 0.
+	const uint8_t* base = sarr->items.data;
+	while (n > 1)
+	{
+		uint32_t half = n / 2;
+		base = (sarr->compare(base + (size_t)half*size, key) < limit) ? base + (size_t)half*size : base;
+		n -= half;
+	}
+	return (uint32_t)((base - (const uint8_t*)sarr->items.data) / size) + (sarr->compare(base, key) < limit);
+}
+
+// In order walk of the implicit tree, node k has children 2k and 2k+1. Returns next sorted index.
+static uint32_t anr__sorted_array_fill_eytzinger(anr_sorted_array* sarr, uint32_t i, uint32_t k)
+{
+	if (k > (uint32_t)sarr->items.length) return i;
+	i = anr__sorted_array_fill_eytzinger(sarr, i, 2*k);
+	memcpy((uint8_t*)sarr->eytzinger.data + (size_t)k*sarr->items.data_size, ANR__SORTED_ARRAY_AT(sarr, i), sarr->items.data_size);
+	sarr->eytzinger.index[k] = i;
+	return anr__sorted_array_fill_eytzinger(sarr, i+1, 2*k+1);
+}
+
+// Returns 0 if the copy can not be allocated. The copy grows like an array, the old contents are not kept.
+static uint8_t anr__sorted_array_build_eytzinger(anr_sorted_array* sarr)
+{
+	uint32_t n = sarr->items.length;
+	anr_allocator* allocator = sarr->items.allocator;
+	if (n + 1 > sarr->eytzinger.reserved)
+	{
+		if (sarr->eytzinger.data) ANR__DATA_FREE(allocator, sarr->eytzinger.data);
+		if (sarr->eytzinger.index) ANR__DATA_FREE(allocator, sarr->eytzinger.index);
+		uint64_t reserved = (uint64_t)sarr->eytzinger.reserved * 2;
+		if (reserved < n + 1) reserved = n + 1;
+		if (reserved > UINT32_MAX) reserved = UINT32_MAX;
+		sarr->eytzinger.reserved = (uint32_t)reserved;
+		sarr->eytzinger.data = ANR__DATA_ALLOC(allocator, (size_t)reserved*sarr->items.data_size);
+		sarr->eytzinger.index = ANR__DATA_ALLOC(allocator, (size_t)reserved*sizeof(uint32_t));
+		if (!sarr->eytzinger.data || !sarr->eytzinger.index) {
+			if (sarr->eytzinger.data) ANR__DATA_FREE(allocator, sarr->eytzinger.data);
+			if (sarr->eytzinger.index) ANR__DATA_FREE(allocator, sarr->eytzinger.index);
+			sarr->eytzinger.data = 0;
+			sarr->eytzinger.index = 0;
+			sarr->eytzinger.reserved = 0;
+			return 0;
+		}
+	}
+	anr__sorted_array_fill_eytzinger(sarr, 0, 1);
+	sarr->eytzinger.dirty = 0;
+	sarr->eytzinger.lookups = 0;
+	return 1;
+}
+
+// The rebuild is O(n), so it waits for n/16 lookups after a change. Interleaved adds and lookups
+// stay with binary search and pay at most 16 copied entries per lookup.
+static uint8_t anr__sorted_array_use_eytzinger(anr_sorted_array* sarr)
+{
+	if (!sarr->eytzinger.dirty) return 1;
+	if (++sarr->eytzinger.lookups <= (uint32_t)sarr->items.length / 16) return 0;
+	return anr__sorted_array_build_eytzinger(sarr);
+}
+
+static uint32_t anr__sorted_array_find_eytzinger(anr_sorted_array* sarr, const void* key)
+{
+	uint32_t n = sarr->items.length;
+	uint32_t size = sarr->items.data_size;
+	const uint8_t* data = sarr->eytzinger.data;
+
+	uint32_t k = 1;
+	while (k <= n)
+	{
+		#if defined(__GNUC__) || defined(__clang__)
+		// Four levels down, one cache line for small entries. Only within the copy, a pointer past it is undefined.
+		if ((uint64_t)k*16 <= n) __builtin_prefetch(data + (size_t)k*16*size);
+		#endif
+		k = 2*k + (sarr->compare(data + (size_t)k*size, key) < 0);
+	}
+	// Undo the right turns taken after the last left turn, that node is the lower bound.
+	k >>= anr__ctz32(~k) + 1;
+	if (k == 0 || sarr->compare(data + (size_t)k*size, key) != 0) return -1;
+	return sarr->eytzinger.index[k];
+}
+
+int32_t anr_sorted_array_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_sorted_array* sarr = ds;
+	uint32_t index = anr__sorted_array_bound(sarr, ptr, 1);
+	if (!anr_array_insert(&sarr->items, index, ptr)) return -1;
+	sarr->eytzinger.dirty = 1;
+	return index;
+}
+
+uint8_t anr_sorted_array_merge_sorted(void* ds, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	if (count == 0) return 1;
+	ANRDATA_ASSERT(data);
+	if (!anr__array_grow(&sarr->items, sarr->items.length + count)) return 0;
+
+	// Merge from the back into the grown array, every entry moves once.
+	uint32_t size = sarr->items.data_size;
+	const uint8_t* batch = data;
+	int64_t a = (int64_t)sarr->items.length - 1;
+	int64_t b = (int64_t)count - 1;
+	int64_t out = (int64_t)sarr->items.length + count - 1;
+	while (b >= 0)
+	{
+		if (a >= 0 && sarr->compare(ANR__SORTED_ARRAY_AT(sarr, a), batch + (size_t)b*size) > 0) {
+			memcpy(ANR__SORTED_ARRAY_AT(sarr, out), ANR__SORTED_ARRAY_AT(sarr, a), size);
+			a--;
+		}
+		else {
+			memcpy(ANR__SORTED_ARRAY_AT(sarr, out), batch + (size_t)b*size, size);
+			b--;
+		}
+		out--;
+	}
+	sarr->items.length += count;
+	sarr->eytzinger.dirty = 1;
+	return 1;
+}
+
+void anr_sorted_array_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	if (sarr->eytzinger.data) {
+		ANR__DATA_FREE(sarr->items.allocator, sarr->eytzinger.data);
+		ANR__DATA_FREE(sarr->items.allocator, sarr->eytzinger.index);
+	}
+	sarr->eytzinger.data = 0;
+	sarr->eytzinger.index = 0;
+	sarr->eytzinger.reserved = 0;
+	sarr->eytzinger.dirty = 1;
+	sarr->eytzinger.lookups = 0;
+	anr_array_free(&sarr->items);
+}
+
+void anr_sorted_array_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	anr_array_print(&sarr->items);
+}
+
+void* anr_sorted_array_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	return anr_array_find_at(&sarr->items, index);
+}
+
+uint32_t anr_sorted_array_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_sorted_array* sarr = ds;
+	if (sarr->eytzinger.enabled && anr__sorted_array_use_eytzinger(sarr)) return anr__sorted_array_find_eytzinger(sarr, ptr);
+
+	uint32_t index = anr__sorted_array_bound(sarr, ptr, 0);
+	if (index == sarr->items.length || sarr->compare(ANR__SORTED_ARRAY_AT(sarr, index), ptr) != 0) return -1;
+	return index;
+}
+
+uint8_t anr_sorted_array_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	sarr->eytzinger.dirty = 1;
+	return anr_array_remove_at(&sarr->items, index);
+}
+
+uint8_t anr_sorted_array_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	sarr->eytzinger.dirty = 1;
+	return anr_array_remove_by(&sarr->items, ptr);
+}
+
+uint8_t anr_sorted_array_insert(void* ds, uint32_t index, void* ptr)
+{
+	(void)index;
+	return anr_sorted_array_add(ds, ptr) != -1;
+}
+
+uint32_t anr_sorted_array_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	return sarr->items.length;
+}
+
+anr_iter anr_sorted_array_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	return anr_array_iter_start(&sarr->items);
+}
+
+uint8_t anr_sorted_array_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	return anr_array_iter_next(&sarr->items, iter);
+}
+
+uint8_t anr_sorted_array_add_range(void* ds, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_sorted_array* sarr = ds;
+	if (count == 0) return 1;
+
+	size_t batch_size = (size_t)count * sarr->items.data_size;
+	void* batch = ANR__DATA_ALLOC(sarr->items.allocator, batch_size);
+	if (!batch) return 0;
+	memcpy(batch, data, batch_size);
+	qsort(batch, count, sarr->items.data_size, sarr->compare);
+	uint8_t result = anr_sorted_array_merge_sorted(ds, batch, count);
+	ANR__DATA_FREE(sarr->items.allocator, batch);
+	return result;
+}
+
+uint8_t anr_sorted_array_insert_range(void* ds, uint32_t index, void* data, uint32_t count)
+{
+	(void)index;
+	return anr_sorted_array_add_range(ds, data, count);
+}
+
+uint8_t anr_sorted_array_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	sarr->eytzinger.dirty = 1;
+	return anr_array_remove_range(&sarr->items, index, count);
+}
+
+uint32_t anr_sorted_array_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	anr_sorted_array* sarr = ds;
+	sarr->eytzinger.dirty = 1;
+	return anr_array_remove_if(&sarr->items, predicate, ctx);
+}
+
+static void* anr__concurrent_hashtable_alloc(void* ctx, size_t size)
+{
+	anr_concurrent_hashtable_shard* shard = ctx;
+	return ANR__DATA_ALLOC(shard->parent, size);
+}
+
+// Freed blocks are only retired, a reader might still be probing them.
+static void anr__concurrent_hashtable_retire(void* ctx, void* ptr)
+{
+	anr_concurrent_hashtable_shard* shard = ctx;
+	int32_t result = anr_array_add(&shard->retired, &ptr);
+	ANRDATA_ASSERT(result != -1);
+	(void)result;
+}
+
+static void* anr__concurrent_hashtable_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+	void* b = anr__concurrent_hashtable_alloc(ctx, new_size);
+	if (!b) return 0;
+	memcpy(b, ptr, old_size < new_size ? old_size : new_size);
+	anr__concurrent_hashtable_retire(ctx, ptr);
+	return b;
+}
+
+// The top bits pick the shard, the shard table uses the same hash for its groups and control bytes.
+static anr_concurrent_hashtable_shard* anr__concurrent_hashtable_shard(anr_concurrent_hashtable* table, uint64_t hash)
+{
+	if (table->shard_bits == 0) return table->shards;
+	return table->shards + (hash >> (64 - table->shard_bits));
+}
+
+// Writers take the spinlock, then make the sequence odd so readers know to retry.
+static void anr__concurrent_hashtable_lock(anr_concurrent_hashtable_shard* shard)
+{
+	while (anr__atomic_exchange(&shard->lock, 1)) {
+		while (anr__atomic_load(&shard->lock)) ANR__CPU_RELAX();
+	}
+	anr__atomic_store(&shard->sequence, shard->sequence + 1);
+	anr__atomic_fence_release();
+}
+
+static void anr__concurrent_hashtable_unlock(anr_concurrent_hashtable_shard* shard)
+{
+	anr__atomic_store(&shard->sequence, shard->sequence + 1);
+	anr__atomic_store(&shard->lock, 0);
+}
+
+anr_concurrent_hashtable anr_concurrent_hashtable_create(uint32_t data_size, uint32_t key_size, anr_hash_func hash)
+{
+	return anr_concurrent_hashtable_create_ex(data_size, key_size, hash, 0, NULL);
+}
+
+anr_concurrent_hashtable anr_concurrent_hashtable_create_ex(uint32_t data_size, uint32_t key_size, anr_hash_func hash, uint32_t shard_count, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(shard_count <= (1u << 16));
+	if (shard_count == 0) shard_count = ANR_CONCURRENT_HASHTABLE_SHARDS;
+	anr_concurrent_hashtable table = (anr_concurrent_hashtable){.ds_type = ANR_DS_CONCURRENT_HASHTABLE, .data_size = data_size, .key_size = key_size, .allocator = allocator};
+	table.hash = hash ? hash : anr_hash_bytes;
+	table.shard_count = 1;
+	while (table.shard_count < shard_count) {
+		table.shard_count <<= 1;
+		table.shard_bits++;
+	}
+
+	table.shards = ANR__DATA_ALLOC(allocator, (size_t)table.shard_count*sizeof(anr_concurrent_hashtable_shard));
+	ANRDATA_ASSERT(table.shards);
+	memset(table.shards, 0, (size_t)table.shard_count*sizeof(anr_concurrent_hashtable_shard));
+	for (uint32_t i = 0; i < table.shard_count; i++)
+	{
+		// The shard allocator points back at the shard, so it is set up in place.
+		anr_concurrent_hashtable_shard* shard = table.shards + i;
+		shard->parent = allocator;
+		shard->allocator = (anr_allocator){anr__concurrent_hashtable_alloc, anr__concurrent_hashtable_realloc, anr__concurrent_hashtable_retire, shard};
+		shard->retired = anr_array_create_ex(sizeof(void*), 4, ANR_ARRAY_POLICY_DEFAULT, allocator);
+		shard->table = anr_hashtable_create_ex(data_size, key_size, table.hash, &shard->allocator);
+	}
+	return table;
+}
+
+// Copy the table header and validate it before probing, the probe only touches blocks that are 
+// still allocated. The entry is validated again after it was copied out.
+uint8_t anr_concurrent_hashtable_get(void* ds, const void* key, void* out)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(key);
+	ANRDATA_ASSERT(out);
+	anr_concurrent_hashtable* table = ds;
+	uint64_t hash = table->hash(key, table->key_size);
+	anr_concurrent_hashtable_shard* shard = anr__concurrent_hashtable_shard(table, hash);
+	for (;;)
+	{
+		uint64_t sequence = anr__atomic_load(&shard->sequence);
+		if (sequence & 1) {
+			ANR__CPU_RELAX();
+			continue;
+		}
+		anr_hashtable snapshot = shard->table;
+		anr__atomic_fence_acquire();
+		if (anr__atomic_load(&shard->sequence) != sequence) continue;
+
+		uint32_t index = anr__hashtable_find_hash(&snapshot, key, hash);
+		if (index != -1) memcpy(out, (uint8_t*)snapshot.slots + (size_t)index*snapshot.data_size, snapshot.data_size);
+		anr__atomic_fence_acquire();
+		if (anr__atomic_load(&shard->sequence) == sequence) return index != -1;
+	}
+}
+
+uint8_t anr_concurrent_hashtable_put(void* ds, void* ptr)
+{
+	return anr_concurrent_hashtable_add(ds, ptr) != -1;
+}
+
+uint8_t anr_concurrent_hashtable_erase(void* ds, const void* key)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(key);
+	anr_concurrent_hashtable* table = ds;
+	uint64_t hash = table->hash(key, table->key_size);
+	anr_concurrent_hashtable_shard* shard = anr__concurrent_hashtable_shard(table, hash);
+	anr__concurrent_hashtable_lock(shard);
+	uint32_t index = anr__hashtable_find_hash(&shard->table, key, hash);
+	uint8_t result = index != -1 && anr_hashtable_remove_at(&shard->table, index);
+	anr__concurrent_hashtable_unlock(shard);
+	return result;
+}
+
+void anr_concurrent_hashtable_reclaim(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	for (uint32_t i = 0; i < table->shard_count; i++)
+	{
+		anr_concurrent_hashtable_shard* shard = table->shards + i;
+		anr__concurrent_hashtable_lock(shard);
+		for (int32_t r = 0; r < shard->retired.length; r++) ANR__DATA_FREE(shard->parent, ((void**)shard->retired.data)[r]);
+		shard->retired.length = 0;
+		anr__concurrent_hashtable_unlock(shard);
+	}
+}
+
+int32_t anr_concurrent_hashtable_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_concurrent_hashtable* table = ds;
+	uint64_t hash = table->hash(ptr, table->key_size);
+	anr_concurrent_hashtable_shard* shard = anr__concurrent_hashtable_shard(table, hash);
+	anr__concurrent_hashtable_lock(shard);
+	int32_t index = anr__hashtable_add_hash(&shard->table, ptr, hash);
+	anr__concurrent_hashtable_unlock(shard);
+	if (index == -1) return -1;
+	return index*table->shard_count + (uint32_t)(shard - table->shards);
+}
+
+void anr_concurrent_hashtable_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	for (uint32_t i = 0; i < table->shard_count; i++) anr_hashtable_free(&table->shards[i].table);
+	anr_concurrent_hashtable_reclaim(ds);
+	for (uint32_t i = 0; i < table->shard_count; i++) anr_array_free(&table->shards[i].retired);
+	ANR__DATA_FREE(table->allocator, table->shards);
+	table->shards = 0;
+}
+
+#ifdef ANR_DATA_DEBUG
+void anr_concurrent_hashtable_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	char* line = malloc(200);
+	snprintf(line, 200, "concurrent hashtable %p has %d shards\n", table, table->shard_count);
+	ANR_DS_ADD(&curr_print, line);
+	for (uint32_t i = 0; i < table->shard_count; i++)
+	{
+		anr_concurrent_hashtable_shard* shard = table->shards + i;
+		anr__concurrent_hashtable_lock(shard);
+		anr_hashtable* inner = &shard->table;
+		char* line = malloc(200);
+		snprintf(line, 200, "shard %d has %d items, %d capacity\n", i, inner->length, inner->capacity);
+		ANR_DS_ADD(&curr_print, line);
+		for (uint32_t slot = 0; slot < inner->capacity; slot++)
+		{
+			if (inner->ctrl[slot] < 0) continue;
+			char* line = malloc(200);
+			snprintf(line, 200, "#%d ", slot);
+			uint8_t* data = (uint8_t*)inner->slots + (size_t)slot*inner->data_size;
+			for (uint32_t x = 0; x < inner->data_size; x++) {
+				snprintf(line+strlen(line), 200-strlen(line), "%x", data[x]);
+			}
+			snprintf(line+strlen(line), 200-strlen(line), "\n");
+			ANR_DS_ADD(&curr_print, line);
+		}
+		anr__concurrent_hashtable_unlock(shard);
+	}
+	anr__print_diff();
+}
+#else
+void anr_concurrent_hashtable_print(void* ds)
+{
+	(void)ds;
+}
+#endif
+
+void* anr_concurrent_hashtable_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	return anr_hashtable_find_at(&table->shards[index & (table->shard_count-1)].table, index >> table->shard_bits);
+}
+
+uint32_t anr_concurrent_hashtable_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	if (ptr == NULL) return -1;
+	anr_concurrent_hashtable* table = ds;
+	uint64_t hash = table->hash(ptr, table->key_size);
+	anr_concurrent_hashtable_shard* shard = anr__concurrent_hashtable_shard(table, hash);
+	uint32_t index = anr__hashtable_find_hash(&shard->table, ptr, hash);
+	if (index == -1) return -1;
+	return index*table->shard_count + (uint32_t)(shard - table->shards);
+}
+
+uint8_t anr_concurrent_hashtable_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	anr_concurrent_hashtable_shard* shard = table->shards + (index & (table->shard_count-1));
+	anr__concurrent_hashtable_lock(shard);
+	uint8_t result = anr_hashtable_remove_at(&shard->table, index >> table->shard_bits);
+	anr__concurrent_hashtable_unlock(shard);
+	return result;
+}
+
+uint8_t anr_concurrent_hashtable_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	if (!ptr) return 0;
+	anr_concurrent_hashtable* table = ds;
+	for (uint32_t i = 0; i < table->shard_count; i++)
+	{
+		anr_hashtable* shard_table = &table->shards[i].table;
+		uint8_t* slots = shard_table->slots;
+		if ((uint8_t*)ptr >= slots && (uint8_t*)ptr < slots + (size_t)shard_table->capacity*shard_table->data_size) {
+			uint32_t slot = (uint32_t)(((uint8_t*)ptr - slots) / shard_table->data_size);
+			return anr_concurrent_hashtable_remove_at(ds, slot*table->shard_count + i);
+		}
+	}
+	return 0;
+}
+
+uint8_t anr_concurrent_hashtable_insert(void* ds, uint32_t index, void* ptr)
+{
+	(void)index;
+	return anr_concurrent_hashtable_add(ds, ptr) != -1;
+}
+
+uint32_t anr_concurrent_hashtable_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	uint32_t length = 0;
+	for (uint32_t i = 0; i < table->shard_count; i++) length += table->shards[i].table.length;
+	return length;
+}
+
+anr_iter anr_concurrent_hashtable_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_iter iter;
+	iter.data = NULL;
+	iter.index = -1;
+	iter.hm.bucket = 0; // Shard.
+	iter.hm.slot = 0; // Next slot in shard.
+	return iter;
+}
+
+uint8_t anr_concurrent_hashtable_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(iter);
+	anr_concurrent_hashtable* table = ds;
+	while (iter->hm.bucket < table->shard_count)
+	{
+		anr_iter shard_iter = anr_hashtable_iter_start(&table->shards[iter->hm.bucket].table);
+		shard_iter.index = (int32_t)iter->hm.slot - 1;
+		if (anr_hashtable_iter_next(&table->shards[iter->hm.bucket].table, &shard_iter)) {
+			iter->hm.slot = shard_iter.index + 1;
+			iter->index = shard_iter.index*table->shard_count + iter->hm.bucket;
+			iter->data = shard_iter.data;
+			return 1;
+		}
+		iter->hm.bucket++;
+		iter->hm.slot = 0;
+	}
+	iter->data = NULL;
+	return 0;
+}
+
+// Indices interleave the shards, index*shard_count + shard, so every shard is locked once for its part.
+uint8_t anr_concurrent_hashtable_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	uint64_t end = (uint64_t)index + count;
+	uint32_t capacity = 0;
+	for (uint32_t i = 0; i < table->shard_count; i++) {
+		if (table->shards[i].table.capacity > capacity) capacity = table->shards[i].table.capacity;
+	}
+	if (end > (uint64_t)capacity*table->shard_count) return 0;
+	for (uint32_t i = 0; i < table->shard_count && count; i++)
+	{
+		// Slots of shard i whose index falls in [index, end).
+		uint64_t first = index > i ? (index - i + table->shard_count - 1) / table->shard_count : 0;
+		uint64_t last = end > i ? (end - i + table->shard_count - 1) / table->shard_count : 0;
+		if (first >= last) continue;
+		anr_concurrent_hashtable_shard* shard = table->shards + i;
+		anr__concurrent_hashtable_lock(shard);
+		anr_hashtable_remove_range(&shard->table, (uint32_t)first, (uint32_t)(last - first));
+		anr__concurrent_hashtable_unlock(shard);
+	}
+	return 1;
+}
+
+uint32_t anr_concurrent_hashtable_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	anr_concurrent_hashtable* table = ds;
+	uint32_t removed = 0;
+	for (uint32_t i = 0; i < table->shard_count; i++)
+	{
+		anr__concurrent_hashtable_lock(table->shards + i);
+		removed += anr_hashtable_remove_if(&table->shards[i].table, predicate, ctx);
+		anr__concurrent_hashtable_unlock(table->shards + i);
+	}
+	return removed;
+}
+
+#define ANR__MPMC_SEQUENCE(_queue, _pos) ((uint64_t*)((_queue)->cells + (size_t)((_pos) & ((_queue)->capacity-1))*(_queue)->cell_size))
+#define ANR__MPMC_DATA(_queue, _pos) ((uint8_t*)ANR__MPMC_SEQUENCE(_queue, _pos) + sizeof(uint64_t))
+
+anr_mpmc_queue anr_mpmc_queue_create(uint32_t data_size, uint32_t capacity)
+{
+	return anr_mpmc_queue_create_ex(data_size, capacity, NULL);
+}
+
+anr_mpmc_queue anr_mpmc_queue_create_ex(uint32_t data_size, uint32_t capacity, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	ANRDATA_ASSERT(capacity > 1 && capacity <= (1u << 31));
+	uint32_t rounded = 2;
+	while (rounded < capacity) rounded <<= 1;
+
+	anr_mpmc_queue queue = (anr_mpmc_queue){.ds_type = ANR_DS_MPMC_QUEUE, .data_size = data_size, .capacity = rounded, .allocator = allocator};
+	queue.cell_size = (sizeof(uint64_t) + data_size + 7) & ~7u;
+	queue.cells = ANR__DATA_ALLOC(allocator, (size_t)rounded*queue.cell_size);
+	ANRDATA_ASSERT(queue.cells);
+	for (uint32_t i = 0; i < rounded; i++) *ANR__MPMC_SEQUENCE(&queue, i) = i;
+	return queue;
+}
+
+// Vyukov's bounded queue: a cell is free for the push at pos when its sequence is pos, and holds
+// the entry for the pop at pos when it is pos+1. The pop hands it to the push at pos+capacity.
+uint8_t anr_mpmc_queue_try_push(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_mpmc_queue* queue = ds;
+	uint64_t pos = anr__atomic_load(&queue->enqueue_pos);
+	for (;;)
+	{
+		uint64_t sequence = anr__atomic_load(ANR__MPMC_SEQUENCE(queue, pos));
+		int64_t diff = (int64_t)(sequence - pos);
+		if (diff == 0) {
+			if (anr__atomic_cas(&queue->enqueue_pos, &pos, pos+1)) break;
+		}
+		else if (diff < 0) {
+			return 0; // Previous lap not popped yet, queue is full.
+		}
+		else {
+			pos = anr__atomic_load(&queue->enqueue_pos);
+		}
+	}
+	memcpy(ANR__MPMC_DATA(queue, pos), ptr, queue->data_size);
+	anr__atomic_store(ANR__MPMC_SEQUENCE(queue, pos), pos+1);
+	return 1;
+}
+
+uint8_t anr_mpmc_queue_try_pop(void* ds, void* out)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(out);
+	anr_mpmc_queue* queue = ds;
+	uint64_t pos = anr__atomic_load(&queue->dequeue_pos);
+	for (;;)
+	{
+		uint64_t sequence = anr__atomic_load(ANR__MPMC_SEQUENCE(queue, pos));
+		int64_t diff = (int64_t)(sequence - (pos+1));
+		if (diff == 0) {
+			if (anr__atomic_cas(&queue->dequeue_pos, &pos, pos+1)) break;
+		}
+		else if (diff < 0) {
+			return 0; // Not pushed yet, queue is empty.
+		}
+		else {
+			pos = anr__atomic_load(&queue->dequeue_pos);
+		}
+	}
+	memcpy(out, ANR__MPMC_DATA(queue, pos), queue->data_size);
+	anr__atomic_store(ANR__MPMC_SEQUENCE(queue, pos), pos + queue->capacity);
+	return 1;
+}
+
+int32_t anr_mpmc_queue_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_mpmc_queue* queue = ds;
+	if (!anr_mpmc_queue_try_push(ds, ptr)) return -1;
+	return (int32_t)(queue->enqueue_pos - queue->dequeue_pos - 1);
+}
+
+void anr_mpmc_queue_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_mpmc_queue* queue = ds;
+	ANR__DATA_FREE(queue->allocator, queue->cells);
+	queue->cells = 0;
+	queue->enqueue_pos = 0;
+	queue->dequeue_pos = 0;
+}
+
+#ifdef ANR_DATA_DEBUG
+// Not synchronised, only print a queue nobody is using.
+void anr_mpmc_queue_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_mpmc_queue* queue = ds;
+	char* line = malloc(200);
+	snprintf(line, 200, "mpmc queue %p has %d items, %d capacity, dequeue %" PRIu64 " enqueue %" PRIu64 "\n", 
+		queue, (uint32_t)(queue->enqueue_pos - queue->dequeue_pos), queue->capacity, queue->dequeue_pos, queue->enqueue_pos);
+	ANR_DS_ADD(&curr_print, line);
+	for (uint64_t pos = queue->dequeue_pos; pos != queue->enqueue_pos; pos++)
+	{
+		char* line = malloc(200);
+		snprintf(line, 200, "#%d seq %" PRIu64 " ", (uint32_t)(pos - queue->dequeue_pos), *ANR__MPMC_SEQUENCE(queue, pos));
+		uint8_t* data = ANR__MPMC_DATA(queue, pos);
+		for (uint32_t x = 0; x < queue->data_size; x++) {
+			snprintf(line+strlen(line), 200-strlen(line), "%x", data[x]);
+		}
+		snprintf(line+strlen(line), 200-strlen(line), "\n");
+		ANR_DS_ADD(&curr_print, line);
+	}
+	anr__print_diff();
+}
+#else
+void anr_mpmc_queue_print(void* ds)
+{
+	(void)ds;
+}
+#endif
+
+void* anr_mpmc_queue_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_mpmc_queue* queue = ds;
+	if (index >= queue->enqueue_pos - queue->dequeue_pos) return 0;
+	return ANR__MPMC_DATA(queue, queue->dequeue_pos + index);
+}
+
+uint32_t anr_mpmc_queue_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_mpmc_queue* queue = ds;
+	uint32_t length = (uint32_t)(queue->enqueue_pos - queue->dequeue_pos);
+	for (uint32_t i = 0; i < length; i++) {
+		if (anr__data_equal(ANR__MPMC_DATA(queue, queue->dequeue_pos + i), ptr, queue->data_size)) return i;
+	}
+	return -1;
+}
+
+// Entries before index move up one cell, then the front is popped. Sequence numbers stay with the cells.
+uint8_t anr_mpmc_queue_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_mpmc_queue* queue = ds;
+	if (index >= queue->enqueue_pos - queue->dequeue_pos) return 0;
+	for (uint64_t pos = queue->dequeue_pos + index; pos > queue->dequeue_pos; pos--) {
+		memcpy(ANR__MPMC_DATA(queue, pos), ANR__MPMC_DATA(queue, pos-1), queue->data_size);
+	}
+	*ANR__MPMC_SEQUENCE(queue, queue->dequeue_pos) = queue->dequeue_pos + queue->capacity;
+	queue->dequeue_pos++;
+	return 1;
+}
+
+uint8_t anr_mpmc_queue_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_mpmc_queue* queue = ds;
+	if ((uint8_t*)ptr < queue->cells) return 0;
+	size_t position = ((uint8_t*)ptr - queue->cells) / queue->cell_size;
+	if (position >= queue->capacity) return 0;
+	return anr_mpmc_queue_remove_at(ds, (uint32_t)((position - queue->dequeue_pos) & (queue->capacity-1)));
+}
+
+// Push a copy of the last entry, then move the entries from index up one cell.
+uint8_t anr_mpmc_queue_insert(void* ds, uint32_t index, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(ptr);
+	anr_mpmc_queue* queue = ds;
+	uint32_t length = (uint32_t)(queue->enqueue_pos - queue->dequeue_pos);
+	if (index > length) return 0;
+	if (index == length) return anr_mpmc_queue_try_push(ds, ptr);
+	if (!anr_mpmc_queue_try_push(ds, ANR__MPMC_DATA(queue, queue->enqueue_pos - 1))) return 0;
+	for (uint64_t pos = queue->dequeue_pos + length - 1; pos > queue->dequeue_pos + index; pos--) {
+		memcpy(ANR__MPMC_DATA(queue, pos), ANR__MPMC_DATA(queue, pos-1), queue->data_size);
+	}
+	memcpy(ANR__MPMC_DATA(queue, queue->dequeue_pos + index), ptr, queue->data_size);
+	return 1;
+}
+
+uint32_t anr_mpmc_queue_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_mpmc_queue* queue = ds;
+	// Dequeue first, enqueue_pos read later can only be further ahead.
+	uint64_t dequeue_pos = anr__atomic_load(&queue->dequeue_pos);
+	return (uint32_t)(anr__atomic_load(&queue->enqueue_pos) - dequeue_pos);
+}
+
+anr_iter anr_mpmc_queue_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_iter iter;
+	iter.index = -1;
+	iter.data = NULL;
+	return iter;
+}
+
+uint8_t anr_mpmc_queue_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	iter->index++;
+	iter->data = anr_mpmc_queue_find_at(ds, iter->index);
+	return iter->data != NULL;
+}
+
+static uint32_t anr__ds_data_size(void* ds)
+{
+	switch (((anr_ds*)ds)->ds_ll.ds_type)
+	{
+		case ANR_DS_LINKEDLIST: return ((anr_linked_list*)ds)->data_size;
+		case ANR_DS_DYNAMIC_ARRAY: return ((anr_array*)ds)->data_size;
+		case ANR_DS_HASHMAP: return ((anr_hashmap*)ds)->data_size;
+		case ANR_DS_HASHTABLE: return ((anr_hashtable*)ds)->data_size;
+		case ANR_DS_UNROLLED_LIST: return ((anr_unrolled_list*)ds)->data_size;
+		case ANR_DS_SEQUENCE: return ((anr_sequence*)ds)->data_size;
+		case ANR_DS_GAP_BUFFER: return ((anr_gap_buffer*)ds)->data_size;
+		case ANR_DS_DEQUE: return ((anr_deque*)ds)->data_size;
+		case ANR_DS_SORTED_ARRAY: return ((anr_sorted_array*)ds)->items.data_size;
+		case ANR_DS_MPMC_QUEUE: return ((anr_mpmc_queue*)ds)->data_size;
+		case ANR_DS_CONCURRENT_HASHTABLE: return ((anr_concurrent_hashtable*)ds)->data_size;
+		case ANR_DS_FILTERED: return anr__ds_data_size(((anr_filtered*)ds)->inner);
+		case ANR_DS_SLOT_MAP: return ((anr_slot_map*)ds)->data_size;
+	}
+	ANRDATA_ASSERT(0);
+	return 0;
+}
+
+uint8_t anr_ds_generic_add_range(void* ds, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_ds_table* table = ANR__DS_TABLE(ds);
+	uint32_t data_size = anr__ds_data_size(ds);
+	for (uint32_t i = 0; i < count; i++) {
+		if (table->add(ds, (uint8_t*)data + (size_t)i*data_size) == -1) return 0;
+	}
+	return 1;
+}
+
+uint8_t anr_ds_generic_insert_range(void* ds, uint32_t index, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(data || count == 0);
+	anr_ds_table* table = ANR__DS_TABLE(ds);
+	uint32_t data_size = anr__ds_data_size(ds);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!table->insert(ds, index+i, (uint8_t*)data + (size_t)i*data_size)) return 0;
+	}
+	return 1;
+}
+
+// Removes from the back of the range, a gap buffer keeps its gap next to the removed entries.
+uint8_t anr_ds_generic_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_ds_table* table = ANR__DS_TABLE(ds);
+	if ((uint64_t)index + count > table->length(ds)) return 0;
+	for (uint32_t i = count; i > 0; i--) {
+		if (!table->remove_at(ds, index+i-1)) return 0;
+	}
+	return 1;
+}
+
+uint32_t anr_ds_generic_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(predicate);
+	anr_ds_table* table = ANR__DS_TABLE(ds);
+	uint32_t removed = 0;
+	for (uint32_t i = 0; i < table->length(ds);)
+	{
+		if (!predicate(table->find_at(ds, i), ctx)) i++;
+		else if (table->remove_at(ds, i)) removed++;
+		else break;
+	}
+	return removed;
+}
+
+// log2 without libm: integer part by halving, fraction bits by repeated squaring.
+static double anr__log2(double x)
+{
+	double result = 0;
+	while (x >= 2) { x /= 2; result++; }
+	while (x < 1) { x *= 2; result--; }
+	double bit = 0.5;
+	for (uint32_t i = 0; i < 24; i++, bit /= 2)
+	{
+		x *= x;
+		if (x >= 2) {
+			x /= 2;
+			result += bit;
+		}
+	}
+	return result;
+}
+
+anr_bloom_filter anr_bloom_create(uint32_t expected_count, double false_positive_rate, uint32_t key_size, uint8_t counting, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(key_size > 0);
+	ANRDATA_ASSERT(false_positive_rate > 0 && false_positive_rate < 1);
+	anr_bloom_filter filter = (anr_bloom_filter){.key_size = key_size, .allocator = allocator};
+
+	// Optimal for a plain filter: log2(1/p) hashes and 1.44 bits per hash. Blocks fill unevenly, so 
+	// a blocked filter needs a little more.
+	double hashes = anr__log2(1.0 / false_positive_rate);
+	double bits_per_key = hashes * 1.4427 * 1.1;
+	filter.hash_count = (uint32_t)(hashes + 0.5);
+	if (filter.hash_count < 1) filter.hash_count = 1;
+	if (filter.hash_count > 16) filter.hash_count = 16;
+	uint64_t blocks = (uint64_t)(((double)(expected_count ? expected_count : 1) * bits_per_key + 511) / 512);
+	filter.block_count = blocks > 0 ? (uint32_t)blocks : 1;
+
+	size_t bits_size = (size_t)filter.block_count*ANR_BLOOM_BLOCK_WORDS*sizeof(uint64_t);
+	size_t counts_size = counting ? (size_t)filter.block_count*ANR_BLOOM_BLOCK_WORDS*64 : 0;
+	filter.allocation = ANR__DATA_ALLOC(allocator, bits_size + counts_size + 64);
+	ANRDATA_ASSERT(filter.allocation);
+	filter.bits = (uint64_t*)(((uintptr_t)filter.allocation + 63) & ~(uintptr_t)63);
+	if (counting) filter.counts = (uint8_t*)filter.bits + bits_size;
+	anr_bloom_clear(&filter);
+	return filter;
+}
+
+// Block from the high half of the hash, bit positions 9 bits at a time from a remix of it.
+static const uint64_t* anr__bloom_mask(const anr_bloom_filter* filter, uint64_t hash, uint64_t* mask)
+{
+	uint32_t block = (uint32_t)(((hash >> 32) * filter->block_count) >> 32);
+	uint64_t bits = hash * 0x9E3779B97F4A7C15ULL;
+	memset(mask, 0, ANR_BLOOM_BLOCK_WORDS*sizeof(uint64_t));
+	for (uint32_t i = 0; i < filter->hash_count; i++)
+	{
+		if (i && i % 7 == 0) bits = (bits ^ (bits >> 29)) * 0xff51afd7ed558ccdULL; // 7 positions per 64 bits.
+		uint32_t pos = (bits >> ((i % 7)*9)) & 511;
+		mask[pos >> 6] |= 1ULL << (pos & 63);
+	}
+	return filter->bits + (size_t)block*ANR_BLOOM_BLOCK_WORDS;
+}
+
+static uint8_t anr__bloom_contains_hash(const anr_bloom_filter* filter, uint64_t hash)
+{
+	uint64_t mask[ANR_BLOOM_BLOCK_WORDS];
+	const uint64_t* block = anr__bloom_mask(filter, hash, mask);
+#if defined(ANR__DATA_AVX2)
+	__m256i lo = _mm256_load_si256((const __m256i*)block);
+	__m256i hi = _mm256_load_si256((const __m256i*)block + 1);
+	return _mm256_testc_si256(lo, _mm256_loadu_si256((const __m256i*)mask)) & _mm256_testc_si256(hi, _mm256_loadu_si256((const __m256i*)mask + 1));
+#elif defined(ANR__DATA_SSE2)
+	__m128i missing = _mm_setzero_si128();
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		__m128i m = _mm_loadu_si128((const __m128i*)mask + i);
+		missing = _mm_or_si128(missing, _mm_andnot_si128(_mm_load_si128((const __m128i*)block + i), m));
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+	for (uint32_t w = 0; w < ANR_BLOOM_BLOCK_WORDS; w++) {
+		if ((block[w] & mask[w]) != mask[w]) return 0;
+	}
+	return 1;
+#endif
+}
+
+static void anr__bloom_add_hash(anr_bloom_filter* filter, uint64_t hash)
+{
+	uint64_t mask[ANR_BLOOM_BLOCK_WORDS];
+	uint64_t* block = (uint64_t*)anr__bloom_mask(filter, hash, mask);
+	for (uint32_t w = 0; w < ANR_BLOOM_BLOCK_WORDS; w++)
+	{
+		block[w] |= mask[w];
+		if (!filter->counts) continue;
+		uint8_t* counts = filter->counts + ((block - filter->bits) + w)*64;
+		for (uint64_t m = mask[w]; m; m &= m - 1) {
+			uint32_t bit = anr__ctz64(m);
+			if (counts[bit] < 255) counts[bit]++; // A saturated counter is never decremented.
+		}
+	}
+}
+
+static void anr__bloom_remove_hash(anr_bloom_filter* filter, uint64_t hash)
+{
+	uint64_t mask[ANR_BLOOM_BLOCK_WORDS];
+	uint64_t* block = (uint64_t*)anr__bloom_mask(filter, hash, mask);
+	for (uint32_t w = 0; w < ANR_BLOOM_BLOCK_WORDS; w++)
+	{
+		uint8_t* counts = filter->counts + ((block - filter->bits) + w)*64;
+		for (uint64_t m = mask[w]; m; m &= m - 1)
+		{
+			uint32_t bit = anr__ctz64(m);
+			if (counts[bit] == 255 || counts[bit] == 0) continue;
+			if (--counts[bit] == 0) block[w] &= ~(1ULL << bit);
+		}
+	}
+}
+
+void anr_bloom_add(anr_bloom_filter* filter, const void* key)
+{
+	ANRDATA_ASSERT(filter && key);
+	anr__bloom_add_hash(filter, anr_hash_bytes(key, filter->key_size));
+}
+
+uint8_t anr_bloom_remove(anr_bloom_filter* filter, const void* key)
+{
+	ANRDATA_ASSERT(filter && key);
+	if (!filter->counts) return 0;
+	anr__bloom_remove_hash(filter, anr_hash_bytes(key, filter->key_size));
+	return 1;
+}
+
+uint8_t anr_bloom_contains(const anr_bloom_filter* filter, const void* key)
+{
+	ANRDATA_ASSERT(filter && key);
+	return anr__bloom_contains_hash(filter, anr_hash_bytes(key, filter->key_size));
+}
+
+void anr_bloom_clear(anr_bloom_filter* filter)
+{
+	ANRDATA_ASSERT(filter);
+	memset(filter->bits, 0, (size_t)filter->block_count*ANR_BLOOM_BLOCK_WORDS*sizeof(uint64_t));
+	if (filter->counts) memset(filter->counts, 0, (size_t)filter->block_count*ANR_BLOOM_BLOCK_WORDS*64);
+}
+
+void anr_bloom_free(anr_bloom_filter* filter)
+{
+	ANRDATA_ASSERT(filter);
+	ANR__DATA_FREE(filter->allocator, filter->allocation);
+	filter->allocation = NULL;
+	filter->bits = NULL;
+	filter->counts = NULL;
+}
+
+// The filter is updated before the container so a failed add only leaves an extra bit, never a missing one.
+anr_filtered anr_filtered_create(void* inner, uint32_t key_size, uint32_t expected_count, double false_positive_rate, uint8_t counting)
+{
+	ANRDATA_ASSERT(inner);
+	ANRDATA_ASSERT(key_size <= anr__ds_data_size(inner));
+	anr_filtered filtered = (anr_filtered){.ds_type = ANR_DS_FILTERED, .inner = inner};
+	filtered.filter = anr_bloom_create(expected_count, false_positive_rate, key_size, counting, NULL);
+	anr_filtered_rebuild(&filtered);
+	return filtered;
+}
+
+void anr_filtered_rebuild(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	anr_bloom_clear(&filtered->filter);
+	ANR_ITERATE(iter, filtered->inner) { anr_bloom_add(&filtered->filter, iter.data); }
+}
+
+int32_t anr_filtered_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	anr_bloom_add(&filtered->filter, ptr);
+	return ANR__DS_TABLE(filtered->inner)->add(filtered->inner, ptr);
+}
+
+void anr_filtered_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	ANR__DS_TABLE(filtered->inner)->free(filtered->inner);
+	anr_bloom_free(&filtered->filter);
+}
+
+void anr_filtered_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	ANR__DS_TABLE(filtered->inner)->print(filtered->inner);
+}
+
+void* anr_filtered_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	return ANR__DS_TABLE(filtered->inner)->find_at(filtered->inner, index);
+}
+
+uint32_t anr_filtered_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	if (!anr_bloom_contains(&filtered->filter, ptr)) return -1;
+	return ANR__DS_TABLE(filtered->inner)->find_by(filtered->inner, ptr);
+}
+
+uint8_t anr_filtered_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	anr_ds_table* table = ANR__DS_TABLE(filtered->inner);
+	if (!filtered->filter.counts) return table->remove_at(filtered->inner, index);
+
+	void* data = table->find_at(filtered->inner, index);
+	if (!data) return 0;
+	uint64_t hash = anr_hash_bytes(data, filtered->filter.key_size); // data is gone after the remove.
+	if (!table->remove_at(filtered->inner, index)) return 0;
+	anr__bloom_remove_hash(&filtered->filter, hash);
+	return 1;
+}
+
+uint8_t anr_filtered_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	uint64_t hash = anr_hash_bytes(ptr, filtered->filter.key_size);
+	if (!ANR__DS_TABLE(filtered->inner)->remove_by(filtered->inner, ptr)) return 0;
+	if (filtered->filter.counts) anr__bloom_remove_hash(&filtered->filter, hash);
+	return 1;
+}
+
+uint8_t anr_filtered_insert(void* ds, uint32_t index, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	anr_bloom_add(&filtered->filter, ptr);
+	return ANR__DS_TABLE(filtered->inner)->insert(filtered->inner, index, ptr);
+}
+
+uint32_t anr_filtered_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	return ANR__DS_TABLE(filtered->inner)->length(filtered->inner);
+}
+
+anr_iter anr_filtered_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	return ANR__DS_TABLE(filtered->inner)->iter_start(filtered->inner);
+}
+
+uint8_t anr_filtered_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	return ANR__DS_TABLE(filtered->inner)->iter_next(filtered->inner, iter);
+}
+
+uint8_t anr_filtered_add_range(void* ds, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	uint32_t data_size = anr__ds_data_size(filtered->inner);
+	for (uint32_t i = 0; i < count; i++) anr_bloom_add(&filtered->filter, (uint8_t*)data + (size_t)i*data_size);
+	return ANR__DS_TABLE(filtered->inner)->add_range(filtered->inner, data, count);
+}
+
+uint8_t anr_filtered_insert_range(void* ds, uint32_t index, void* data, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	uint32_t data_size = anr__ds_data_size(filtered->inner);
+	for (uint32_t i = 0; i < count; i++) anr_bloom_add(&filtered->filter, (uint8_t*)data + (size_t)i*data_size);
+	return ANR__DS_TABLE(filtered->inner)->insert_range(filtered->inner, index, data, count);
+}
+
+uint8_t anr_filtered_remove_range(void* ds, uint32_t index, uint32_t count)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	anr_ds_table* table = ANR__DS_TABLE(filtered->inner);
+	if (!filtered->filter.counts || count == 0) return table->remove_range(filtered->inner, index, count);
+
+	// Hash the entries in one walk before they are gone, a list would need a walk per find_at.
+	uint64_t* hashes = malloc((size_t)count*sizeof(uint64_t));
+	if (!hashes) return 0;
+	uint32_t hashed = 0;
+	anr_iter iter = table->iter_start(filtered->inner);
+	while (hashed < count && table->iter_next(filtered->inner, &iter)) {
+		if ((uint32_t)iter.index >= index && (uint32_t)iter.index < index + count) hashes[hashed++] = anr_hash_bytes(iter.data, filtered->filter.key_size);
+	}
+	uint8_t ok = table->remove_range(filtered->inner, index, count);
+	if (ok) {
+		for (uint32_t i = 0; i < hashed; i++) anr__bloom_remove_hash(&filtered->filter, hashes[i]);
+	}
+	free(hashes);
+	return ok;
+}
+
+typedef struct
+{
+	anr_predicate_func predicate;
+	void* ctx;
+	anr_bloom_filter* filter;
+} anr__filtered_remove_ctx;
+
+// Counts go down as the predicate selects entries, the container removes them right after.
+static int anr__filtered_remove_predicate(const void* data, void* ctx)
+{
+	anr__filtered_remove_ctx* remove = ctx;
+	if (!remove->predicate(data, remove->ctx)) return 0;
+	anr__bloom_remove_hash(remove->filter, anr_hash_bytes(data, remove->filter->key_size));
+	return 1;
+}
+
+uint32_t anr_filtered_remove_if(void* ds, anr_predicate_func predicate, void* ctx)
+{
+	ANRDATA_ASSERT(ds);
+	anr_filtered* filtered = (anr_filtered*)ds;
+	anr_ds_table* table = ANR__DS_TABLE(filtered->inner);
+	if (!filtered->filter.counts) return table->remove_if(filtered->inner, predicate, ctx);
+	anr__filtered_remove_ctx remove = {predicate, ctx, &filtered->filter};
+	return table->remove_if(filtered->inner, anr__filtered_remove_predicate, &remove);
+}
+
+#define ANR__SLOT_MAP_LIVE(_generation) ((_generation) & 1) // Odd while the slot holds an entry.
+#define ANR__SLOT_MAP_NONE UINT32_MAX
+
+// Dense entries and slots grow together, there are never more slots in use than dense capacity allows.
+static uint8_t anr__slot_map_reserve(anr_slot_map* map, uint32_t count)
+{
+	if (count <= map->capacity) return 1;
+	void* data = ANR__DATA_REALLOC(map->allocator, map->data, (size_t)map->capacity*map->data_size, (size_t)count*map->data_size);
+	if (!data) return 0;
+	map->data = data;
+	uint32_t* dense_slots = ANR__DATA_REALLOC(map->allocator, map->dense_slots, (size_t)map->capacity*sizeof(uint32_t), (size_t)count*sizeof(uint32_t));
+	if (!dense_slots) return 0;
+	map->dense_slots = dense_slots;
+	map->capacity = count;
+	return 1;
+}
+
+anr_slot_map anr_slot_map_create(uint32_t data_size, uint32_t reserve_count)
+{
+	return anr_slot_map_create_ex(data_size, reserve_count, NULL);
+}
+
+anr_slot_map anr_slot_map_create_ex(uint32_t data_size, uint32_t reserve_count, anr_allocator* allocator)
+{
+	ANRDATA_ASSERT(data_size > 0);
+	anr_slot_map map = (anr_slot_map){.ds_type = ANR_DS_SLOT_MAP, .data_size = data_size, .free_head = ANR__SLOT_MAP_NONE, .allocator = allocator};
+	uint8_t reserved = reserve_count == 0 || anr__slot_map_reserve(&map, reserve_count);
+	ANRDATA_ASSERT(reserved);
+	(void)reserved;
+	return map;
+}
+
+static anr_slot_map_slot* anr__slot_map_lookup(anr_slot_map* map, anr_handle handle)
+{
+	uint32_t slot = (uint32_t)handle;
+	if (slot >= map->slot_count) return NULL;
+	anr_slot_map_slot* s = map->slots + slot;
+	return s->generation == (uint32_t)(handle >> 32) && ANR__SLOT_MAP_LIVE(s->generation) ? s : NULL;
+}
+
+anr_handle anr_slot_map_put(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	if (map->length == map->capacity && !anr__slot_map_reserve(map, map->capacity ? map->capacity*2 : 8)) return 0;
+
+	uint32_t slot = map->free_head;
+	if (slot == ANR__SLOT_MAP_NONE)
+	{
+		if (map->slot_count == map->slot_capacity)
+		{
+			uint32_t capacity = map->slot_capacity ? map->slot_capacity*2 : 8;
+			anr_slot_map_slot* slots = ANR__DATA_REALLOC(map->allocator, map->slots, (size_t)map->slot_capacity*sizeof(anr_slot_map_slot), (size_t)capacity*sizeof(anr_slot_map_slot));
+			if (!slots) return 0;
+			map->slots = slots;
+			map->slot_capacity = capacity;
+		}
+		slot = map->slot_count++;
+		map->slots[slot].generation = 0;
+	}
+	else
+	{
+		map->free_head = map->slots[slot].index;
+	}
+
+	anr_slot_map_slot* s = map->slots + slot;
+	s->generation++;
+	s->index = map->length;
+	map->dense_slots[map->length] = slot;
+	if (ptr) memcpy((uint8_t*)map->data + (size_t)map->length*map->data_size, ptr, map->data_size);
+	map->length++;
+	return ((anr_handle)s->generation << 32) | slot;
+}
+
+void* anr_slot_map_get(void* ds, anr_handle handle)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	anr_slot_map_slot* s = anr__slot_map_lookup(map, handle);
+	return s ? (uint8_t*)map->data + (size_t)s->index*map->data_size : NULL;
+}
+
+anr_handle anr_slot_map_handle_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	if (index >= map->length) return 0;
+	uint32_t slot = map->dense_slots[index];
+	return ((anr_handle)map->slots[slot].generation << 32) | slot;
+}
+
+// The last entry moves into the hole, its slot is pointed at the new position.
+uint8_t anr_slot_map_remove_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	if (index >= map->length) return 0;
+	uint32_t slot = map->dense_slots[index];
+	uint32_t last = map->length - 1;
+	if (index != last)
+	{
+		memcpy((uint8_t*)map->data + (size_t)index*map->data_size, (uint8_t*)map->data + (size_t)last*map->data_size, map->data_size);
+		map->dense_slots[index] = map->dense_slots[last];
+		map->slots[map->dense_slots[index]].index = index;
+	}
+	map->length--;
+
+	// A slot whose generation would wrap is retired, so no old handle can ever match again.
+	anr_slot_map_slot* s = map->slots + slot;
+	s->generation++;
+	if (s->generation != UINT32_MAX - 1) {
+		s->index = map->free_head;
+		map->free_head = slot;
+	}
+	return 1;
+}
+
+uint8_t anr_slot_map_erase(void* ds, anr_handle handle)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	anr_slot_map_slot* s = anr__slot_map_lookup(map, handle);
+	return s ? anr_slot_map_remove_at(map, s->index) : 0;
+}
+
+int32_t anr_slot_map_add(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	return anr_slot_map_put(map, ptr) ? (int32_t)map->length - 1 : -1;
+}
+
+void anr_slot_map_free(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	if (map->data) ANR__DATA_FREE(map->allocator, map->data);
+	if (map->dense_slots) ANR__DATA_FREE(map->allocator, map->dense_slots);
+	if (map->slots) ANR__DATA_FREE(map->allocator, map->slots);
+	map->data = NULL;
+	map->dense_slots = NULL;
+	map->slots = NULL;
+	map->length = map->capacity = map->slot_count = map->slot_capacity = 0;
+	map->free_head = ANR__SLOT_MAP_NONE;
+}
+
+#ifdef ANR_DATA_DEBUG
+void anr_slot_map_print(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = ds;
+	char* line = malloc(200);
+	snprintf(line, 200, "slot map %p has %d items, %d capacity, %d slots\n", map, map->length, map->capacity, map->slot_count);
+	ANR_DS_ADD(&curr_print, line);
+	for (uint32_t i = 0; i < map->length; i++)
+	{
+		char* line = malloc(200);
+		uint32_t slot = map->dense_slots[i];
+		snprintf(line, 200, "#%d slot %u gen %u ", i, slot, map->slots[slot].generation);
+		uint8_t* data = (uint8_t*)map->data + (size_t)i*map->data_size;
+		for (uint32_t x = 0; x < map->data_size; x++) {
+			snprintf(line+strlen(line), 200-strlen(line), "%x", data[x]);
+		}
+		snprintf(line+strlen(line), 200-strlen(line), "\n");
+		ANR_DS_ADD(&curr_print, line);
+	}
+	anr__print_diff();
+}
+#else
+void anr_slot_map_print(void* ds)
+{
+	(void)ds;
+}
+#endif
+
+void* anr_slot_map_find_at(void* ds, uint32_t index)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	if (index >= map->length) return 0;
+	return (uint8_t*)map->data + (size_t)index*map->data_size;
+}
+
+uint32_t anr_slot_map_find_by(void* ds, char* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	for (uint32_t i = 0; i < map->length; i++) {
+		if (anr__data_equal((uint8_t*)map->data + (size_t)i*map->data_size, ptr, map->data_size)) return i;
+	}
+	return -1;
+}
+
+uint8_t anr_slot_map_remove_by(void* ds, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	anr_slot_map* map = (anr_slot_map*)ds;
+	if ((uint8_t*)ptr < (uint8_t*)map->data) return 0;
+	return anr_slot_map_remove_at(map, (uint32_t)(((uint8_t*)ptr - (uint8_t*)map->data) / map->data_size));
+}
+
+// Entries have no order to keep, insert adds at the end.
+uint8_t anr_slot_map_insert(void* ds, uint32_t index, void* ptr)
+{
+	ANRDATA_ASSERT(ds);
+	if (index > ((anr_slot_map*)ds)->length) return 0;
+	return anr_slot_map_add(ds, ptr) != -1;
+}
+
+uint32_t anr_slot_map_length(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	return ((anr_slot_map*)ds)->length;
+}
+
+anr_iter anr_slot_map_iter_start(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_iter iter;
+	iter.index = -1;
+	iter.data = NULL;
+	return iter;
+}
+
+uint8_t anr_slot_map_iter_next(void* ds, anr_iter* iter)
+{
+	ANRDATA_ASSERT(ds);
+	iter->index++;
+	iter->data = anr_slot_map_find_at(ds, iter->index);
+	return iter->data != NULL;
+}
+
+anr_list anr_list_create(void)
+{
+	return (anr_list){0};
+}
+
+void anr_list_push_back(anr_list* list, anr_list_link* link)
+{
+	anr_list_insert_before(list, NULL, link);
+}
+
+void anr_list_push_front(anr_list* list, anr_list_link* link)
+{
+	anr_list_insert_after(list, NULL, link);
+}
+
+void anr_list_insert_after(anr_list* list, anr_list_link* at, anr_list_link* link)
+{
+	ANRDATA_ASSERT(list && link);
+	anr_list_link* next = at ? at->next : list->first;
+	link->prev = at;
+	link->next = next;
+	if (at) at->next = link; else list->first = link;
+	if (next) next->prev = link; else list->last = link;
+	list->length++;
+}
+
+void anr_list_insert_before(anr_list* list, anr_list_link* at, anr_list_link* link)
+{
+	ANRDATA_ASSERT(list && link);
+	anr_list_insert_after(list, at ? at->prev : list->last, link);
+}
+
+void anr_list_unlink(anr_list* list, anr_list_link* link)
+{
+	ANRDATA_ASSERT(list && link && list->length);
+	if (link->prev) link->prev->next = link->next; else list->first = link->next;
+	if (link->next) link->next->prev = link->prev; else list->last = link->prev;
+	link->prev = link->next = NULL;
+	list->length--;
+}
+
+anr_list_link* anr_list_pop_front(anr_list* list)
+{
+	ANRDATA_ASSERT(list);
+	anr_list_link* link = list->first;
+	if (link) anr_list_unlink(list, link);
+	return link;
+}
+
+// Only the links at both ends change, the entries of src are not visited.
+void anr_list_splice(anr_list* list, anr_list_link* at, anr_list* src)
+{
+	ANRDATA_ASSERT(list && src && list != src);
+	if (!src->first) return;
+	anr_list_link* prev = at ? at->prev : list->last;
+	src->first->prev = prev;
+	src->last->next = at;
+	if (prev) prev->next = src->first; else list->first = src->first;
+	if (at) at->prev = src->last; else list->last = src->last;
+	list->length += src->length;
+	*src = (anr_list){0};
+}
+
+uint32_t anr_list_length(anr_list* list)
+{
+	ANRDATA_ASSERT(list);
+	return list->length;
+}
+
+#if defined(_WIN32) && (defined(ANR_DATA_MMAP) || defined(ANR_DATA_THREADS))
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+#ifdef ANR_DATA_MMAP
+
+#ifdef _WIN32
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ANR__SNAPSHOT_MAGIC "ANRDATA"
+#define ANR__SNAPSHOT_ALIGN 64 // Fixed rather than ANR_DATA_CACHE_LINE so files do not depend on build settings.
+#define ANR__SNAPSHOT_ALIGN_UP(_x) (((_x) + ANR__SNAPSHOT_ALIGN - 1) & ~(uint64_t)(ANR__SNAPSHOT_ALIGN - 1))
+
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t ds_type;
+	uint32_t data_size;
+	uint32_t length;
+	uint32_t bucket_size; // Hashmap only, like the fields below up to table_offset.
+	uint32_t bucket_count;
+	uint32_t open_count;
+	uint32_t free_count;
+	uint32_t next_bucket;
+	uint32_t unused;
+	uint64_t table_offset; // Bucket records, then the open and free bucket numbers.
+	uint64_t data_offset; // Array entries, or the first bucket block.
+	uint64_t file_size;
+} anr__snapshot_header;
+
+typedef struct
+{
+	uint32_t bucket_start;
+	uint32_t length;
+	uint32_t open_position;
+	uint32_t unused;
+	uint64_t offset; // Occupancy masks followed by data, like the bucket allocation.
+} anr__snapshot_bucket;
+
+typedef struct
+{
+	FILE* file;
+	uint64_t pos;
+	uint8_t ok;
+} anr__snapshot_writer;
+
+static void anr__snapshot_write(anr__snapshot_writer* writer, const void* ptr, size_t size)
+{
+	if (writer->ok && size) writer->ok = fwrite(ptr, 1, size, writer->file) == size;
+	writer->pos += size;
+}
+
+static void anr__snapshot_align(anr__snapshot_writer* writer)
+{
+	static const uint8_t zeros[ANR__SNAPSHOT_ALIGN] = {0};
+	anr__snapshot_write(writer, zeros, ANR__SNAPSHOT_ALIGN_UP(writer->pos) - writer->pos);
+}
+
+static uint64_t anr__snapshot_mask_size(uint32_t bucket_size)
+{
+	return ((uint64_t)ANR__HASHMAP_MASK_WORDS((uint64_t)bucket_size) + ANR__HASHMAP_SUMMARY_WORDS((uint64_t)bucket_size)) * sizeof(uint64_t);
+}
+
+static uint64_t anr__snapshot_block_size(uint32_t bucket_size, uint32_t data_size)
+{
+	return anr__snapshot_mask_size(bucket_size) + (uint64_t)bucket_size*data_size;
+}
+
+static void anr__snapshot_save_array(anr__snapshot_writer* writer, anr_array* arr, anr__snapshot_header* header)
+{
+	header->data_size = arr->data_size;
+	header->length = arr->length;
+	anr__snapshot_align(writer);
+	header->data_offset = writer->pos;
+	anr__snapshot_write(writer, arr->data, (size_t)arr->length*arr->data_size);
+}
+
+static void anr__snapshot_save_hashmap(anr__snapshot_writer* writer, anr_hashmap* hashmap, anr__snapshot_header* header)
+{
+	header->data_size = hashmap->data_size;
+	header->length = hashmap->length;
+	header->bucket_size = hashmap->bucket_size;
+	header->bucket_count = hashmap->buckets.length;
+	header->open_count = hashmap->open_buckets.length;
+	header->free_count = hashmap->free_buckets.length;
+	header->next_bucket = hashmap->next_bucket;
+
+	anr__snapshot_align(writer);
+	header->table_offset = writer->pos;
+	uint64_t block_stride = ANR__SNAPSHOT_ALIGN_UP(anr__snapshot_block_size(hashmap->bucket_size, hashmap->data_size));
+	header->data_offset = ANR__SNAPSHOT_ALIGN_UP(header->table_offset + (uint64_t)header->bucket_count*sizeof(anr__snapshot_bucket) + (uint64_t)(header->open_count + header->free_count)*sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < header->bucket_count; i++)
+	{
+		anr_hashmap_bucket* bb = (anr_hashmap_bucket*)hashmap->buckets.data + i;
+		anr__snapshot_bucket record = {bb->bucket_start, bb->length, bb->open_position, 0, header->data_offset + i*block_stride};
+		anr__snapshot_write(writer, &record, sizeof(record));
+	}
+	anr__snapshot_write(writer, hashmap->open_buckets.data, header->open_count*sizeof(uint32_t));
+	anr__snapshot_write(writer, hashmap->free_buckets.data, header->free_count*sizeof(uint32_t));
+	for (uint32_t i = 0; i < header->bucket_count; i++)
+	{
+		anr__snapshot_align(writer);
+		anr__snapshot_write(writer, ((anr_hashmap_bucket*)hashmap->buckets.data)[i].occupied, (size_t)anr__snapshot_block_size(hashmap->bucket_size, hashmap->data_size));
+	}
+}
+
+uint8_t anr_ds_save(void* ds, const char* path)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(path);
+	anr_ds_type type = ((anr_ds*)ds)->ds_ll.ds_type;
+	if (type != ANR_DS_DYNAMIC_ARRAY && type != ANR_DS_HASHMAP) return 0;
+
+	anr__snapshot_writer writer = {fopen(path, "wb"), 0, 1};
+	if (!writer.file) return 0;
+	anr__snapshot_header header = {ANR__SNAPSHOT_MAGIC, ANR_DATA_SNAPSHOT_VERSION, type};
+	anr__snapshot_write(&writer, &header, sizeof(header)); // Written again once the offsets are known.
+	if (type == ANR_DS_DYNAMIC_ARRAY) anr__snapshot_save_array(&writer, ds, &header);
+	else anr__snapshot_save_hashmap(&writer, ds, &header);
+	header.file_size = writer.pos;
+
+	uint8_t ok = writer.ok && fseek(writer.file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, writer.file) == 1;
+	ok = fclose(writer.file) == 0 && ok;
+	if (!ok) remove(path);
+	return ok;
+}
+
+static uint8_t anr__mapped_owns(anr_mapped* mapped, void* ptr)
+{
+	return (uint8_t*)ptr >= (uint8_t*)mapped->base && (uint8_t*)ptr < (uint8_t*)mapped->base + mapped->size;
+}
+
+static void* anr__mapped_alloc(void* ctx, size_t size)
+{
+	return malloc(size);
+}
+
+static void* anr__mapped_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+	if (!anr__mapped_owns(ctx, ptr)) return realloc(ptr, new_size);
+	void* copy = malloc(new_size);
+	if (copy) memcpy(copy, ptr, old_size < new_size ? old_size : new_size);
+	return copy;
+}
+
+static void anr__mapped_free(void* ctx, void* ptr)
+{
+	if (!anr__mapped_owns(ctx, ptr)) free(ptr);
+}
+
+static uint8_t anr__mapped_map(anr_mapped* mapped, const char* path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+	LARGE_INTEGER size;
+	HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL) : NULL;
+	CloseHandle(file);
+	if (!mapping) return 0;
+	mapped->base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (!mapped->base) {
+		CloseHandle(mapping);
+		return 0;
+	}
+	mapped->size = (size_t)size.QuadPart;
+	mapped->handle = mapping;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return 0;
+	struct stat st;
+	void* base = fstat(fd, &st) == 0 && st.st_size > 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (base == MAP_FAILED) return 0;
+	mapped->base = base;
+	mapped->size = (size_t)st.st_size;
+#endif
+	return 1;
+}
+
+static void anr__mapped_unmap(anr_mapped* mapped)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(mapped->base);
+	CloseHandle(mapped->handle);
+#else
+	munmap(mapped->base, mapped->size);
+#endif
+}
+
+static uint8_t anr__mapped_open_array(anr_mapped* mapped, const anr__snapshot_header* header)
+{
+	if (header->data_offset > mapped->size || (uint64_t)header->length*header->data_size > mapped->size - header->data_offset) return 0;
+	anr_array* arr = &mapped->ds.array;
+	*arr = (anr_array){ANR_DS_DYNAMIC_ARRAY, .data = mapped->base, .data_size = header->data_size, .reserve_size = 1, .policy = ANR_ARRAY_POLICY_DEFAULT, .allocator = &mapped->allocator};
+	if (header->length) arr->data = (uint8_t*)mapped->base + header->data_offset;
+	arr->length = arr->reserved = header->length; // The first add copies the entries out of the mapping.
+	return 1;
+}
+
+// Masks have to match the record, adds and removes trust them without checking.
+static uint8_t anr__mapped_bucket_valid(anr_hashmap* hashmap, const anr__snapshot_bucket* record, const uint64_t* occupied)
+{
+	uint32_t mask_words = ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size);
+	const uint64_t* summary = occupied + mask_words;
+	uint32_t used = 0;
+	for (uint32_t w = 0; w < mask_words; w++)
+	{
+		uint64_t padding = anr__hashmap_word_padding(hashmap, w);
+		if (occupied[w] & padding) return 0;
+		uint64_t full = (occupied[w] | padding) == ~0ULL;
+		if (((summary[w >> 6] >> (w & 63)) & 1) != full) return 0;
+		used += anr__popcount64(occupied[w]);
+	}
+	uint64_t summary_padding = mask_words % 64 ? ~0ULL << (mask_words % 64) : 0;
+	if ((summary[(mask_words-1) >> 6] & summary_padding) != summary_padding) return 0;
+	return used == record->length && (record->open_position == 0) == (used == hashmap->bucket_size);
+}
+
+static uint8_t anr__mapped_open_hashmap(anr_mapped* mapped, const anr__snapshot_header* header)
+{
+	// Counts and offsets are checked before anything is read from the table, sizes in 64 bits.
+	if (header->bucket_size == 0 || (uint64_t)header->next_bucket*header->bucket_size > (uint64_t)UINT32_MAX + 1) return 0;
+	if (header->bucket_count > header->next_bucket || header->open_count > header->bucket_count || header->free_count > header->next_bucket) return 0;
+	uint64_t block_size = anr__snapshot_block_size(header->bucket_size, header->data_size);
+	uint64_t table_size = (uint64_t)header->bucket_count*sizeof(anr__snapshot_bucket) + ((uint64_t)header->open_count + header->free_count)*sizeof(uint32_t);
+	if (block_size > mapped->size || header->table_offset > mapped->size || table_size > mapped->size - header->table_offset) return 0;
+
+	anr_hashmap* hashmap = &mapped->ds.hashmap;
+	*hashmap = anr_hashmap_create_ex(header->data_size, header->bucket_size, &mapped->allocator);
+	hashmap->next_bucket = header->next_bucket;
+	size_t mask_size = (size_t)anr__snapshot_mask_size(header->bucket_size);
+
+	// Only the bucket list and directory are rebuilt, the blocks stay in the mapping.
+	const anr__snapshot_bucket* records = (const anr__snapshot_bucket*)((uint8_t*)mapped->base + header->table_offset);
+	uint64_t length = 0;
+	uint32_t open_count = 0;
+	uint8_t ok = anr_array_reserve(&hashmap->buckets, header->bucket_count ? header->bucket_count : 1) &&
+		anr_array_reserve(&hashmap->open_buckets, header->bucket_count ? header->bucket_count : 1);
+	for (uint32_t i = 0; ok && i < header->bucket_count; i++)
+	{
+		const anr__snapshot_bucket* record = records + i;
+		ok = record->offset <= mapped->size - block_size && record->offset % sizeof(uint64_t) == 0 && record->bucket_start % hashmap->bucket_size == 0 &&
+			record->bucket_start / hashmap->bucket_size < hashmap->next_bucket && record->open_position <= header->open_count;
+		if (!ok) break;
+		anr_hashmap_bucket bucket = {record->bucket_start, record->length, record->open_position};
+		bucket.occupied = (uint64_t*)((uint8_t*)mapped->base + record->offset);
+		bucket.data = (uint8_t*)bucket.occupied + mask_size;
+		uint32_t* entry = anr__hashmap_directory_entry(hashmap, bucket.bucket_start / hashmap->bucket_size, 1);
+		ok = entry && *entry == 0 && anr__mapped_bucket_valid(hashmap, record, bucket.occupied) && anr_array_add(&hashmap->buckets, &bucket) != -1;
+		if (ok) *entry = i + 1;
+		length += record->length;
+		open_count += record->open_position != 0;
+	}
+	ok = ok && length == header->length && open_count == header->open_count;
+	hashmap->length = header->length;
+
+	// Every open bucket is listed once, at the position its record points to.
+	const uint32_t* numbers = (const uint32_t*)(records + header->bucket_count);
+	for (uint32_t i = 0; ok && i < header->open_count; i++)
+	{
+		anr_hashmap_bucket* bucket = numbers[i] < hashmap->next_bucket ? anr__hashmap_find_bucket(hashmap, numbers[i] * hashmap->bucket_size) : NULL;
+		ok = bucket && bucket->open_position == i + 1 && anr_array_add(&hashmap->open_buckets, (void*)(numbers + i)) != -1;
+	}
+	for (uint32_t i = 0; ok && i < header->free_count; i++)
+	{
+		// Files written before the free list was exact can hold numbers of live or already listed buckets.
+		uint32_t bucket_nr = numbers[header->open_count + i];
+		uint32_t* entry = bucket_nr < hashmap->next_bucket ? anr__hashmap_directory_entry(hashmap, bucket_nr, 1) : NULL;
+		ok = entry != NULL;
+		if (!ok || *entry) continue;
+		int32_t position = anr_array_add(&hashmap->free_buckets, &bucket_nr);
+		ok = position != -1;
+		if (ok) *entry = ANR__HASHMAP_RELEASED | position;
+	}
+	if (!ok) anr_hashmap_free(hashmap);
+	return ok;
+}
+
+anr_mapped* anr_ds_open_mapped(const char* path)
+{
+	ANRDATA_ASSERT(path);
+	anr_mapped* mapped = calloc(1, sizeof(anr_mapped));
+	if (!mapped) return NULL;
+	if (!anr__mapped_map(mapped, path)) {
+		free(mapped);
+		return NULL;
+	}
+	mapped->allocator = (anr_allocator){anr__mapped_alloc, anr__mapped_realloc, anr__mapped_free, mapped};
+
+	const anr__snapshot_header* header = mapped->base;
+	uint8_t ok = mapped->size >= sizeof(anr__snapshot_header) && memcmp(header->magic, ANR__SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+		header->version == ANR_DATA_SNAPSHOT_VERSION && header->file_size == mapped->size && header->data_size > 0;
+	if (ok && header->ds_type == ANR_DS_DYNAMIC_ARRAY) ok = anr__mapped_open_array(mapped, header);
+	else if (ok && header->ds_type == ANR_DS_HASHMAP) ok = anr__mapped_open_hashmap(mapped, header);
+	else ok = 0;
+
+	if (!ok) {
+		anr__mapped_unmap(mapped);
+		free(mapped);
+		return NULL;
+	}
+	return mapped;
+}
+
+void anr_ds_close_mapped(anr_mapped* mapped)
+{
+	ANRDATA_ASSERT(mapped);
+	ANR_DS_FREE((anr_ds*)&mapped->ds);
+	anr__mapped_unmap(mapped);
+	free(mapped);
+}
+
+#define ANR__FILE_MAGIC "ANRARRAY"
+#define ANR__FILE_VERSION 1
+#define ANR__FILE_HEADER_SIZE 4096 // One page, keeps the entries page aligned.
+
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t data_size;
+	uint64_t length; // As of the last anr_array_sync.
+} anr__file_header;
+
+// The allocator of a file backed array, the entries block lives in the file and anything else, like sort scratch, on the heap.
+typedef struct
+{
+	anr_allocator allocator; // First, the array reaches the storage through its allocator pointer.
+	uint8_t* base; // Header page followed by the entries.
+	size_t size; // Mapped bytes, the file has the same size.
+	anr_access_hint hint;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+} anr__file_storage;
+
+static void anr__file_advise(anr__file_storage* storage)
+{
+#if !defined(_WIN32) && defined(MADV_SEQUENTIAL)
+	int advice = storage->hint == ANR_ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : storage->hint == ANR_ACCESS_RANDOM ? MADV_RANDOM : MADV_NORMAL;
+	madvise(storage->base, storage->size, advice);
+#endif
+}
+
+// Resize the file to size and map all of it. On failure the current mapping stays as it was.
+static uint8_t anr__file_map(anr__file_storage* storage, size_t size)
+{
+#ifdef _WIN32
+	// A file with a mapped view can not be cut, it keeps its largest size and a smaller request keeps the current view.
+	// Growing maps the new view before the old one goes, so a failure leaves the array as it was.
+	if (storage->base && size <= storage->size) return 1;
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(storage->file, end, NULL, FILE_BEGIN) || !SetEndOfFile(storage->file)) return 0;
+	HANDLE mapping = CreateFileMappingA(storage->file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+	if (!mapping) return 0;
+	void* base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!base) {
+		CloseHandle(mapping);
+		return 0;
+	}
+	if (storage->base) {
+		UnmapViewOfFile(storage->base);
+		CloseHandle(storage->mapping);
+	}
+	storage->mapping = mapping;
+	storage->base = base;
+#else
+	// Grow the file before the mapping and shrink it after, pages past the end of the file fault.
+	if (size > storage->size && ftruncate(storage->fd, (off_t)size) != 0) return 0;
+	void* base;
+	if (!storage->base) base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, storage->fd, 0);
+#ifdef MREMAP_MAYMOVE
+	else base = mremap(storage->base, storage->size, size, MREMAP_MAYMOVE);
+#else
+	else {
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, storage->fd, 0); // Both views share the page cache, nothing is copied.
+		if (base != MAP_FAILED) munmap(storage->base, storage->size);
+	}
+#endif
+	if (base == MAP_FAILED) return 0;
+	// A file that can not be cut is only larger than the mapping, which stays valid.
+	int cut = size < storage->size ? ftruncate(storage->fd, (off_t)size) : 0;
+	(void)cut;
+	storage->base = base;
+#endif
+	storage->size = size;
+	anr__file_advise(storage);
+	return 1;
+}
+
+static uint8_t anr__file_owns(anr__file_storage* storage, void* ptr)
+{
+	return storage->base && ptr == storage->base + ANR__FILE_HEADER_SIZE;
+}
+
+static void* anr__file_alloc(void* ctx, size_t size)
+{
+	anr__file_storage* storage = ctx;
+	if (storage->base) return malloc(size);
+	if (!anr__file_map(storage, ANR__FILE_HEADER_SIZE + size)) return NULL;
+	return storage->base + ANR__FILE_HEADER_SIZE;
+}
+
+static void* anr__file_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+	anr__file_storage* storage = ctx;
+	if (!anr__file_owns(storage, ptr)) return realloc(ptr, new_size);
+	if (!anr__file_map(storage, ANR__FILE_HEADER_SIZE + new_size)) return NULL;
+	return storage->base + ANR__FILE_HEADER_SIZE;
+}
+
+// Freeing the entries, or NULL while the array is set up, is the array being done with its storage, the file stays.
+static void anr__file_free(void* ctx, void* ptr)
+{
+	anr__file_storage* storage = ctx;
+	if (ptr && !anr__file_owns(storage, ptr)) {
+		free(ptr);
+		return;
+	}
+#ifdef _WIN32
+	if (storage->base) {
+		UnmapViewOfFile(storage->base);
+		CloseHandle(storage->mapping);
+	}
+	CloseHandle(storage->file);
+#else
+	if (storage->base) munmap(storage->base, storage->size);
+	close(storage->fd);
+#endif
+	free(storage);
+}
+
+static anr__file_storage* anr__file_storage_of(anr_array* arr)
+{
+	ANRDATA_ASSERT(arr->allocator && arr->allocator->alloc == anr__file_alloc); // Not a file backed array.
+	return (anr__file_storage*)arr->allocator;
+}
+
+anr_array anr_array_create_file(const char* path, uint32_t data_size, uint32_t reserve_count, anr_access_hint hint)
+{
+	ANRDATA_ASSERT(path);
+	ANRDATA_ASSERT(data_size > 0);
+	if (reserve_count == 0) reserve_count = 1;
+	anr_array arr = (anr_array){ANR_DS_DYNAMIC_ARRAY, .data = 0, .data_size = data_size, .length = 0, .reserve_size = reserve_count, .reserved = 0, .policy = ANR_ARRAY_POLICY_DEFAULT};
+	anr__file_storage* storage = calloc(1, sizeof(anr__file_storage));
+	if (!storage) return arr;
+	storage->allocator = (anr_allocator){anr__file_alloc, anr__file_realloc, anr__file_free, storage};
+	storage->hint = hint;
+
+	uint64_t file_size;
+#ifdef _WIN32
+	storage->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	if (storage->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(storage->file, &size)) {
+		if (storage->file != INVALID_HANDLE_VALUE) CloseHandle(storage->file);
+		free(storage);
+		return arr;
+	}
+	DWORD returned;
+	DeviceIoControl(storage->file, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &returned, NULL); // Unwritten ranges take no disk space.
+	file_size = (uint64_t)size.QuadPart;
+#else
+	storage->fd = open(path, O_RDWR | O_CREAT, 0644);
+	struct stat st;
+	if (storage->fd < 0 || fstat(storage->fd, &st) != 0) {
+		if (storage->fd >= 0) close(storage->fd);
+		free(storage);
+		return arr;
+	}
+	file_size = (uint64_t)st.st_size; // ftruncate leaves holes, the file is sparse.
+#endif
+
+	// Continue an existing file if it holds entries of the same size.
+	uint64_t length = 0;
+	uint64_t capacity = reserve_count;
+	if (file_size > 0)
+	{
+		anr__file_header header;
+		uint8_t ok = file_size >= ANR__FILE_HEADER_SIZE + data_size && anr__file_map(storage, (size_t)file_size);
+		if (ok) memcpy(&header, storage->base, sizeof(header));
+		ok = ok && memcmp(header.magic, ANR__FILE_MAGIC, sizeof(header.magic)) == 0 && header.version == ANR__FILE_VERSION && header.data_size == data_size;
+		if (!ok) {
+			anr__file_free(storage, NULL);
+			return arr;
+		}
+		length = header.length;
+		capacity = (file_size - ANR__FILE_HEADER_SIZE) / data_size;
+		if (capacity > INT32_MAX) capacity = INT32_MAX;
+		if (length > capacity) length = capacity;
+	}
+	else
+	{
+		anr__file_header header = {ANR__FILE_MAGIC, ANR__FILE_VERSION, data_size, 0};
+		if (!anr__file_map(storage, ANR__FILE_HEADER_SIZE + (size_t)capacity*data_size)) {
+			anr__file_free(storage, NULL);
+			return arr;
+		}
+		memcpy(storage->base, &header, sizeof(header));
+	}
+
+	arr.data = storage->base + ANR__FILE_HEADER_SIZE;
+	arr.reserved = (int32_t)capacity;
+	arr.length = (int32_t)length;
+	arr.allocator = &storage->allocator;
+	return arr;
+}
+
+uint8_t anr_array_sync(void* ds)
+{
+	ANRDATA_ASSERT(ds);
+	anr_array* arr = (anr_array*)ds;
+	anr__file_storage* storage = anr__file_storage_of(arr);
+	((anr__file_header*)storage->base)->length = (uint64_t)arr->length;
+	size_t used = ANR__FILE_HEADER_SIZE + (size_t)arr->length*arr->data_size;
+#ifdef _WIN32
+	return FlushViewOfFile(storage->base, used) && FlushFileBuffers(storage->file);
+#else
+	return msync(storage->base, used, MS_SYNC) == 0;
+#endif
+}
+
+void anr_array_advise(void* ds, anr_access_hint hint)
+{
+	ANRDATA_ASSERT(ds);
+	anr__file_storage* storage = anr__file_storage_of((anr_array*)ds);
+	storage->hint = hint;
+	anr__file_advise(storage);
+}
+
+#endif // ANR_DATA_MMAP
+
+#ifdef ANR_DATA_THREADS
+
+#ifdef _WIN32
+typedef HANDLE anr__thread;
+typedef CRITICAL_SECTION anr__mutex;
+typedef CONDITION_VARIABLE anr__cond;
+#define ANR__THREAD_FUNC DWORD WINAPI
+#define ANR__THREAD_START(_thread, _func, _arg) ((*(_thread) = CreateThread(NULL, 0, _func, _arg, 0, NULL)) != NULL)
+#define ANR__THREAD_JOIN(_thread) (WaitForSingleObject(_thread, INFINITE), CloseHandle(_thread))
+#define ANR__MUTEX_INIT(_mutex) InitializeCriticalSection(_mutex)
+#define ANR__MUTEX_LOCK(_mutex) EnterCriticalSection(_mutex)
+#define ANR__MUTEX_UNLOCK(_mutex) LeaveCriticalSection(_mutex)
+#define ANR__COND_INIT(_cond) InitializeConditionVariable(_cond)
+#define ANR__COND_WAIT(_cond, _mutex) SleepConditionVariableCS(_cond, _mutex, INFINITE)
+#define ANR__COND_BROADCAST(_cond) WakeAllConditionVariable(_cond)
+#else
+#include <pthread.h>
+typedef pthread_t anr__thread;
+typedef pthread_mutex_t anr__mutex;
+typedef pthread_cond_t anr__cond;
+#define ANR__THREAD_FUNC void*
+#define ANR__THREAD_START(_thread, _func, _arg) (pthread_create(_thread, NULL, _func, _arg) == 0)
+#define ANR__THREAD_JOIN(_thread) pthread_join(_thread, NULL)
+#define ANR__MUTEX_INIT(_mutex) pthread_mutex_init(_mutex, NULL)
+#define ANR__MUTEX_LOCK(_mutex) pthread_mutex_lock(_mutex)
+#define ANR__MUTEX_UNLOCK(_mutex) pthread_mutex_unlock(_mutex)
+#define ANR__COND_INIT(_cond) pthread_cond_init(_cond, NULL)
+#define ANR__COND_WAIT(_cond, _mutex) pthread_cond_wait(_cond, _mutex)
+#define ANR__COND_BROADCAST(_cond) pthread_cond_broadcast(_cond)
+#endif
+
+#define ANR__PARALLEL_CHUNKS_PER_THREAD 16 // More chunks than threads so uneven work can be taken over.
+
+typedef struct
+{
+	uint64_t next; // Next chunk, taken with an atomic add by the owner and by thieves.
+	uint64_t end;
+	uint8_t pad[ANR_DATA_CACHE_LINE - 2*sizeof(uint64_t)];
+} anr__parallel_queue;
+
+typedef struct
+{
+	void* ds;
+	anr_ds_type type;
+	anr_parallel_func fn;
+	anr_reduce_func reduce;
+	void* ctx;
+	uint8_t* accs; // One result_size accumulator per chunk when reducing.
+	uint32_t result_size;
+	uint32_t chunk_size; // Entries per chunk, buckets per chunk for hashmaps.
+	uint32_t chunk_count;
+	anr_iter* starts; // Iterator before the first entry of each chunk, for containers without a split.
+	uint32_t participants;
+	anr__parallel_queue* queues; // One per participant, holding its share of the chunks.
+} anr__parallel_job;
+
+// Calls from one thread at a time, the worker threads sleep between jobs.
+static struct
+{
+	anr__thread* threads;
+	uint32_t thread_count;
+	uint8_t initialized;
+	uint8_t stop;
+	anr__mutex mutex;
+	anr__cond start;
+	anr__cond done;
+	uint64_t generation; // Bumped for every job.
+	uint64_t spawn_generation; // Generation when the newest threads were started, they wait for the one after.
+	uint32_t busy; // Workers that did not finish the current job.
+	anr__parallel_job* job;
+} anr__pool;
+
+static void anr__parallel_chunk(anr__parallel_job* job, uint32_t chunk)
+{
+	uint8_t* acc = job->accs ? job->accs + (size_t)chunk*job->result_size : NULL;
+	#define ANR__PARALLEL_CALL(_data, _index) (job->reduce ? job->reduce(acc, _data, _index, job->ctx) : job->fn(_data, _index, job->ctx))
+
+	if (job->type == ANR_DS_DYNAMIC_ARRAY)
+	{
+		anr_array* arr = job->ds;
+		uint32_t first = chunk*job->chunk_size;
+		uint32_t last = first + job->chunk_size < (uint32_t)arr->length ? first + job->chunk_size : (uint32_t)arr->length;
+		for (uint32_t i = first; i < last; i++) ANR__PARALLEL_CALL((uint8_t*)arr->data + (size_t)i*arr->data_size, i);
+	}
+	else if (job->type == ANR_DS_HASHMAP)
+	{
+		anr_hashmap* hashmap = job->ds;
+		uint32_t first = chunk*job->chunk_size;
+		uint32_t last = first + job->chunk_size < (uint32_t)hashmap->buckets.length ? first + job->chunk_size : (uint32_t)hashmap->buckets.length;
+		for (uint32_t b = first; b < last; b++)
+		{
+			anr_hashmap_bucket* bb = (anr_hashmap_bucket*)hashmap->buckets.data + b;
+			for (uint32_t w = 0; w < ANR__HASHMAP_MASK_WORDS(hashmap->bucket_size); w++)
+			{
+				for (uint64_t mask = bb->occupied[w]; mask; mask &= mask - 1)
+				{
+					uint32_t slot = w*64 + anr__ctz64(mask);
+					ANR__PARALLEL_CALL((uint8_t*)bb->data + (size_t)slot*hashmap->data_size, bb->bucket_start + slot);
+				}
+			}
+		}
+	}
+	else
+	{
+		anr_ds_table* table = ANR__DS_TABLE(job->ds);
+		anr_iter iter = job->starts[chunk];
+		for (uint32_t n = 0; n < job->chunk_size && table->iter_next(job->ds, &iter); n++) ANR__PARALLEL_CALL(iter.data, iter.index);
+	}
+	#undef ANR__PARALLEL_CALL
+}
+
+// Work through the own queue, then take chunks from the other queues.
+static void anr__parallel_run(anr__parallel_job* job, uint32_t participant)
+{
+	for (uint32_t q = 0; q < job->participants; q++)
+	{
+		anr__parallel_queue* queue = job->queues + (participant + q) % job->participants;
+		while (anr__atomic_load(&queue->next) < queue->end)
+		{
+			uint64_t chunk = anr__atomic_fetch_add(&queue->next, 1);
+			if (chunk >= queue->end) break;
+			anr__parallel_chunk(job, (uint32_t)chunk);
+		}
+	}
+}
+
+static ANR__THREAD_FUNC anr__pool_worker(void* arg)
+{
+	uint32_t participant = (uint32_t)(uintptr_t)arg;
+	ANR__MUTEX_LOCK(&anr__pool.mutex);
+	uint64_t seen = anr__pool.spawn_generation; // The thread may only get here after the first job was posted.
+	for (;;)
+	{
+		while (anr__pool.generation == seen && !anr__pool.stop) ANR__COND_WAIT(&anr__pool.start, &anr__pool.mutex);
+		if (anr__pool.stop) break;
+		seen = anr__pool.generation;
+		anr__parallel_job* job = anr__pool.job;
+		ANR__MUTEX_UNLOCK(&anr__pool.mutex);
+
+		if (participant < job->participants) anr__parallel_run(job, participant);
+
+		ANR__MUTEX_LOCK(&anr__pool.mutex);
+		if (--anr__pool.busy == 0) ANR__COND_BROADCAST(&anr__pool.done);
+	}
+	ANR__MUTEX_UNLOCK(&anr__pool.mutex);
+	return 0;
+}
+
+// Start worker threads until there are thread_count, returns how many there are.
+static uint32_t anr__pool_reserve(uint32_t thread_count)
+{
+	if (!anr__pool.initialized)
+	{
+		ANR__MUTEX_INIT(&anr__pool.mutex);
+		ANR__COND_INIT(&anr__pool.start);
+		ANR__COND_INIT(&anr__pool.done);
+		anr__pool.initialized = 1;
+	}
+	if (thread_count <= anr__pool.thread_count) return anr__pool.thread_count;
+
+	anr__thread* threads = realloc(anr__pool.threads, thread_count*sizeof(anr__thread));
+	if (!threads) return anr__pool.thread_count;
+	anr__pool.threads = threads;
+	anr__pool.spawn_generation = anr__pool.generation;
+	while (anr__pool.thread_count < thread_count)
+	{
+		// Participant 0 is the calling thread.
+		if (!ANR__THREAD_START(&threads[anr__pool.thread_count], anr__pool_worker, (void*)(uintptr_t)(anr__pool.thread_count + 1))) break;
+		anr__pool.thread_count++;
+	}
+	return anr__pool.thread_count;
+}
+
+static void anr__parallel_dispatch(void* ds, anr_parallel_func fn, anr_reduce_func reduce, anr_combine_func combine, void* ctx, void* result, uint32_t result_size, uint32_t thread_count)
+{
+	ANRDATA_ASSERT(ds);
+	anr__parallel_job job = {0};
+	job.ds = ds;
+	job.type = ((anr_ds*)ds)->ds_ll.ds_type;
+	job.fn = fn;
+	job.reduce = reduce;
+	job.ctx = ctx;
+	job.result_size = result_size;
+	if (job.type == ANR_DS_SORTED_ARRAY) {
+		job.ds = &((anr_sorted_array*)ds)->items;
+		job.type = ANR_DS_DYNAMIC_ARRAY;
+	}
+	if (thread_count == 0) thread_count = 1;
+	if (thread_count > 1) thread_count = anr__pool_reserve(thread_count - 1) + 1;
+
+	uint32_t units = job.type == ANR_DS_HASHMAP ? (uint32_t)((anr_hashmap*)job.ds)->buckets.length : ANR__DS_TABLE(job.ds)->length(job.ds);
+	uint32_t target = thread_count*ANR__PARALLEL_CHUNKS_PER_THREAD;
+	job.chunk_size = (units + target - 1) / target;
+	if (job.chunk_size == 0) return;
+	job.chunk_count = (units + job.chunk_size - 1) / job.chunk_size;
+	job.participants = thread_count < job.chunk_count ? thread_count : job.chunk_count;
+
+	job.queues = malloc(job.participants*sizeof(anr__parallel_queue));
+	ANRDATA_ASSERT(job.queues);
+	for (uint32_t p = 0; p < job.participants; p++)
+	{
+		job.queues[p].next = (uint64_t)job.chunk_count*p / job.participants;
+		job.queues[p].end = (uint64_t)job.chunk_count*(p+1) / job.participants;
+	}
+
+	if (job.type != ANR_DS_DYNAMIC_ARRAY && job.type != ANR_DS_HASHMAP)
+	{
+		// One walk to find where each chunk starts, a linked list can not be split any other way.
+		anr_ds_table* table = ANR__DS_TABLE(job.ds);
+		job.starts = malloc(job.chunk_count*sizeof(anr_iter));
+		ANRDATA_ASSERT(job.starts);
+		anr_iter iter = table->iter_start(job.ds);
+		job.starts[0] = iter;
+		for (uint32_t n = 1; n < job.chunk_count*job.chunk_size && table->iter_next(job.ds, &iter); n++) {
+			if (n % job.chunk_size == 0) job.starts[n / job.chunk_size] = iter;
+		}
+	}
+
+	if (reduce)
+	{
+		job.accs = malloc((size_t)job.chunk_count*result_size);
+		ANRDATA_ASSERT(job.accs);
+		for (uint32_t c = 0; c < job.chunk_count; c++) memcpy(job.accs + (size_t)c*result_size, result, result_size);
+	}
+
+	if (job.participants > 1)
+	{
+		ANR__MUTEX_LOCK(&anr__pool.mutex);
+		anr__pool.job = &job;
+		anr__pool.busy = anr__pool.thread_count;
+		anr__pool.generation++;
+		ANR__COND_BROADCAST(&anr__pool.start);
+		ANR__MUTEX_UNLOCK(&anr__pool.mutex);
+
+		anr__parallel_run(&job, 0);
+
+		ANR__MUTEX_LOCK(&anr__pool.mutex);
+		while (anr__pool.busy) ANR__COND_WAIT(&anr__pool.done, &anr__pool.mutex);
+		ANR__MUTEX_UNLOCK(&anr__pool.mutex);
+	}
+	else
+	{
+		anr__parallel_run(&job, 0);
+	}
+
+	if (reduce)
+	{
+		for (uint32_t c = 0; c < job.chunk_count; c++) combine(result, job.accs + (size_t)c*result_size, ctx);
+		free(job.accs);
+	}
+	free(job.starts);
+	free(job.queues);
+}
+
+void anr_ds_parallel_for(void* ds, anr_parallel_func fn, void* ctx, uint32_t thread_count)
+{
+	ANRDATA_ASSERT(fn);
+	anr__parallel_dispatch(ds, fn, NULL, NULL, ctx, NULL, 0, thread_count);
+}
+
+void anr_ds_parallel_reduce(void* ds, anr_reduce_func reduce, anr_combine_func combine, void* ctx, void* result, uint32_t result_size, uint32_t thread_count)
+{
+	ANRDATA_ASSERT(reduce);
+	ANRDATA_ASSERT(combine);
+	ANRDATA_ASSERT(result && result_size > 0);
+	anr__parallel_dispatch(ds, NULL, reduce, combine, ctx, result, result_size, thread_count);
+}
+
+#define ANR__PARALLEL_SORT_MIN (1 << 14) // Smaller arrays are sorted by the calling thread.
+#define ANR__PARALLEL_MERGE_SPLITS 4 // Pieces per thread in every merge pass.
+
+typedef struct
+{
+	size_t size;
+	anr_compare_func compare;
+} anr__sort_ctx;
+
+// Sorts a in place when out is NULL, otherwise writes outputs [first, last) of the stable merge of a and b.
+typedef struct
+{
+	uint8_t* a;
+	uint32_t a_count;
+	uint8_t* b;
+	uint32_t b_count;
+	uint8_t* out;
+	uint32_t first;
+	uint32_t last;
+} anr__sort_task;
+
+// Number of entries taken from a for the first d outputs of the merge, ties take from a first.
+static uint32_t anr__merge_split(const anr__sort_task* task, uint32_t d, const anr__sort_ctx* sort)
+{
+	uint32_t lo = d > task->b_count ? d - task->b_count : 0;
+	uint32_t hi = d < task->a_count ? d : task->a_count;
+	while (lo < hi)
+	{
+		uint32_t i = lo + (hi - lo) / 2;
+		if (sort->compare(task->a + i*sort->size, task->b + (d-i-1)*sort->size) <= 0) lo = i+1;
+		else hi = i;
+	}
+	return lo;
+}
+
+static void anr__sort_task_run(void* data, uint32_t index, void* ctx)
+{
+	anr__sort_task* task = data;
+	const anr__sort_ctx* sort = ctx;
+	size_t size = sort->size;
+	if (!task->out) {
+		qsort(task->a, task->a_count, size, sort->compare);
+		return;
+	}
+
+	uint32_t ia = anr__merge_split(task, task->first, sort);
+	uint32_t a_end = anr__merge_split(task, task->last, sort);
+	uint32_t ib = task->first - ia;
+	uint32_t b_end = task->last - a_end;
+	uint8_t* out = task->out + (size_t)task->first*size;
+	while (ia < a_end && ib < b_end)
+	{
+		if (sort->compare(task->b + (size_t)ib*size, task->a + (size_t)ia*size) < 0) memcpy(out, task->b + (size_t)ib++*size, size);
+		else memcpy(out, task->a + (size_t)ia++*size, size);
+		out += size;
+	}
+	memcpy(out, task->a + (size_t)ia*size, (size_t)(a_end - ia)*size);
+	memcpy(out + (size_t)(a_end - ia)*size, task->b + (size_t)ib*size, (size_t)(b_end - ib)*size);
+}
+
+uint8_t anr_array_parallel_sort(void* ds, anr_compare_func compare, uint32_t thread_count)
+{
+	ANRDATA_ASSERT(ds);
+	ANRDATA_ASSERT(compare);
+	anr_array* arr = (anr_array*)ds;
+	uint32_t n = arr->length;
+	if (thread_count < 2 || n < ANR__PARALLEL_SORT_MIN) {
+		anr_array_sort(arr, compare);
+		return 1;
+	}
+
+	uint8_t* scratch = ANR__DATA_ALLOC(arr->allocator, (size_t)n*arr->data_size);
+	if (!scratch) return 0;
+	anr__sort_ctx sort = {arr->data_size, compare};
+	anr_array tasks = anr_array_create(sizeof(anr__sort_task), thread_count*ANR__PARALLEL_MERGE_SPLITS*2);
+
+	// One qsort run per thread.
+	uint32_t run = (n + thread_count - 1) / thread_count;
+	for (uint32_t start = 0; start < n; start += run)
+	{
+		anr__sort_task task = {(uint8_t*)arr->data + (size_t)start*sort.size, n - start < run ? n - start : run};
+		anr_array_add(&tasks, &task);
+	}
+	anr_ds_parallel_for(&tasks, anr__sort_task_run, &sort, thread_count);
+
+	// Merge pairs of runs, each merge is split into pieces by output position so all threads take part.
+	uint8_t* src = arr->data;
+	uint8_t* dst = scratch;
+	for (; run < n; run *= 2)
+	{
+		tasks.length = 0;
+		for (uint32_t start = 0; start < n; start += 2*run)
+		{
+			uint32_t a_count = n - start < run ? n - start : run;
+			uint32_t b_count = n - start - a_count < run ? n - start - a_count : run;
+			uint32_t total = a_count + b_count;
+			uint32_t pieces = (uint32_t)((uint64_t)total*thread_count*ANR__PARALLEL_MERGE_SPLITS / n);
+			if (pieces == 0) pieces = 1;
+			for (uint32_t p = 0; p < pieces; p++)
+			{
+				anr__sort_task task = {
+					src + (size_t)start*sort.size, a_count,
+					src + (size_t)(start + a_count)*sort.size, b_count,
+					dst + (size_t)start*sort.size,
+					(uint32_t)((uint64_t)total*p / pieces), (uint32_t)((uint64_t)total*(p+1) / pieces)
+				};
+				anr_array_add(&tasks, &task);
+			}
+		}
+		anr_ds_parallel_for(&tasks, anr__sort_task_run, &sort, thread_count);
+		uint8_t* swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != arr->data) memcpy(arr->data, src, (size_t)n*sort.size);
+
+	anr_array_free(&tasks);
+	ANR__DATA_FREE(arr->allocator, scratch);
+	return 1;
+}
+
+void anr_ds_parallel_shutdown()
+{
+	if (!anr__pool.initialized) return;
+	ANR__MUTEX_LOCK(&anr__pool.mutex);
+	anr__pool.stop = 1;
+	ANR__COND_BROADCAST(&anr__pool.start);
+	ANR__MUTEX_UNLOCK(&anr__pool.mutex);
+
+	for (uint32_t i = 0; i < anr__pool.thread_count; i++) ANR__THREAD_JOIN(anr__pool.threads[i]);
+	free(anr__pool.threads);
+	anr__pool.threads = NULL;
+	anr__pool.thread_count = 0;
+	anr__pool.stop = 0;
+}
+
+#endif // ANR_DATA_THREADS
+
+#define ANR__ARENA_ALIGN 16
+#define ANR__ARENA_HEADER ANR__ARENA_ALIGN // Room for the previous block pointer.
+
+static void* anr__arena_alloc(void* ctx, size_t size)
+{
+	anr_arena* arena = ctx;
+	size = (size + ANR__ARENA_ALIGN - 1) & ~(size_t)(ANR__ARENA_ALIGN - 1);
+	if (!arena->block || arena->used + size > arena->block_size)
+	{
+		size_t block_size = arena->min_block_size;
+		if (block_size < size + ANR__ARENA_HEADER) block_size = size + ANR__ARENA_HEADER;
+		uint8_t* block = malloc(block_size);
+		if (!block) return 0;
+		*(uint8_t**)block = arena->block;
+		arena->block = block;
+		arena->block_size = block_size;
+		arena->used = ANR__ARENA_HEADER;
+	}
+	void* result = arena->block + arena->used;
+	arena->used += size;
+	arena->last = result;
+	return result;
+}
+
+static void* anr__arena_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+	anr_arena* arena = ctx;
+	if (!ptr) return anr__arena_alloc(ctx, new_size);
+
+	// Last allocation can grow or shrink in place.
+	if (ptr == arena->last) {
+		size_t offset = (uint8_t*)ptr - arena->block;
+		size_t size = (new_size + ANR__ARENA_ALIGN - 1) & ~(size_t)(ANR__ARENA_ALIGN - 1);
+		if (offset + size <= arena->block_size) {
+			arena->used = offset + size;
+			return ptr;
+		}
+	}
+
+	void* result = anr__arena_alloc(ctx, new_size);
+	if (!result) return 0;
+	memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+	return result;
+}
+
+static void anr__arena_free(void* ctx, void* ptr)
+{
+	anr_arena* arena = ctx;
+	if (ptr && ptr == arena->last) {
+		arena->used = (uint8_t*)ptr - arena->block;
+		arena->last = 0;
+	}
+}
+
+anr_arena anr_arena_create(size_t block_size)
+{
+	ANRDATA_ASSERT(block_size > ANR__ARENA_HEADER);
+	return (anr_arena){.block = 0, .block_size = 0, .used = 0, .min_block_size = block_size, .last = 0};
+}
+
+anr_allocator anr_arena_allocator(anr_arena* arena)
+{
+	ANRDATA_ASSERT(arena);
+	return (anr_allocator){anr__arena_alloc, anr__arena_realloc, anr__arena_free, arena};
+}
+
+void anr_arena_reset(anr_arena* arena)
+{
+	ANRDATA_ASSERT(arena);
+	if (!arena->block) return;
+	uint8_t* prev = *(uint8_t**)arena->block;
+	while (prev)
+	{
+		uint8_t* next = *(uint8_t**)prev;
+		free(prev);
+		prev = next;
+	}
+	*(uint8_t**)arena->block = 0;
+	arena->used = ANR__ARENA_HEADER;
+	arena->last = 0;
+}
+
+void anr_arena_free(anr_arena* arena)
+{
+	ANRDATA_ASSERT(arena);
+	anr_arena_reset(arena);
+	free(arena->block);
+	arena->block = 0;
+	arena->block_size = 0;
+	arena->used = 0;
+}
+
 #endif // ANR_DATA_IMPLEMENTATION
 
 /*
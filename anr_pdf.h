@@ -44,6 +44,7 @@ LICENSE
 //		Links
 
 #include <inttypes.h>
+#include <stddef.h>
 
 #ifndef ANRPDF_ASSERT
 #include <assert.h>
@@ -87,6 +88,18 @@ LICENSE
 
 #define ANR_PDF_PLACEHOLDER_REF "00000000"
 
+#ifndef ANR_ALLOCATOR_DEFINED
+#define ANR_ALLOCATOR_DEFINED
+// Shared by anr_data.h, anr_pdf.h and anr_sc.h. A NULL allocator means malloc/realloc/free.
+typedef struct
+{
+	void* (*alloc)(void* ctx, size_t size);
+	void* (*realloc)(void* ctx, void* ptr, size_t old_size, size_t new_size);
+	void  (*free)(void* ctx, void* ptr);
+	void* ctx;
+} anr_allocator;
+#endif
+
 typedef uint64_t anr_pdf_id;
 
 typedef struct 
@@ -283,6 +296,9 @@ typedef enum
 
 typedef struct
 {
+	anr_allocator* allocator; // NULL uses malloc/realloc/free.
+	char out_of_memory; // Set when a buffer could not grow, writes after that are dropped.
+
 	// Main data buffer
 	char* body_buffer;
 	uint64_t body_write_cursor;
@@ -337,10 +353,11 @@ typedef struct
 
 
 // === DOCUMENT OPERATIONS === 
-ANRPDFDEF anr_pdf* 			anr_pdf_document_begin();
+ANRPDFDEF anr_pdf* 			anr_pdf_document_begin(); // NULL when out of memory
+ANRPDFDEF anr_pdf* 			anr_pdf_document_begin_ex(anr_allocator* allocator); // Allocator has to outlive the document.
 ANRPDFDEF void 				anr_pdf_document_end(anr_pdf* pdf);
 ANRPDFDEF void 				anr_pdf_document_free(anr_pdf* pdf);
-ANRPDFDEF void 				anr_pdf_write_to_file(anr_pdf* pdf, const char* path);
+ANRPDFDEF char 				anr_pdf_write_to_file(anr_pdf* pdf, const char* path); // 0 if the file could not be written or the document ran out of memory
 // item_on_page optional, parent optional.
 ANRPDFDEF anr_pdf_bookmark 	anr_pdf_document_add_bookmark(anr_pdf* pdf, anr_pdf_page page, anr_pdf_obj* item_on_page, 
 								anr_pdf_bookmark* parent, const char* text); 
@@ -415,45 +432,52 @@ static char anr__pdf_ref_valid(anr_pdf_ref ref)
 	return ref.id > 0;
 }
 
-static char* anr__pdf_encode_asciihex(const char* src, char* dest, uint64_t src_size, uint64_t dest_size)
+#define ANR__PDF_ALLOC(_pdf, _size) ((_pdf)->allocator ? (_pdf)->allocator->alloc((_pdf)->allocator->ctx, _size) : malloc(_size))
+#define ANR__PDF_REALLOC(_pdf, _ptr, _old_size, _new_size) ((_pdf)->allocator ? (_pdf)->allocator->realloc((_pdf)->allocator->ctx, _ptr, _old_size, _new_size) : realloc(_ptr, _new_size))
+#define ANR__PDF_FREE(_pdf, _ptr) ((_pdf)->allocator ? (_pdf)->allocator->free((_pdf)->allocator->ctx, _ptr) : free(_ptr))
+
+static char* anr__pdf_encode_asciihex(const char* src, char* dest, uint64_t src_size)
 {
 	for (uint64_t i = 0; i < src_size; i++) {
-		dest[i*2]   = "0123456789ABCDEF"[src[i] >> 4];
-		dest[i*2+1] = "0123456789ABCDEF"[src[i] & 0x0F];
+		unsigned char c = (unsigned char)src[i];
+		dest[i*2]   = "0123456789ABCDEF"[c >> 4];
+		dest[i*2+1] = "0123456789ABCDEF"[c & 0x0F];
 	}
 	return dest;
 }
 
-static uint64_t anr__pdf_append_bytes(anr_pdf* pdf, const char* bytes, uint64_t size)
+// Grows buffer to hold at least size bytes. On failure the old buffer is kept and out_of_memory is set.
+static char anr__pdf_reserve(anr_pdf* pdf, char** buffer, uint32_t* buf_size, uint64_t size)
 {
-	char* encoded_data = malloc(size*2 + 1); // asciihex uses at most size*2
-	char* ptr = (char*)encoded_data;
+	if (pdf->out_of_memory) return 0;
+	uint64_t new_size = *buf_size;
+	while (size >= new_size) new_size += ANR_PDF_BUFFER_RESERVE;
+	if (new_size == *buf_size) return 1;
 
-	// Encode data
-	if (pdf->writing_to_stream) {
-		switch(pdf->stream_encoding) {
-			case ANR_PDF_STREAM_ENCODE_NONE: ptr = (char*)bytes; break;
-			case ANR_PDF_STREAM_ENCODE_ASCIIHEX: 
-				ptr = anr__pdf_encode_asciihex(bytes, ptr, size, sizeof(encoded_data));				
-				size = size*2;
-			break;
-		}
-	}
-	else {
-		ptr = (char*)bytes;
+	char* grown = new_size > UINT32_MAX ? NULL : ANR__PDF_REALLOC(pdf, *buffer, *buf_size, new_size);
+	if (!grown) {
+		pdf->out_of_memory = 1;
+		return 0;
 	}
+	*buffer = grown;
+	*buf_size = (uint32_t)new_size;
+	return 1;
+}
 
-	// check buffer bounds
-	while (pdf->body_write_cursor + size >= pdf->buf_size)
-	{
-		pdf->buf_size += ANR_PDF_BUFFER_RESERVE;
-		pdf->body_buffer = realloc(pdf->body_buffer, pdf->buf_size);
-	}
+static uint64_t anr__pdf_append_bytes(anr_pdf* pdf, const char* bytes, uint64_t size)
+{
+	char encode_hex = pdf->writing_to_stream && pdf->stream_encoding == ANR_PDF_STREAM_ENCODE_ASCIIHEX;
+	uint64_t encoded_size = encode_hex ? size*2 : size; // asciihex uses size*2
+
+	if (!anr__pdf_reserve(pdf, &pdf->body_buffer, &pdf->buf_size, pdf->body_write_cursor + encoded_size)) return pdf->body_write_cursor;
+
+	// Encode straight into the body buffer.
+	char* dest = pdf->body_buffer + pdf->body_write_cursor;
+	if (encode_hex) anr__pdf_encode_asciihex(bytes, dest, size);
+	else memcpy(dest, bytes, size);
 
-	memcpy(pdf->body_buffer + pdf->body_write_cursor, ptr, size);
 	uint64_t result = pdf->body_write_cursor;
-	pdf->body_write_cursor += size;
-	free(encoded_data);
+	pdf->body_write_cursor += encoded_size;
 	return result;
 }
 
@@ -504,16 +528,11 @@ static anr_pdf_ref anr__pdf_begin_obj(anr_pdf* pdf)
 	sprintf(offset_str, "%" PRId64 , pdf->body_write_cursor);
 	memcpy(xref_entry + 10 - strlen(offset_str), offset_str, strlen(offset_str));
 
-	// check buffer bounds
-	while (pdf->xref.write_cursor + XREF_ENTRY_SIZE >= pdf->xref.buf_size)
-	{
-		pdf->xref.buf_size += ANR_PDF_BUFFER_RESERVE;
-		pdf->xref.buffer = realloc(pdf->xref.buffer, pdf->xref.buf_size);
+	if (anr__pdf_reserve(pdf, &pdf->xref.buffer, &pdf->xref.buf_size, pdf->xref.write_cursor + XREF_ENTRY_SIZE)) {
+		memcpy(pdf->xref.buffer + pdf->xref.write_cursor, xref_entry, XREF_ENTRY_SIZE);
+		pdf->xref.write_cursor += XREF_ENTRY_SIZE;
 	}
 
-	memcpy(pdf->xref.buffer + pdf->xref.write_cursor, xref_entry, XREF_ENTRY_SIZE);
-	pdf->xref.write_cursor += XREF_ENTRY_SIZE;
-
 	char newobj_entry[30];
 	sprintf(newobj_entry, "\n%" PRId64 " 0 obj", id);
 	anr__pdf_append_str(pdf, newobj_entry);
@@ -639,6 +658,7 @@ static anr_pdf_ref anr__pdf_append_outlines(anr_pdf* pdf)
 static void anr__pdf_replace_placeholder_id(anr_pdf* pdf, uint64_t offset, anr_pdf_ref ref)
 {
 	// We write the pdf in one go but some objects need to reference eachother.. :(
+	if (pdf->out_of_memory) return; // The placeholder might not have been written.
 	char idbuf[20];
 	sprintf(idbuf, "%" PRId64, ref.id);
 	int len = strlen(idbuf);
@@ -721,9 +741,16 @@ static void anr__create_default_font(anr_pdf* pdf) {
 
 anr_pdf* anr_pdf_document_begin()
 {
-	anr_pdf* pdf = malloc(sizeof(anr_pdf));
+	return anr_pdf_document_begin_ex(NULL);
+}
+
+anr_pdf* anr_pdf_document_begin_ex(anr_allocator* allocator)
+{
+	anr_pdf* pdf = allocator ? allocator->alloc(allocator->ctx, sizeof(anr_pdf)) : malloc(sizeof(anr_pdf));
+	if (!pdf) return NULL;
 	memset(pdf, 0, sizeof(anr_pdf));
-	pdf->body_buffer = malloc(ANR_PDF_BUFFER_RESERVE);
+	pdf->allocator = allocator;
+	pdf->body_buffer = ANR__PDF_ALLOC(pdf, ANR_PDF_BUFFER_RESERVE);
 	pdf->buf_size = ANR_PDF_BUFFER_RESERVE;
 	pdf->body_write_cursor = 0;
 	pdf->next_obj_id = 1;
@@ -731,9 +758,13 @@ anr_pdf* anr_pdf_document_begin()
 	pdf->stream_encoding = ANR_PDF_STREAM_ENCODE_NONE;
 	pdf->writing_to_stream = 0;
 
-	pdf->xref.buffer = malloc(ANR_PDF_BUFFER_RESERVE);
+	pdf->xref.buffer = ANR__PDF_ALLOC(pdf, ANR_PDF_BUFFER_RESERVE);
 	pdf->xref.write_cursor = 0;
 	pdf->xref.buf_size = ANR_PDF_BUFFER_RESERVE;
+	if (!pdf->body_buffer || !pdf->xref.buffer) {
+		anr_pdf_document_free(pdf);
+		return NULL;
+	}
 
 	pdf->page.is_written = 1;
 
@@ -745,9 +776,11 @@ anr_pdf* anr_pdf_document_begin()
 
 void anr_pdf_document_free(anr_pdf* pdf)
 {
-	free(pdf->body_buffer);
-	free(pdf->xref.buffer);
-	free(pdf);
+	anr_allocator* allocator = pdf->allocator;
+	if (pdf->body_buffer) ANR__PDF_FREE(pdf, pdf->body_buffer);
+	if (pdf->xref.buffer) ANR__PDF_FREE(pdf, pdf->xref.buffer);
+	if (allocator) allocator->free(allocator->ctx, pdf);
+	else free(pdf);
 }
 
 void anr_pdf_document_end(anr_pdf* pdf)
@@ -757,11 +790,14 @@ void anr_pdf_document_end(anr_pdf* pdf)
 	anr__pdf_append_str(pdf, "\n%%EOF\n");
 }
 
-void anr_pdf_write_to_file(anr_pdf* pdf, const char* path)
+char anr_pdf_write_to_file(anr_pdf* pdf, const char* path)
 {
+	if (pdf->out_of_memory) return 0;
 	FILE* file = anr__pdf_fopen(path, "wb");
-	fwrite(pdf->body_buffer, 1, pdf->body_write_cursor, file);
+	if (!file) return 0;
+	char ok = fwrite(pdf->body_buffer, 1, pdf->body_write_cursor, file) == pdf->body_write_cursor;
 	anr__pdf_fclose(file);
+	return ok;
 }
 
 void anr_pdf_page_begin(anr_pdf* pdf, anr_pdf_page_size size)
@@ -27,9 +27,25 @@ before you include this file in *one* C file to create the implementation.
 #define ANRSC_ASSERT(x) assert(x)
 #endif
 
+#ifndef ANR_ALLOCATOR_DEFINED
+#define ANR_ALLOCATOR_DEFINED
+// Shared by anr_data.h, anr_pdf.h and anr_sc.h. A NULL allocator means malloc/realloc/free.
+typedef struct
+{
+	void* (*alloc)(void* ctx, size_t size);
+	void* (*realloc)(void* ctx, void* ptr, size_t old_size, size_t new_size);
+	void  (*free)(void* ctx, void* ptr);
+	void* ctx;
+} anr_allocator;
+#endif
+
 ANRSCDEF uint8_t* anr_sc_deflate(uint8_t* data, uint32_t length, uint32_t* out_length);
 ANRSCDEF uint8_t* anr_sc_inflate(uint8_t* data, uint32_t length, uint32_t* out_length);
 
+// Result is allocated with allocator, NULL uses malloc. Returns NULL when the allocation fails.
+ANRSCDEF uint8_t* anr_sc_deflate_ex(uint8_t* data, uint32_t length, uint32_t* out_length, anr_allocator* allocator);
+ANRSCDEF uint8_t* anr_sc_inflate_ex(uint8_t* data, uint32_t length, uint32_t* out_length, anr_allocator* allocator);
+
 #endif // INCLUDE_ANR_SC_H
 
 #ifdef ANR_SC_IMPLEMENTATION
@@ -47,7 +63,14 @@ int cmpfunc (const void * a, const void * b) {
    return ( (*(anr_sc_val*)a).count - (*(anr_sc_val*)b).count );
 }
 
+#define ANR__SC_ALLOC(_allocator, _size) ((_allocator) ? (_allocator)->alloc((_allocator)->ctx, _size) : malloc(_size))
+
 uint8_t* anr_sc_inflate(uint8_t* data, uint32_t length, uint32_t* out_length)
+{
+	return anr_sc_inflate_ex(data, length, out_length, NULL);
+}
+
+uint8_t* anr_sc_inflate_ex(uint8_t* data, uint32_t length, uint32_t* out_length, anr_allocator* allocator)
 {
 	anr_sc_val table[TABLE_SIZE];
 	for (int i = 0; i < TABLE_SIZE; i++)
@@ -55,7 +78,8 @@ uint8_t* anr_sc_inflate(uint8_t* data, uint32_t length, uint32_t* out_length)
 		table[i].val = data[i];
 	}
 
-	uint8_t* inflated = malloc(length*8); // ballpark
+	uint8_t* inflated = ANR__SC_ALLOC(allocator, (size_t)length*8); // ballpark
+	if (!inflated) return NULL;
 	uint32_t inflated_cursor = 0;
 
 	uint8_t current_block_table = 0;
@@ -121,6 +145,11 @@ uint8_t* anr_sc_inflate(uint8_t* data, uint32_t length, uint32_t* out_length)
 }
 
 uint8_t* anr_sc_deflate(uint8_t* data, uint32_t length, uint32_t* out_length)
+{
+	return anr_sc_deflate_ex(data, length, out_length, NULL);
+}
+
+uint8_t* anr_sc_deflate_ex(uint8_t* data, uint32_t length, uint32_t* out_length, anr_allocator* allocator)
 {
 	anr_sc_val values[256];
 	for (uint32_t i = 0; i < 256; i++)
@@ -158,7 +187,8 @@ uint8_t* anr_sc_deflate(uint8_t* data, uint32_t length, uint32_t* out_length)
 	
 	// Write encoding table.
 	uint32_t max_size = length + MAX_ENCODED_CHARS + (length/8);
-	uint8_t* deflated = malloc(max_size);
+	uint8_t* deflated = ANR__SC_ALLOC(allocator, max_size);
+	if (!deflated) return NULL;
 	memset(deflated, 0, max_size);
 	uint32_t deflated_cursor = 0;
 	uint32_t deflate_cursor_offset = 0;
@@ -1,6 +1,7 @@
 #define ANR_DATA_DEBUG
 //#define ANR_DATA_FULL_TEST_REPORT
 #define ANR_DATA_IMPLEMENTATION
+#define ANR_DATA_MMAP
 #include "../anr_data.h"
 
 #include <time.h>
@@ -8,12 +9,32 @@
 #define TEST_LOOP 1
 #if 1
 #define HASH_LENGTH 50000
+#define SCALE_COUNT 10000000
+#define SORTED_COUNT 1000000
 #define ADD_REMOVE_COUNT 200000
+#define LOOKUP_COUNT 10000
 #else
 #define HASH_LENGTH 2000
+#define SCALE_COUNT 1000000
+#define SORTED_COUNT 100000
 #define ADD_REMOVE_COUNT 50000
+#define LOOKUP_COUNT 2000
 #endif
 
+ANR_DS_DECLARE(int, intarr)
+ANR_DS_SMALL_ARRAY(int, 8, smallints)
+
+// Counts blocks handed out by alloc and calls to free, a realloc only resizes a block and is not counted.
+typedef struct
+{
+	uint32_t allocs;
+	uint32_t frees;
+} alloc_counter;
+
+static void* counting_alloc(void* ctx, size_t size) { ((alloc_counter*)ctx)->allocs++; return malloc(size); }
+static void* uncounted_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) { (void)ctx; (void)old_size; return realloc(ptr, new_size); }
+static void counting_free(void* ctx, void* ptr) { ((alloc_counter*)ctx)->frees++; free(ptr); }
+
 int intptr;
 static int* rand_int()
 {
@@ -22,6 +43,13 @@ static int* rand_int()
 	return &intptr;
 }
 
+// Hashmap insert replaces the data at an occupied index instead of moving it up.
+static uint32_t expected_insert_length(anr_ds* ds, uint32_t index)
+{
+	uint8_t replaces = ds->ds_ll.ds_type == ANR_DS_HASHMAP && ANR_DS_FIND_AT(ds, index);
+	return ANR_DS_LENGTH(ds) + !replaces;
+}
+
 void test_ds(anr_ds* list)
 {
 	int d = *rand_int();
@@ -64,18 +92,20 @@ void test_ds(anr_ds* list)
 	assert(ANR_DS_LENGTH(list) == 4);
 
 	d = *rand_int();
+	uint32_t expected_length = expected_insert_length(list, 0);
 	assert(ANR_DS_INSERT(list, 0, &d) == 1);
 	//assert(ANR_DS_INSERT(list, 99, &d) == 0);
 
-	assert(ANR_DS_LENGTH(list) == 5);
+	assert(ANR_DS_LENGTH(list) == expected_length);
 	//assert(*(int*)ANR_DS_FIND_AT(list, 0) == d);
 
 	d = *rand_int();
+	expected_length = expected_insert_length(list, 3);
 	assert(ANR_DS_INSERT(list, 3, &d) == 1);
 
 	//ANR_DS_PRINT(list);
 
-	assert(ANR_DS_LENGTH(list) == 6);
+	assert(ANR_DS_LENGTH(list) == expected_length);
 	//assert(*(int*)ANR_DS_FIND_AT(list, 3) == d);
 
 	ANR_ITERATE(iter, list)
@@ -89,10 +119,13 @@ void test_ds(anr_ds* list)
 	int data8 = *rand_int();
 	int data9 = *rand_int();
 	ANR_DS_ADD(list, rand_int());
+	expected_length = expected_insert_length(list, 7);
 	ANR_DS_INSERT(list, 7, &data7);
+	expected_length += expected_insert_length(list, 8) - ANR_DS_LENGTH(list);
 	ANR_DS_INSERT(list, 8, &data8);
+	expected_length += expected_insert_length(list, 9) - ANR_DS_LENGTH(list);
 	ANR_DS_INSERT(list, 9, &data9);
-	assert(ANR_DS_LENGTH(list) == 10);
+	assert(ANR_DS_LENGTH(list) == expected_length);
 	int* found = (int*)ANR_DS_FIND_AT(list, 8);
 	if (found) {
 		ANR_DS_REMOVE_BY(list, ANR_DS_FIND_AT(list, 8));
@@ -110,6 +143,925 @@ void test_ds(anr_ds* list)
 }
 
 
+void test_array_policy()
+{
+	anr_array array = ANR_DS_ARRAY(sizeof(int), 1);
+	for (int i = 0; i < 1000; i++) ANR_DS_ADD(&array, &i);
+	assert(array.reserved >= 1000 && array.reserved < 2000);
+
+	// Adding and removing around the shrink boundary should not realloc.
+	int32_t reserved = array.reserved;
+	for (int i = 0; i < 100; i++)
+	{
+		ANR_DS_REMOVE_AT(&array, ANR_DS_LENGTH(&array)-1);
+		ANR_DS_ADD(&array, &i);
+	}
+	assert(array.reserved == reserved);
+
+	assert(anr_array_reserve(&array, 5000) && array.reserved == 5000);
+	anr_array_shrink_to_fit(&array);
+	assert(array.reserved == 1000);
+	for (int i = 0; i < 999; i++) assert(*(int*)ANR_DS_FIND_AT(&array, i) == i);
+	assert(*(int*)ANR_DS_FIND_AT(&array, 999) == 99);
+	ANR_DS_FREE(&array);
+}
+
+// Random inserts and removes checked against an array holding the same entries.
+void model_test(anr_ds* ds)
+{
+	anr_ds* list = ds;
+	anr_array model = ANR_DS_ARRAY(sizeof(int), 1);
+	for (int i = 0; i < 20000; i++)
+	{
+		uint32_t length = ANR_DS_LENGTH(&model);
+		uint32_t index = rand() % (length+1);
+		if (rand() % 3 || length == 0) {
+			assert(ANR_DS_INSERT(list, index, &i) == 1);
+			ANR_DS_INSERT(&model, index, &i);
+		}
+		else {
+			index = index % length;
+			if (i % 2) assert(ANR_DS_REMOVE_AT(list, index) == 1);
+			else assert(ANR_DS_REMOVE_BY(list, ANR_DS_FIND_AT(list, index)) == 1);
+			ANR_DS_REMOVE_AT(&model, index);
+		}
+		assert(ANR_DS_LENGTH(list) == ANR_DS_LENGTH(&model));
+		if (length && i % 16 == 0) {
+			index = rand() % length;
+			if (index < ANR_DS_LENGTH(&model)) assert(*(int*)ANR_DS_FIND_AT(list, index) == *(int*)ANR_DS_FIND_AT(&model, index));
+		}
+	}
+
+	uint32_t count = 0;
+	ANR_ITERATE(iter, list)
+	{
+		assert(*(int*)iter.data == *(int*)ANR_DS_FIND_AT(&model, iter.index));
+		count++;
+	}
+	assert(count == ANR_DS_LENGTH(&model));
+	ANR_DS_FREE(list);
+	ANR_DS_FREE(&model);
+}
+
+void test_typed()
+{
+	anr_array arr = intarr_create(1);
+	for (int i = 0; i < 1000; i++) assert(intarr_add(&arr, i*2) == i);
+	assert(intarr_length(&arr) == 1000);
+	assert(*intarr_at(&arr, 10) == 20);
+	assert(intarr_at(&arr, 1000) == NULL);
+	assert(intarr_find(&arr, 40) == 20);
+	assert(intarr_find(&arr, 41) == -1);
+	assert(intarr_insert(&arr, 0, -1) && intarr_data(&arr)[0] == -1);
+	assert(intarr_remove_at(&arr, 0) && intarr_data(&arr)[0] == 0);
+
+	// Still a regular array for the generic macros.
+	assert(ANR_DS_LENGTH(&arr) == 1000);
+	assert(*(int*)ANR_DS_FIND_AT((anr_ds*)&arr, 1) == 2);
+
+	int sum = 0;
+	ANR_DS_FOREACH(int, it, &arr) sum += *it;
+	assert(sum == 999*1000);
+	intarr_free(&arr);
+}
+
+// The first entries stay inside the struct, longer arrays spill to the heap and come back when they shrink.
+void test_small_array()
+{
+	smallints small;
+	smallints_init(&small);
+	for (int i = 0; i < 8; i++) assert(intarr_add(&small.arr, i) == i);
+	assert(small.arr.data == small.storage);
+
+	// Spills to the heap, and moves back once it shrinks to fit.
+	for (int i = 8; i < 100; i++) ANR_DS_ADD(&small.arr, &i);
+	assert(small.arr.data != small.storage);
+	int expected = 0;
+	ANR_ITERATE(iter, &small.arr) { assert(*(int*)iter.data == expected++); }
+	while (ANR_DS_LENGTH(&small.arr) > 2) ANR_DS_REMOVE_AT((anr_ds*)&small, 2);
+	assert(small.arr.data == small.storage && small.arr.reserved == 8);
+	assert(ANR_DS_LENGTH(&small.arr) == 2 && *intarr_at(&small.arr, 1) == 1);
+	ANR_DS_FREE(&small.arr);
+
+	smallints generic;
+	smallints_init(&generic);
+	test_ds((anr_ds*)&generic);
+
+	// Parent allocator is only used after the array spills.
+	alloc_counter counter = {0};
+	anr_allocator counting = {counting_alloc, uncounted_realloc, counting_free, &counter};
+	int storage[4];
+	anr_small_storage small_storage;
+	anr_array arr;
+	anr_array_init_small(&arr, &small_storage, sizeof(int), storage, 4, &counting);
+	for (int i = 0; i < 4; i++) ANR_DS_ADD(&arr, &i);
+	assert(counter.allocs == 0);
+	ANR_DS_ADD(&arr, &expected);
+	assert(counter.allocs == 1);
+	ANR_DS_FREE(&arr);
+	assert(counter.frees == 1);
+}
+
+// find_by on every element size with a vector kernel plus odd ones, checked against memcmp.
+void test_find_by()
+{
+	uint32_t sizes[] = {1, 2, 3, 4, 8, 12, 16};
+	for (uint32_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++)
+	{
+		uint32_t size = sizes[s];
+		anr_array array = ANR_DS_ARRAY(size, 1);
+		anr_hashmap hashmap = ANR_DS_HASHMAP(size, 100);
+		uint8_t entry[16];
+		for (uint32_t i = 0; i < 300; i++)
+		{
+			for (uint32_t x = 0; x < size; x++) entry[x] = (uint8_t)(rand() % 4);
+			ANR_DS_ADD(&array, entry);
+			ANR_DS_ADD(&hashmap, entry);
+		}
+		for (uint32_t i = 0; i < 300; i += 7) ANR_DS_REMOVE_AT(&hashmap, i);
+
+		for (uint32_t i = 0; i < 200; i++)
+		{
+			for (uint32_t x = 0; x < size; x++) entry[x] = (uint8_t)(rand() % 4);
+			int32_t expected = -1;
+			for (int32_t x = 0; x < array.length && expected == -1; x++) {
+				if (memcmp(ANR_DS_FIND_AT(&array, x), entry, size) == 0) expected = x;
+			}
+			assert((int32_t)ANR_DS_FIND_BY(&array, entry) == expected);
+
+			expected = -1;
+			for (int32_t x = 0; x < 300 && expected == -1; x++) {
+				void* data = ANR_DS_FIND_AT(&hashmap, x);
+				if (data && memcmp(data, entry, size) == 0) expected = x;
+			}
+			assert((int32_t)ANR_DS_FIND_BY(&hashmap, entry) == expected);
+		}
+		ANR_DS_FREE(&array);
+		ANR_DS_FREE(&hashmap);
+	}
+}
+
+static int compare_int(const void* a, const void* b)
+{
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+void test_sorted_array()
+{
+	for (uint8_t eytzinger = 0; eytzinger < 2; eytzinger++)
+	{
+		anr_sorted_array sarr = anr_sorted_array_create_ex(sizeof(int), 1, compare_int, eytzinger, NULL);
+		for (int i = 0; i < 2000; i++)
+		{
+			int value = (rand() % 1000) * 2;
+			ANR_DS_ADD(&sarr, &value);
+		}
+
+		int batch[500];
+		for (int i = 0; i < 500; i++) batch[i] = i*4 + 1;
+		assert(anr_sorted_array_merge_sorted(&sarr, batch, 500));
+		assert(ANR_DS_LENGTH(&sarr) == 2500);
+
+		int prev = INT32_MIN;
+		ANR_ITERATE(iter, &sarr)
+		{
+			assert(*(int*)iter.data >= prev);
+			prev = *(int*)iter.data;
+		}
+
+		for (int key = -1; key < 2002; key++)
+		{
+			int32_t expected = -1;
+			for (int32_t i = 0; i < sarr.items.length && expected == -1; i++) {
+				if (*(int*)ANR_DS_FIND_AT(&sarr, i) == key) expected = i;
+			}
+			assert((int32_t)ANR_DS_FIND_BY(&sarr, &key) == expected);
+		}
+		assert(!eytzinger || !sarr.eytzinger.dirty); // The lookups paid for a rebuild.
+
+		// Interleaved adds and lookups stay with binary search.
+		for (int i = 0; i < 100; i++)
+		{
+			int value = 5000 + i;
+			ANR_DS_ADD(&sarr, &value);
+			assert(*(int*)ANR_DS_FIND_AT(&sarr, ANR_DS_FIND_BY(&sarr, &value)) == value);
+			assert(!eytzinger || sarr.eytzinger.dirty);
+		}
+
+		// Changes invalidate the eytzinger copy.
+		int key = 1;
+		assert(ANR_DS_REMOVE_AT(&sarr, ANR_DS_FIND_BY(&sarr, &key)));
+		assert((int32_t)ANR_DS_FIND_BY(&sarr, &key) == -1);
+		ANR_DS_ADD(&sarr, &key);
+		assert(*(int*)ANR_DS_FIND_AT(&sarr, ANR_DS_FIND_BY(&sarr, &key)) == 1);
+		ANR_DS_FREE(&sarr);
+	}
+}
+
+typedef struct
+{
+	int32_t key;
+	uint32_t id; // Insert order, checks that equal keys keep it.
+	float weight;
+	uint32_t pad;
+} record;
+
+static int compare_record(const void* a, const void* b)
+{
+	const record* x = a;
+	const record* y = b;
+	if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+	return (x->id > y->id) - (x->id < y->id);
+}
+
+void test_sort()
+{
+	anr_array arr = ANR_DS_ARRAY(sizeof(record), 1);
+	for (uint32_t i = 0; i < 5000; i++)
+	{
+		record r = {(rand() % 2001) - 1000, i, (float)((rand() % 2001) - 1000) / 8.0f, 0};
+		ANR_DS_ADD(&arr, &r);
+	}
+
+	assert(anr_array_sort_by_key(&arr, offsetof(record, key), ANR_KEY_I32));
+	for (uint32_t i = 1; i < 5000; i++) assert(compare_record(ANR_DS_FIND_AT(&arr, i-1), ANR_DS_FIND_AT(&arr, i)) < 0);
+
+	assert(anr_array_sort_by_key(&arr, offsetof(record, weight), ANR_KEY_F32));
+	for (uint32_t i = 1; i < 5000; i++) assert(((record*)ANR_DS_FIND_AT(&arr, i-1))->weight <= ((record*)ANR_DS_FIND_AT(&arr, i))->weight);
+
+	// Entries with the same weight are still ordered by key from the previous sort.
+	for (uint32_t i = 1; i < 5000; i++)
+	{
+		record* prev = ANR_DS_FIND_AT(&arr, i-1);
+		record* cur = ANR_DS_FIND_AT(&arr, i);
+		if (prev->weight == cur->weight) assert(compare_record(prev, cur) < 0);
+	}
+
+	anr_array_sort(&arr, compare_record);
+	for (uint32_t i = 1; i < 5000; i++) assert(compare_record(ANR_DS_FIND_AT(&arr, i-1), ANR_DS_FIND_AT(&arr, i)) < 0);
+	ANR_DS_FREE(&arr);
+
+	// 64 bit keys, including ones that only differ in the high bytes.
+	anr_array keys = ANR_DS_ARRAY(sizeof(int64_t), 1);
+	for (int64_t i = 0; i < 1000; i++)
+	{
+		int64_t key = (i % 2 ? -i : i) * ((int64_t)1 << 40) + (i % 7);
+		ANR_DS_ADD(&keys, &key);
+	}
+	assert(anr_array_sort_by_key(&keys, 0, ANR_KEY_I64));
+	for (uint32_t i = 1; i < 1000; i++) assert(*(int64_t*)ANR_DS_FIND_AT(&keys, i-1) < *(int64_t*)ANR_DS_FIND_AT(&keys, i));
+	ANR_DS_FREE(&keys);
+}
+
+// A file backed array is a regular anr_array, the file keeps the entries up to the last sync.
+void test_file_array()
+{
+	const char* path = "bin/test_file_array.anr";
+	remove(path);
+	anr_array arr = anr_array_create_file(path, sizeof(int), 16, ANR_ACCESS_SEQUENTIAL);
+	assert(arr.data);
+	test_ds((anr_ds*)&arr); // Frees the array.
+
+	arr = anr_array_create_file(path, sizeof(int), 16, ANR_ACCESS_SEQUENTIAL);
+	assert(arr.data);
+	for (int i = 0; i < 100000; i++) ANR_DS_ADD(&arr, &i);
+	int value = -1;
+	ANR_DS_INSERT(&arr, 0, &value);
+	ANR_DS_REMOVE_AT(&arr, 0);
+	int expected = 0;
+	ANR_ITERATE(iter, &arr) { assert(*(int*)iter.data == expected++); }
+	assert(anr_array_sync(&arr));
+	for (int i = 0; i < 10; i++) ANR_DS_ADD(&arr, &i); // Not synced.
+	ANR_DS_FREE(&arr);
+
+	arr = anr_array_create_file(path, sizeof(int), 1, ANR_ACCESS_RANDOM);
+	assert(arr.data && ANR_DS_LENGTH(&arr) == 100000);
+	assert(*(int*)ANR_DS_FIND_AT(&arr, 99999) == 99999);
+	anr_array_advise(&arr, ANR_ACCESS_NORMAL);
+	assert(ANR_DS_REMOVE_RANGE(&arr, 1000, 99000));
+	assert(anr_array_sync(&arr));
+	ANR_DS_FREE(&arr);
+
+	// Sorts take their scratch from the heap and leave the mapping alone.
+	arr = anr_array_create_file(path, sizeof(int), 1, ANR_ACCESS_NORMAL);
+	assert(arr.data && ANR_DS_LENGTH(&arr) == 1000);
+	for (int i = 0; i < 1000; i++) *(int*)ANR_DS_FIND_AT(&arr, i) = (i * 7919) % 1000;
+	assert(anr_array_sort_by_key(&arr, 0, ANR_KEY_I32));
+	for (int i = 0; i < 1000; i++) assert(*(int*)ANR_DS_FIND_AT(&arr, i) == i);
+	for (int i = 0; i < 1000; i++) *(int*)ANR_DS_FIND_AT(&arr, i) = 999 - i;
+	anr_array_sort(&arr, compare_int);
+	for (int i = 0; i < 1000; i++) assert(*(int*)ANR_DS_FIND_AT(&arr, i) == i);
+	assert(ANR_DS_ADD(&arr, &value) == 1000);
+	assert(anr_array_sync(&arr));
+	ANR_DS_FREE(&arr);
+
+	arr = anr_array_create_file(path, sizeof(int), 1, ANR_ACCESS_NORMAL);
+	assert(arr.data && ANR_DS_LENGTH(&arr) == 1001);
+	assert(*(int*)ANR_DS_FIND_AT(&arr, 999) == 999 && *(int*)ANR_DS_FIND_AT(&arr, 1000) == -1);
+	ANR_DS_FREE(&arr);
+
+	// Entries of another size.
+	arr = anr_array_create_file(path, sizeof(double), 1, ANR_ACCESS_NORMAL);
+	assert(!arr.data);
+	remove(path);
+}
+
+// Mapped containers work like the saved ones, changes stay in memory and never reach the file.
+void test_snapshot()
+{
+	const char* path = "bin/test_snapshot.anr";
+	anr_array arr = ANR_DS_ARRAY(sizeof(int), 1);
+	for (int i = 0; i < 1000; i++) ANR_DS_ADD(&arr, &i);
+	assert(anr_ds_save(&arr, path));
+
+	for (int round = 0; round < 2; round++)
+	{
+		anr_mapped* mapped = anr_ds_open_mapped(path);
+		assert(mapped);
+		assert(ANR_DS_LENGTH(&mapped->ds.array) == 1000);
+		for (int i = 0; i < 1000; i++) assert(*(int*)ANR_DS_FIND_AT(&mapped->ds.array, i) == i);
+		int value = -1;
+		ANR_DS_INSERT(&mapped->ds.array, 0, &value);
+		ANR_DS_ADD(&mapped->ds.array, &value);
+		assert(ANR_DS_LENGTH(&mapped->ds.array) == 1002);
+		assert(*(int*)ANR_DS_FIND_AT(&mapped->ds.array, 1) == 0);
+		anr_ds_close_mapped(mapped);
+	}
+	ANR_DS_FREE(&arr);
+
+	// Hashmap with holes, released buckets and indices far apart.
+	anr_hashmap hashmap = ANR_DS_HASHMAP(sizeof(int), 64);
+	for (int i = 0; i < 5000; i++) ANR_DS_ADD(&hashmap, &i);
+	for (int i = 0; i < 5000; i += 3) ANR_DS_REMOVE_AT(&hashmap, i);
+	for (int i = 64; i < 128; i++) ANR_DS_REMOVE_AT(&hashmap, i);
+	int far = 7;
+	ANR_DS_INSERT(&hashmap, 1000000, &far);
+	assert(anr_ds_save(&hashmap, path));
+
+	anr_mapped* mapped = anr_ds_open_mapped(path);
+	assert(mapped);
+	assert(ANR_DS_LENGTH((anr_ds*)mapped) == ANR_DS_LENGTH(&hashmap));
+	for (int i = 0; i < 5000; i++)
+	{
+		int* saved = ANR_DS_FIND_AT(&hashmap, i);
+		int* loaded = ANR_DS_FIND_AT(&mapped->ds.hashmap, i);
+		assert(saved ? loaded && *loaded == *saved : !loaded);
+	}
+	assert(*(int*)ANR_DS_FIND_AT(&mapped->ds.hashmap, 1000000) == 7);
+
+	// Adds fill the same free slots as in the saved hashmap.
+	for (int i = 0; i < 3000; i++) assert(ANR_DS_ADD(&mapped->ds.hashmap, &i) == ANR_DS_ADD(&hashmap, &i));
+	assert(ANR_DS_REMOVE_AT(&mapped->ds.hashmap, 1000000));
+	assert(ANR_DS_LENGTH(&mapped->ds.hashmap) == ANR_DS_LENGTH(&hashmap) - 1);
+	anr_ds_close_mapped(mapped);
+
+	mapped = anr_ds_open_mapped(path);
+	assert(*(int*)ANR_DS_FIND_AT(&mapped->ds.hashmap, 1000000) == 7);
+	anr_ds_close_mapped(mapped);
+	ANR_DS_FREE(&hashmap);
+
+	// Damaged headers and bucket records are rejected before the file is trusted.
+	FILE* file = fopen(path, "rb");
+	fseek(file, 0, SEEK_END);
+	long file_size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* saved = malloc(file_size);
+	uint8_t* damaged = malloc(file_size);
+	assert(fread(saved, 1, file_size, file) == (size_t)file_size);
+	fclose(file);
+	anr__snapshot_header* header = (anr__snapshot_header*)damaged;
+	for (int test = 0; test < 6; test++)
+	{
+		memcpy(damaged, saved, file_size);
+		anr__snapshot_bucket* records = (anr__snapshot_bucket*)(damaged + header->table_offset);
+		switch (test)
+		{
+			case 1: records[1].bucket_start = records[0].bucket_start; break;
+			case 2: records[0].open_position = header->open_count + 1; break;
+			case 3: records[0].length++; break;
+			case 4: header->bucket_size = header->data_size = 0x10000; break;
+			case 5: header->open_count = header->bucket_count + 1; break;
+		}
+		file = fopen(path, "wb");
+		fwrite(damaged, 1, file_size, file);
+		fclose(file);
+		mapped = anr_ds_open_mapped(path);
+		assert(test == 0 ? mapped != NULL : mapped == NULL);
+		if (mapped) anr_ds_close_mapped(mapped);
+	}
+	free(saved);
+	free(damaged);
+
+	// Not a snapshot.
+	file = fopen(path, "wb");
+	fputs("not a snapshot, just some text", file);
+	fclose(file);
+	assert(anr_ds_open_mapped(path) == NULL);
+	remove(path);
+	assert(anr_ds_open_mapped(path) == NULL);
+}
+
+// Bounded: push fails when full and works again after a pop. Threaded use is in test_threads.c.
+void test_mpmc_queue()
+{
+	anr_mpmc_queue queue = ANR_DS_MPMC_QUEUE(sizeof(int), 100);
+	assert(queue.capacity == 128);
+	for (int round = 0; round < 3; round++)
+	{
+		for (int i = 0; i < 128; i++) assert(anr_mpmc_queue_try_push(&queue, &i));
+		int value = -1;
+		assert(!anr_mpmc_queue_try_push(&queue, &value));
+		assert(ANR_DS_ADD(&queue, &value) == -1);
+		assert(ANR_DS_LENGTH(&queue) == 128);
+
+		for (int i = 0; i < 100; i++) assert(anr_mpmc_queue_try_pop(&queue, &value) && value == i);
+		for (int i = 0; i < 100; i++) assert(ANR_DS_ADD(&queue, &i) == 28 + i);
+		for (int i = 0; i < 128; i++) assert(anr_mpmc_queue_try_pop(&queue, &value) && value == (i < 28 ? 100 + i : i - 28));
+		assert(!anr_mpmc_queue_try_pop(&queue, &value));
+	}
+	ANR_DS_FREE(&queue);
+}
+
+static int is_multiple(const void* data, void* ctx)
+{
+	return *(const int*)data % *(int*)ctx == 0;
+}
+
+// Bulk operations checked against the same edits made one entry at a time on an array.
+void range_test(anr_ds* ds)
+{
+	anr_array model = ANR_DS_ARRAY(sizeof(int), 1);
+	int batch[64];
+	for (int i = 0; i < 2000; i++)
+	{
+		uint32_t length = ANR_DS_LENGTH(&model);
+		uint32_t count = rand() % 64;
+		uint32_t index = rand() % (length+1);
+		for (uint32_t x = 0; x < count; x++) batch[x] = i*64 + x;
+
+		switch (rand() % 4)
+		{
+			case 0:
+				assert(ANR_DS_ADD_RANGE(ds, batch, count));
+				for (uint32_t x = 0; x < count; x++) ANR_DS_ADD(&model, &batch[x]);
+				break;
+			case 1:
+				assert(ANR_DS_INSERT_RANGE(ds, index, batch, count));
+				for (uint32_t x = 0; x < count; x++) ANR_DS_INSERT(&model, index+x, &batch[x]);
+				break;
+			case 2:
+				if (count > length - index) count = length - index;
+				assert(ANR_DS_REMOVE_RANGE(ds, index, count));
+				for (uint32_t x = 0; x < count; x++) ANR_DS_REMOVE_AT(&model, index);
+				break;
+			case 3:
+				if (i % 8) break;
+				int divisor = 3 + rand() % 5;
+				uint32_t removed = ANR_DS_REMOVE_IF(ds, is_multiple, &divisor);
+				assert(removed == ANR_DS_REMOVE_IF(&model, is_multiple, &divisor));
+				break;
+		}
+		assert(ANR_DS_LENGTH(ds) == ANR_DS_LENGTH(&model));
+	}
+	assert(!ANR_DS_REMOVE_RANGE(ds, ANR_DS_LENGTH(ds), 1));
+	assert(!ANR_DS_INSERT_RANGE(ds, ANR_DS_LENGTH(ds)+1, batch, 1));
+
+	uint32_t count = 0;
+	ANR_ITERATE(iter, ds)
+	{
+		assert(*(int*)iter.data == *(int*)ANR_DS_FIND_AT(&model, count));
+		count++;
+	}
+	assert(count == ANR_DS_LENGTH(&model));
+	ANR_DS_FREE(ds);
+	ANR_DS_FREE(&model);
+}
+
+// Released bucket numbers are listed once and leave the free list when a bucket is created again.
+void test_hashmap_free_buckets()
+{
+	anr_hashmap hashmap = ANR_DS_HASHMAP(sizeof(int), 100);
+	int value = 1;
+	for (int i = 0; i < 100000; i++)
+	{
+		assert(anr_hashmap_insert(&hashmap, 1000, &value));
+		assert(anr_hashmap_remove_at(&hashmap, 1000));
+	}
+	assert(hashmap.free_buckets.length == 1 && hashmap.buckets.length == 0);
+
+	int batch[300] = {0};
+	int divisor = 1;
+	for (int i = 0; i < 10000; i++)
+	{
+		uint32_t index = (rand() % 50) * 100;
+		switch (rand() % 4)
+		{
+			case 0: assert(ANR_DS_INSERT_RANGE(&hashmap, index, batch, 1 + rand() % 300)); break;
+			case 1: assert(ANR_DS_REMOVE_RANGE(&hashmap, index, 1 + rand() % 300)); break;
+			case 2: assert(ANR_DS_ADD_RANGE(&hashmap, batch, 1 + rand() % 300)); break;
+			case 3: ANR_DS_REMOVE_IF(&hashmap, is_multiple, &divisor); break;
+		}
+		assert(hashmap.buckets.length + hashmap.free_buckets.length <= hashmap.next_bucket);
+		assert(hashmap.open_buckets.reserved >= hashmap.buckets.length); // Reopening a full bucket never allocates.
+	}
+	for (uint32_t i = 0; i < hashmap.free_buckets.length; i++)
+	{
+		uint32_t bucket_nr = *(uint32_t*)anr_array_find_at(&hashmap.free_buckets, i);
+		assert(ANR_DS_FIND_AT(&hashmap, bucket_nr * 100) == NULL);
+	}
+	ANR_DS_FREE(&hashmap);
+}
+
+// Index based bulk operations on the hashmap, checked slot by slot.
+void test_hashmap_range()
+{
+	anr_hashmap hashmap = ANR_DS_HASHMAP(sizeof(int), 100);
+	int batch[1000];
+	for (int i = 0; i < 1000; i++) batch[i] = i;
+
+	assert(ANR_DS_INSERT_RANGE(&hashmap, 50, batch, 1000));
+	assert(ANR_DS_LENGTH(&hashmap) == 1000);
+	for (int i = 0; i < 1000; i++) assert(*(int*)ANR_DS_FIND_AT(&hashmap, 50+i) == i);
+	assert(ANR_DS_FIND_AT(&hashmap, 49) == NULL && ANR_DS_FIND_AT(&hashmap, 1050) == NULL);
+
+	assert(ANR_DS_REMOVE_RANGE(&hashmap, 0, 300)); // 0-49 dont exist.
+	assert(ANR_DS_LENGTH(&hashmap) == 750);
+	assert(ANR_DS_FIND_AT(&hashmap, 299) == NULL && *(int*)ANR_DS_FIND_AT(&hashmap, 300) == 250);
+
+	// Fills the freed slots again before making new buckets.
+	assert(ANR_DS_ADD_RANGE(&hashmap, batch, 300));
+	assert(ANR_DS_LENGTH(&hashmap) == 1050);
+	int sum = 0;
+	ANR_ITERATE(iter, &hashmap) sum += *(int*)iter.data;
+	assert(sum == 999*1000/2 - 249*250/2 + 299*300/2);
+
+	int divisor = 2;
+	assert(ANR_DS_REMOVE_IF(&hashmap, is_multiple, &divisor) == 525);
+	ANR_ITERATE(odd_iter, &hashmap) assert(*(int*)odd_iter.data % 2);
+	ANR_DS_FREE(&hashmap);
+
+	anr_hashtable hashtable = ANR_DS_HASHTABLE(sizeof(int), sizeof(int), NULL);
+	assert(ANR_DS_ADD_RANGE(&hashtable, batch, 1000));
+	assert(ANR_DS_REMOVE_IF(&hashtable, is_multiple, &divisor) == 500);
+	assert(ANR_DS_LENGTH(&hashtable) == 500);
+	ANR_DS_FREE(&hashtable);
+
+	anr_sorted_array sarr = ANR_DS_SORTED_ARRAY(sizeof(int), compare_int);
+	for (int i = 0; i < 1000; i++) batch[i] = (i * 7919) % 1000;
+	assert(ANR_DS_ADD_RANGE(&sarr, batch, 1000));
+	for (int i = 0; i < 1000; i++) assert(*(int*)ANR_DS_FIND_AT(&sarr, i) == i);
+	ANR_DS_FREE(&sarr);
+}
+
+typedef struct
+{
+	int key;
+	int value;
+} kv;
+
+void test_bloom()
+{
+	for (uint8_t counting = 0; counting < 2; counting++)
+	{
+		anr_bloom_filter filter = anr_bloom_create(10000, 0.01, sizeof(int), counting, NULL);
+		for (int i = 0; i < 20000; i += 2) anr_bloom_add(&filter, &i);
+		for (int i = 0; i < 20000; i += 2) assert(anr_bloom_contains(&filter, &i));
+
+		uint32_t false_positives = 0;
+		for (int i = 1; i < 200000; i += 2) false_positives += anr_bloom_contains(&filter, &i);
+		assert(false_positives < 100000 * 0.02);
+
+		if (counting)
+		{
+			for (int i = 0; i < 10000; i += 2) assert(anr_bloom_remove(&filter, &i));
+			for (int i = 10000; i < 20000; i += 2) assert(anr_bloom_contains(&filter, &i));
+			uint32_t left = 0;
+			for (int i = 0; i < 10000; i += 2) left += anr_bloom_contains(&filter, &i);
+			assert(left < 5000 * 0.05);
+		}
+		anr_bloom_free(&filter);
+	}
+
+	// The filtered wrapper passes the same tests as the containers it wraps.
+	anr_array inner = ANR_DS_ARRAY(sizeof(int), 1);
+	anr_filtered filtered = anr_filtered_create(&inner, sizeof(int), 1000, 0.01, 1);
+	test_ds((anr_ds*)&filtered);
+	anr_linked_list inner_list = ANR_DS_LINKED_LIST(sizeof(int));
+	filtered = anr_filtered_create(&inner_list, sizeof(int), 1000, 0.01, 1);
+	range_test((anr_ds*)&filtered);
+
+	// Entries already in the container are added to the filter, without counting removed keys stay until a rebuild.
+	inner = ANR_DS_ARRAY(sizeof(int), 1);
+	for (int i = 0; i < 100; i++) ANR_DS_ADD(&inner, &i);
+	filtered = ANR_DS_FILTERED(&inner, sizeof(int), 100, 0.001);
+	for (int i = 0; i < 100; i++) assert(ANR_DS_FIND_BY(&filtered, &i) == i);
+	for (int i = 0; i < 50; i++) ANR_DS_REMOVE_AT(&filtered, 0);
+	int key = 10;
+	assert(anr_bloom_contains(&filtered.filter, &key));
+	assert(ANR_DS_FIND_BY(&filtered, &key) == -1);
+	anr_filtered_rebuild(&filtered);
+	assert(!anr_bloom_contains(&filtered.filter, &key));
+	ANR_DS_FREE(&filtered);
+}
+
+void test_slot_map()
+{
+	anr_slot_map map = ANR_DS_SLOT_MAP(sizeof(int));
+	test_ds((anr_ds*)&map);
+
+	// Handles of removed entries never resolve, not even after their slot is reused.
+	map = anr_slot_map_create(sizeof(int), 4);
+	int value = 1;
+	anr_handle first = anr_slot_map_put(&map, &value);
+	assert(first != 0 && *(int*)anr_slot_map_get(&map, first) == 1);
+	assert(anr_slot_map_erase(&map, first));
+	assert(anr_slot_map_get(&map, first) == NULL);
+	assert(!anr_slot_map_erase(&map, first));
+	value = 2;
+	anr_handle second = anr_slot_map_put(&map, &value);
+	assert((uint32_t)second == (uint32_t)first && second != first);
+	assert(anr_slot_map_get(&map, first) == NULL && *(int*)anr_slot_map_get(&map, second) == 2);
+	assert(anr_slot_map_get(&map, 0) == NULL && anr_slot_map_get(&map, 1000) == NULL);
+	ANR_DS_FREE(&map);
+
+	// Random puts and erases against a list of live handles, every value is its own key.
+	map = ANR_DS_SLOT_MAP(sizeof(int));
+	anr_array live = ANR_DS_ARRAY(sizeof(anr_handle), 1);
+	anr_array dead = ANR_DS_ARRAY(sizeof(anr_handle), 1);
+	for (int i = 0; i < 20000; i++)
+	{
+		uint32_t length = ANR_DS_LENGTH(&live);
+		if (length && rand() % 3 == 0)
+		{
+			uint32_t at = rand() % length;
+			anr_handle handle = *(anr_handle*)ANR_DS_FIND_AT(&live, at);
+			assert(anr_slot_map_erase(&map, handle));
+			ANR_DS_REMOVE_AT(&live, at);
+			ANR_DS_ADD(&dead, &handle);
+		}
+		else
+		{
+			anr_handle handle = anr_slot_map_put(&map, &i);
+			assert(handle != 0);
+			ANR_DS_ADD(&live, &handle);
+		}
+		assert(ANR_DS_LENGTH(&map) == ANR_DS_LENGTH(&live));
+	}
+	ANR_ITERATE(live_iter, &live)
+	{
+		int* data = anr_slot_map_get(&map, *(anr_handle*)live_iter.data);
+		assert(data && anr_slot_map_handle_at(&map, ANR_DS_FIND_BY(&map, data)) == *(anr_handle*)live_iter.data);
+	}
+	ANR_ITERATE(dead_iter, &dead) assert(anr_slot_map_get(&map, *(anr_handle*)dead_iter.data) == NULL);
+
+	// Removing by index keeps the other handles valid.
+	int divisor = 3;
+	uint32_t removed = ANR_DS_REMOVE_IF(&map, is_multiple, &divisor);
+	uint32_t still_live = 0;
+	ANR_ITERATE(check_iter, &live)
+	{
+		int* data = anr_slot_map_get(&map, *(anr_handle*)check_iter.data);
+		if (data) { assert(*data % 3); still_live++; }
+	}
+	assert(still_live == ANR_DS_LENGTH(&map) && still_live + removed == ANR_DS_LENGTH(&live));
+	ANR_DS_FREE(&map);
+	ANR_DS_FREE(&live);
+	ANR_DS_FREE(&dead);
+}
+
+typedef struct
+{
+	int value;
+	anr_list_link all; // On every list.
+	anr_list_link odd; // Only while value is odd.
+} list_item;
+
+void test_intrusive_list()
+{
+	list_item items[100];
+	anr_list all = anr_list_create();
+	anr_list odd = anr_list_create();
+	for (int i = 0; i < 100; i++)
+	{
+		items[i].value = i;
+		anr_list_push_back(&all, &items[i].all);
+		if (i % 2) anr_list_push_front(&odd, &items[i].odd);
+	}
+	assert(anr_list_length(&all) == 100 && anr_list_length(&odd) == 50);
+
+	int expected = 0;
+	ANR_LIST_ITERATE(link, &all) assert(ANR_CONTAINER_OF(link, list_item, all)->value == expected++);
+	expected = 99;
+	ANR_LIST_ITERATE(link, &odd) { assert(ANR_CONTAINER_OF(link, list_item, odd)->value == expected); expected -= 2; }
+
+	// Unlinking from one list leaves the item on the other.
+	ANR_LIST_ITERATE(link, &all) if (ANR_CONTAINER_OF(link, list_item, all)->value % 3 == 0) anr_list_unlink(&all, link);
+	assert(anr_list_length(&all) == 66 && anr_list_length(&odd) == 50);
+	ANR_LIST_ITERATE(link, &all) assert(ANR_CONTAINER_OF(link, list_item, all)->value % 3);
+	assert(items[0].all.prev == NULL && items[0].all.next == NULL);
+
+	anr_list_insert_after(&all, &items[1].all, &items[0].all);
+	anr_list_insert_before(&all, &items[1].all, &items[3].all);
+	assert(all.first == &items[3].all && items[1].all.next == &items[0].all && items[0].all.next == &items[2].all);
+
+	// Splice the rest of the multiples of 3 into the middle, then empty the list from the front.
+	anr_list rest = anr_list_create();
+	for (int i = 6; i < 100; i += 3) anr_list_push_back(&rest, &items[i].all);
+	anr_list_splice(&all, &items[2].all, &rest);
+	assert(anr_list_length(&all) == 100 && anr_list_length(&rest) == 0 && rest.first == NULL);
+	assert(items[0].all.next == &items[6].all && items[99].all.next == &items[2].all);
+	anr_list_splice(&all, NULL, &rest);
+	assert(anr_list_length(&all) == 100);
+
+	uint32_t popped = 0;
+	anr_list_link* link;
+	while ((link = anr_list_pop_front(&all)) != NULL) popped++;
+	assert(popped == 100 && all.first == NULL && all.last == NULL);
+}
+
+void test_hashtable()
+{
+	anr_hashtable table = ANR_DS_HASHTABLE(sizeof(kv), sizeof(int), NULL);
+	for (int i = 0; i < 10000; i++)
+	{
+		kv entry = {i, i*2};
+		assert(ANR_DS_ADD(&table, &entry) != -1);
+	}
+	assert(ANR_DS_LENGTH(&table) == 10000);
+
+	kv entry = {5, 99};
+	ANR_DS_ADD(&table, &entry); // Replaces existing key.
+	assert(ANR_DS_LENGTH(&table) == 10000);
+
+	for (int i = 0; i < 10000; i++)
+	{
+		int32_t index = ANR_DS_FIND_BY(&table, &i);
+		assert(index != -1);
+		kv* found = ANR_DS_FIND_AT(&table, index);
+		assert(found->key == i && found->value == (i == 5 ? 99 : i*2));
+	}
+
+	for (int i = 0; i < 10000; i += 2) assert(ANR_DS_REMOVE_AT(&table, ANR_DS_FIND_BY(&table, &i)) == 1);
+	for (int i = 0; i < 10000; i++) assert((ANR_DS_FIND_BY(&table, &i) == -1) == (i % 2 == 0));
+	assert(ANR_DS_LENGTH(&table) == 5000);
+
+	int count = 0;
+	ANR_ITERATE(iter, &table)
+	{
+		assert(((kv*)iter.data)->key % 2 == 1);
+		count++;
+	}
+	assert(count == 5000);
+
+	ANR_DS_FREE(&table);
+}
+
+// Same checks as test_hashtable through the table, then the thread safe calls. Threaded use is in test_threads.c.
+void test_concurrent_hashtable()
+{
+	anr_concurrent_hashtable table = anr_concurrent_hashtable_create_ex(sizeof(kv), sizeof(int), NULL, 8, NULL);
+	for (int i = 0; i < 10000; i++)
+	{
+		kv entry = {i, i*2};
+		assert(ANR_DS_ADD((anr_ds*)&table, &entry) != -1);
+	}
+	assert(ANR_DS_LENGTH(&table) == 10000);
+
+	for (int i = 0; i < 10000; i++)
+	{
+		int32_t index = ANR_DS_FIND_BY((anr_ds*)&table, &i);
+		assert(index != -1);
+		kv* found = ANR_DS_FIND_AT(&table, index);
+		assert(found->key == i && found->value == i*2);
+	}
+
+	for (int i = 0; i < 10000; i += 2) assert(ANR_DS_REMOVE_AT(&table, ANR_DS_FIND_BY(&table, &i)) == 1);
+	int count = 0;
+	ANR_ITERATE(iter, &table)
+	{
+		assert(((kv*)iter.data)->key % 2 == 1);
+		assert(ANR_DS_FIND_AT(&table, iter.index) == iter.data);
+		count++;
+	}
+	assert(count == 5000 && ANR_DS_LENGTH(&table) == 5000);
+
+	kv entry = {7, 99};
+	assert(anr_concurrent_hashtable_put(&table, &entry));
+	for (int i = 0; i < 10000; i++)
+	{
+		kv found = {0};
+		assert(anr_concurrent_hashtable_get(&table, &i, &found) == (i % 2 == 1));
+		if (i % 2) assert(found.key == i && found.value == (i == 7 ? 99 : i*2));
+	}
+	int key = 7;
+	assert(anr_concurrent_hashtable_erase(&table, &key));
+	assert(!anr_concurrent_hashtable_erase(&table, &key));
+	assert(ANR_DS_LENGTH(&table) == 4999);
+
+	// Ranges cover the interleaved indices of every shard, past the last index they fail.
+	uint32_t end = 0;
+	int in_range = 0;
+	ANR_ITERATE(before, &table)
+	{
+		if ((uint32_t)before.index >= end) end = before.index + 1;
+		in_range += before.index >= 100 && before.index < 3000;
+	}
+	assert(!ANR_DS_REMOVE_RANGE(&table, end, UINT32_MAX - end));
+	assert(ANR_DS_REMOVE_RANGE(&table, 100, 2900));
+	assert(ANR_DS_LENGTH(&table) == 4999 - in_range);
+	ANR_ITERATE(after, &table) { assert(after.index < 100 || after.index >= 3000); }
+
+	anr_concurrent_hashtable_reclaim(&table);
+	ANR_DS_FREE(&table);
+}
+
+void lookup_test(anr_ds* ds)
+{
+	for (int i = 0; i < LOOKUP_COUNT; i++)
+	{
+		kv entry = {i, i};
+		ANR_DS_ADD(ds, &entry);
+	}
+	for (int i = 0; i < LOOKUP_COUNT; i++)
+	{
+		kv entry = {i, i};
+		assert(ANR_DS_FIND_BY(ds, &entry) != -1);
+	}
+	ANR_DS_FREE(ds);
+}
+
+void iterate_test(anr_ds* ds)
+{
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT; i++) ANR_DS_ADD(ds, &i);
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT; i += 3) ANR_DS_REMOVE_AT(ds, i);
+
+	uint32_t count = 0;
+	ANR_ITERATE(iter, ds)
+	{
+		assert(ANR_DS_FIND_AT(ds, iter.index) == iter.data);
+		count++;
+	}
+	assert(count == ANR_DS_LENGTH(ds));
+	ANR_DS_FREE(ds);
+}
+
+void refill_test(anr_ds* ds)
+{
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT; i++) ANR_DS_ADD(ds, &i);
+
+	uint32_t removed = 0;
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT; i++)
+	{
+		removed += ANR_DS_REMOVE_AT(ds, rand() % ADD_REMOVE_COUNT);
+	}
+	assert(ANR_DS_LENGTH(ds) == ADD_REMOVE_COUNT - removed);
+
+	// Every freed slot should be reused before new ones are created.
+	for (uint32_t i = 0; i < removed; i++)
+	{
+		int32_t index = ANR_DS_ADD(ds, &i);
+		assert(index >= 0 && index < ADD_REMOVE_COUNT);
+	}
+	assert(ANR_DS_LENGTH(ds) == ADD_REMOVE_COUNT);
+	ANR_DS_FREE(ds);
+}
+
+void test_arena()
+{
+	anr_arena arena = anr_arena_create(4096);
+	anr_allocator allocator = anr_arena_allocator(&arena);
+
+	// Growing the last allocation stays in place.
+	anr_array array = anr_array_create_ex(sizeof(int), 1, ANR_ARRAY_POLICY_DEFAULT, &allocator);
+	for (int i = 0; i < 500; i++) ANR_DS_ADD(&array, &i);
+	for (int i = 0; i < 500; i++) assert(*(int*)ANR_DS_FIND_AT(&array, i) == i);
+	assert(arena.last == array.data);
+	ANR_DS_FREE(&array);
+
+	anr_linked_list list = anr_linked_list_create_ex(sizeof(int), &allocator);
+	anr_hashmap hashmap = anr_hashmap_create_ex(sizeof(int), 64, &allocator);
+	anr_hashtable table = anr_hashtable_create_ex(sizeof(int), sizeof(int), NULL, &allocator);
+	for (int i = 0; i < 1000; i++)
+	{
+		ANR_DS_ADD(&list, &i);
+		ANR_DS_ADD(&hashmap, &i);
+		ANR_DS_ADD(&table, &i);
+	}
+	for (int i = 0; i < 1000; i++)
+	{
+		assert(*(int*)ANR_DS_FIND_AT(&list, i) == i);
+		assert(ANR_DS_FIND_BY(&table, &i) != -1);
+	}
+	assert(ANR_DS_LENGTH(&hashmap) == 1000);
+
+	// Containers dont have to be freed, the arena drops everything at once.
+	anr_arena_reset(&arena);
+	assert(arena.used < 4096);
+	anr_arena_free(&arena);
+}
+
 char* random_hash()
 {
 	char* rr = malloc(HASH_LENGTH+1);
@@ -162,11 +1114,41 @@ void add_remove_test(anr_ds* ds)
 	ANR_DS_FREE(ds);
 }
 
-void rand_test(anr_ds* ds, char* hash)
+// Editor like workload: type a burst of entries at a cursor, sometimes backspace, then jump.
+void clustered_insert_test(anr_ds* ds)
 {
-	for (uint32_t i = 0; i < HASH_LENGTH; i++)
+	uint32_t cursor = 0;
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT; i++)
 	{
-		uint8_t ch = hash[i];
+		if (i % 100 == 0) cursor = rand() % (ANR_DS_LENGTH(ds)+1);
+		if (i % 10 == 9 && cursor > 0) {
+			ANR_DS_REMOVE_AT(ds, --cursor);
+			continue;
+		}
+		ANR_DS_INSERT(ds, cursor++, &i);
+	}
+	ANR_DS_FREE(ds);
+}
+
+// Work queue: push at the back, pop from the front.
+void fifo_test(anr_ds* ds)
+{
+	uint32_t next = 0;
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT; i++)
+	{
+		ANR_DS_ADD(ds, &i);
+		if (i % 3 == 2) continue;
+		assert(*(uint32_t*)ANR_DS_FIND_AT(ds, 0) == next++);
+		ANR_DS_REMOVE_AT(ds, 0);
+	}
+	ANR_DS_FREE(ds);
+}
+
+void rand_test(anr_ds* ds, char* hash, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint8_t ch = hash[i % HASH_LENGTH];
 		int rand_index = (rand() % (ANR_DS_LENGTH(ds)+1))-1;
 		if (rand_index < 0) rand_index = 0;
 		if (ch >= 0 && ch <= 5) ANR_DS_ADD(ds, rand_int());
@@ -192,13 +1174,69 @@ int main(int argc, char** argvv)
 	anr_hashmap hashmap = ANR_DS_HASHMAP(sizeof(int), 20);
 	test_ds((anr_ds*)&hashmap);
 
+	anr_unrolled_list unrolled = ANR_DS_UNROLLED_LIST(sizeof(int));
+	test_ds((anr_ds*)&unrolled);
+
+	anr_sequence sequence = ANR_DS_SEQUENCE(sizeof(int));
+	test_ds((anr_ds*)&sequence);
+
+	anr_gap_buffer gap_buffer = ANR_DS_GAP_BUFFER(sizeof(int), 1);
+	test_ds((anr_ds*)&gap_buffer);
+
+	anr_deque deque = ANR_DS_DEQUE(sizeof(int), 1);
+	test_ds((anr_ds*)&deque);
+
+	anr_mpmc_queue mpmc_queue = ANR_DS_MPMC_QUEUE(sizeof(int), 16);
+	test_ds((anr_ds*)&mpmc_queue);
+
+	test_mpmc_queue();
+	test_hashtable();
+	test_concurrent_hashtable();
+	test_array_policy();
+	test_arena();
+	test_typed();
+	test_small_array();
+	test_find_by();
+	test_sorted_array();
+	test_sort();
+	test_snapshot();
+	test_bloom();
+	test_slot_map();
+	test_intrusive_list();
+	test_file_array();
+	anr_unrolled_list model_unrolled = anr_unrolled_list_create_ex(sizeof(int), 4, NULL);
+	model_test((anr_ds*)&model_unrolled);
+	anr_sequence model_sequence = anr_sequence_create_ex(sizeof(int), 4, NULL);
+	model_test((anr_ds*)&model_sequence);
+	anr_gap_buffer model_gap_buffer = ANR_DS_GAP_BUFFER(sizeof(int), 1);
+	model_test((anr_ds*)&model_gap_buffer);
+	anr_deque model_deque = ANR_DS_DEQUE(sizeof(int), 1);
+	model_test((anr_ds*)&model_deque);
+	anr_mpmc_queue model_mpmc_queue = ANR_DS_MPMC_QUEUE(sizeof(int), 1 << 14);
+	model_test((anr_ds*)&model_mpmc_queue);
+	anr_linked_list range_list = ANR_DS_LINKED_LIST(sizeof(int));
+	range_test((anr_ds*)&range_list);
+	anr_array range_array = ANR_DS_ARRAY(sizeof(int), 1);
+	range_test((anr_ds*)&range_array);
+	anr_unrolled_list range_unrolled = anr_unrolled_list_create_ex(sizeof(int), 4, NULL);
+	range_test((anr_ds*)&range_unrolled);
+	anr_sequence range_sequence = anr_sequence_create_ex(sizeof(int), 4, NULL);
+	range_test((anr_ds*)&range_sequence);
+	anr_gap_buffer range_gap_buffer = ANR_DS_GAP_BUFFER(sizeof(int), 1);
+	range_test((anr_ds*)&range_gap_buffer);
+	anr_deque range_deque = ANR_DS_DEQUE(sizeof(int), 1);
+	range_test((anr_ds*)&range_deque);
+	test_hashmap_range();
+	test_hashmap_free_buckets();
+	anr_hashtable hashtable;
+
 	char* rand = random_hash();
 	clock_t t = clock();
 
 	for (int i = 0; i < TEST_LOOP; i++)
 	{
 		list = ANR_DS_LINKED_LIST(sizeof(int));
-		rand_test((anr_ds*)&list, rand);
+		rand_test((anr_ds*)&list, rand, HASH_LENGTH);
 	}
 	printf("linked list fuzzing 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
 
@@ -207,7 +1245,7 @@ int main(int argc, char** argvv)
 	{
 		char* rand = random_hash();
 		array = ANR_DS_ARRAY(sizeof(int), 5);
-		rand_test((anr_ds*)&array, rand);
+		rand_test((anr_ds*)&array, rand, HASH_LENGTH);
 	}
 	printf("array fuzzing 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
 
@@ -216,9 +1254,68 @@ int main(int argc, char** argvv)
 	{
 		char* rand = random_hash();
 		hashmap = ANR_DS_HASHMAP(sizeof(int), 20);
-		rand_test((anr_ds*)&hashmap, rand);
+		rand_test((anr_ds*)&hashmap, rand, HASH_LENGTH);
 	}
 	printf("hashmap fuzzing 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	for (int i = 0; i < TEST_LOOP; i++)
+	{
+		char* rand = random_hash();
+		hashtable = ANR_DS_HASHTABLE(sizeof(int), sizeof(int), NULL);
+		rand_test((anr_ds*)&hashtable, rand, HASH_LENGTH);
+		free(rand);
+	}
+	printf("hashtable fuzzing 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	for (int i = 0; i < TEST_LOOP; i++)
+	{
+		char* rand = random_hash();
+		unrolled = ANR_DS_UNROLLED_LIST(sizeof(int));
+		rand_test((anr_ds*)&unrolled, rand, HASH_LENGTH);
+		free(rand);
+	}
+	printf("unrolled list fuzzing 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	for (int i = 0; i < TEST_LOOP; i++)
+	{
+		char* rand = random_hash();
+		sequence = ANR_DS_SEQUENCE(sizeof(int));
+		rand_test((anr_ds*)&sequence, rand, HASH_LENGTH);
+		free(rand);
+	}
+	printf("sequence fuzzing 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	for (int i = 0; i < TEST_LOOP; i++)
+	{
+		char* rand = random_hash();
+		gap_buffer = ANR_DS_GAP_BUFFER(sizeof(int), 1);
+		rand_test((anr_ds*)&gap_buffer, rand, HASH_LENGTH);
+		free(rand);
+	}
+	printf("gap buffer fuzzing 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	for (int i = 0; i < TEST_LOOP; i++)
+	{
+		char* rand = random_hash();
+		deque = ANR_DS_DEQUE(sizeof(int), 1);
+		rand_test((anr_ds*)&deque, rand, HASH_LENGTH);
+		free(rand);
+	}
+	printf("deque fuzzing 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	{
+		char* rand = random_hash();
+		sequence = ANR_DS_SEQUENCE(sizeof(int));
+		rand_test((anr_ds*)&sequence, rand, SCALE_COUNT);
+		free(rand);
+	}
+	printf("sequence fuzzing (%dM) 		%.3fs\n", SCALE_COUNT/1000000, ((double)(clock() - t))/CLOCKS_PER_SEC); 
 	free(rand);
 
 	t = clock();
@@ -226,17 +1323,342 @@ int main(int argc, char** argvv)
 	add_remove_test((anr_ds*)&list);
 	printf("linkedlist addremove 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
 
+	// Move every entry from the front to the back, the linked list copies and reallocates, the intrusive list relinks.
+	t = clock();
+	list = ANR_DS_LINKED_LIST(sizeof(int));
+	for (int i = 0; i < ADD_REMOVE_COUNT; i++) ANR_DS_ADD(&list, &i);
+	for (int i = 0; i < ADD_REMOVE_COUNT*10; i++)
+	{
+		ANR_DS_ADD(&list, ANR_DS_FIND_AT(&list, 0));
+		ANR_DS_REMOVE_AT(&list, 0);
+	}
+	ANR_DS_FREE(&list);
+	printf("linkedlist rotate 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	list_item* rotate_items = malloc(ADD_REMOVE_COUNT*sizeof(list_item));
+	anr_list rotate = anr_list_create();
+	for (int i = 0; i < ADD_REMOVE_COUNT; i++) anr_list_push_back(&rotate, &rotate_items[i].all);
+	for (int i = 0; i < ADD_REMOVE_COUNT*10; i++) anr_list_push_back(&rotate, anr_list_pop_front(&rotate));
+	free(rotate_items);
+	printf("linkedlist rotate (intrusive) 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	unrolled = ANR_DS_UNROLLED_LIST(sizeof(int));
+	add_remove_test((anr_ds*)&unrolled);
+	printf("unrolled list addremove 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	sequence = ANR_DS_SEQUENCE(sizeof(int));
+	add_remove_test((anr_ds*)&sequence);
+	printf("sequence addremove 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
 	t = clock();
 	array = ANR_DS_ARRAY(sizeof(int), ADD_REMOVE_COUNT);
 	add_remove_test((anr_ds*)&array);
 	printf("array addremove 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
 
+	t = clock();
+	array = ANR_DS_ARRAY(sizeof(int), 1);
+	clustered_insert_test((anr_ds*)&array);
+	printf("array clustered insert 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	gap_buffer = ANR_DS_GAP_BUFFER(sizeof(int), 1);
+	clustered_insert_test((anr_ds*)&gap_buffer);
+	printf("gap buffer clustered insert 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	gap_buffer = ANR_DS_GAP_BUFFER(sizeof(int), 1);
+	add_remove_test((anr_ds*)&gap_buffer);
+	printf("gap buffer addremove 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	array = ANR_DS_ARRAY(sizeof(int), 1);
+	fifo_test((anr_ds*)&array);
+	printf("array fifo 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	deque = ANR_DS_DEQUE(sizeof(int), 1);
+	fifo_test((anr_ds*)&deque);
+	printf("deque fifo 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	deque = ANR_DS_DEQUE(sizeof(int), ADD_REMOVE_COUNT);
+	add_remove_test((anr_ds*)&deque);
+	printf("deque addremove 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	array = ANR_DS_ARRAY(sizeof(int), 1);
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT*10; i++) ANR_DS_ADD(&array, &i);
+	ANR_DS_FREE(&array);
+	printf("array append 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	// Many short lived arrays with 1 to 8 entries.
+	for (uint8_t small_array = 0; small_array < 2; small_array++)
+	{
+		alloc_counter counter = {0};
+		anr_allocator counting = {counting_alloc, uncounted_realloc, counting_free, &counter};
+		t = clock();
+		for (uint32_t i = 0; i < ADD_REMOVE_COUNT*10; i++)
+		{
+			smallints small;
+			anr_array heap;
+			anr_array* arr = &heap;
+			if (small_array) {
+				anr_array_init_small(&small.arr, &small.small, sizeof(int), small.storage, 8, &counting);
+				arr = &small.arr;
+			}
+			else {
+				heap = anr_array_create_ex(sizeof(int), 1, ANR_ARRAY_POLICY_DEFAULT, &counting);
+			}
+			for (uint32_t j = 0; j <= i % 8; j++) intarr_add(arr, (int)j);
+			ANR_DS_FREE(arr);
+		}
+		printf(small_array ? "array short lived (small) 	%.3fs %u allocs\n" : "array short lived 		%.3fs %u allocs\n", 
+			((double)(clock() - t))/CLOCKS_PER_SEC, counter.allocs); 
+	}
+
+	t = clock();
+	remove("bin/bench_file_array.anr");
+	array = anr_array_create_file("bin/bench_file_array.anr", sizeof(int), 1, ANR_ACCESS_SEQUENTIAL);
+	for (uint32_t i = 0; i < ADD_REMOVE_COUNT*10; i++) ANR_DS_ADD(&array, &i);
+	ANR_DS_FREE(&array);
+	remove("bin/bench_file_array.anr");
+	printf("array append (file backed) 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	// Batches of 64 at scattered positions, one insert per entry against one insert_range per batch.
+	{
+		uint32_t batch[64];
+		for (uint32_t i = 0; i < 64; i++) batch[i] = i;
+		t = clock();
+		array = ANR_DS_ARRAY(sizeof(int), 1);
+		for (uint32_t i = 0; i < ADD_REMOVE_COUNT/4; i += 64) {
+			uint32_t index = (i*7919) % (array.length+1);
+			for (uint32_t x = 0; x < 64; x++) ANR_DS_INSERT(&array, index+x, &batch[x]);
+		}
+		printf("array insert batch (single) 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+		t = clock();
+		int divisor = 3;
+		for (int32_t i = array.length-1; i >= 0; i--) {
+			if (is_multiple(ANR_DS_FIND_AT(&array, i), &divisor)) ANR_DS_REMOVE_AT(&array, i);
+		}
+		printf("array remove matches (single) 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+		uint32_t length = array.length;
+		ANR_DS_FREE(&array);
+
+		t = clock();
+		array = ANR_DS_ARRAY(sizeof(int), 1);
+		for (uint32_t i = 0; i < ADD_REMOVE_COUNT/4; i += 64) {
+			anr_array_insert_range(&array, (i*7919) % (array.length+1), batch, 64);
+		}
+		printf("array insert batch (range) 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+		t = clock();
+		anr_array_remove_if(&array, is_multiple, &divisor);
+		printf("array remove matches (remove_if) %.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+		assert(array.length == length);
+		ANR_DS_FREE(&array);
+	}
+
+	// Same loop through the table, the direct call and the typed functions.
+	int64_t sum = 0;
+	array = intarr_create(1);
+	for (int i = 0; i < ADD_REMOVE_COUNT*10; i++) intarr_add(&array, i);
+	t = clock();
+	ANR_ITERATE(table_iter, (anr_ds*)&array) sum += *(int*)table_iter.data;
+	printf("array iterate (table) 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	ANR_ITERATE(direct_iter, &array) sum += *(int*)direct_iter.data;
+	printf("array iterate (direct) 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	ANR_DS_FOREACH(int, it, &array) sum += *it;
+	printf("array iterate (typed) 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+	assert(sum == 3*((int64_t)ADD_REMOVE_COUNT*10*(ADD_REMOVE_COUNT*10-1)/2));
+	intarr_free(&array);
+
 	t = clock();
 	hashmap = ANR_DS_HASHMAP(sizeof(int), ADD_REMOVE_COUNT);
 	add_remove_test((anr_ds*)&hashmap);
 
 	printf("hashmap addremove 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
 
+	t = clock();
+	hashmap = ANR_DS_HASHMAP(sizeof(int), 20);
+	refill_test((anr_ds*)&hashmap);
+	printf("hashmap refill 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	hashmap = ANR_DS_HASHMAP(sizeof(int), 20);
+	iterate_test((anr_ds*)&hashmap);
+	printf("hashmap iterate 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	hashmap = ANR_DS_HASHMAP(sizeof(kv), 20);
+	lookup_test((anr_ds*)&hashmap);
+	printf("hashmap lookup 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	array = ANR_DS_ARRAY(sizeof(int), 1);
+	for (int i = 0; i < ADD_REMOVE_COUNT; i++) ANR_DS_ADD(&array, &i);
+	for (int i = 0; i < 1000; i++)
+	{
+		int key = ADD_REMOVE_COUNT - 1 - i;
+		assert(ANR_DS_FIND_BY(&array, &key) == key);
+	}
+	ANR_DS_FREE(&array);
+	printf("array find_by 			%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	// Mostly misses: every miss scans the whole container unless the filter rules it out.
+	for (uint8_t use_filter = 0; use_filter < 2; use_filter++)
+	{
+		anr_array inner = ANR_DS_ARRAY(sizeof(int), ADD_REMOVE_COUNT/4);
+		for (int i = 0; i < ADD_REMOVE_COUNT/4; i++) ANR_DS_ADD(&inner, &i);
+		anr_filtered filtered = ANR_DS_FILTERED(&inner, sizeof(int), ADD_REMOVE_COUNT/4, 0.01);
+		anr_ds* ds = use_filter ? (anr_ds*)&filtered : (anr_ds*)&inner;
+		t = clock();
+		uint32_t hits = 0;
+		for (int i = 0; i < LOOKUP_COUNT; i++)
+		{
+			int key = i % 100 == 0 ? i % (ADD_REMOVE_COUNT/4) : ADD_REMOVE_COUNT + i;
+			hits += ANR_DS_FIND_BY(ds, &key) != -1;
+		}
+		assert(hits == LOOKUP_COUNT/100);
+		printf(use_filter ? "array find_by misses (filter) 	%.3fs\n" : "array find_by misses 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+		ANR_DS_FREE(&filtered);
+	}
+
+	// Lookups by id after churn: hashmap index vs slot map handle.
+	for (uint8_t use_slot_map = 0; use_slot_map < 2; use_slot_map++)
+	{
+		anr_hashmap ids_map = ANR_DS_HASHMAP(sizeof(int), ADD_REMOVE_COUNT);
+		anr_slot_map slot_map = anr_slot_map_create(sizeof(int), ADD_REMOVE_COUNT);
+		uint64_t* ids = malloc(ADD_REMOVE_COUNT*sizeof(uint64_t));
+		t = clock();
+		for (int i = 0; i < ADD_REMOVE_COUNT; i++) ids[i] = use_slot_map ? anr_slot_map_put(&slot_map, &i) : (uint64_t)ANR_DS_ADD(&ids_map, &i);
+		for (int i = 0; i < ADD_REMOVE_COUNT; i += 3)
+		{
+			if (use_slot_map) anr_slot_map_erase(&slot_map, ids[i]);
+			else ANR_DS_REMOVE_AT(&ids_map, (uint32_t)ids[i]);
+			ids[i] = use_slot_map ? anr_slot_map_put(&slot_map, &i) : (uint64_t)ANR_DS_ADD(&ids_map, &i);
+		}
+		uint64_t sum = 0;
+		for (int i = 0; i < ADD_REMOVE_COUNT*10; i++)
+		{
+			uint64_t id = ids[(i * 7919u) % ADD_REMOVE_COUNT];
+			sum += *(int*)(use_slot_map ? anr_slot_map_get(&slot_map, id) : ANR_DS_FIND_AT(&ids_map, (uint32_t)id));
+		}
+		assert(sum > 0);
+		printf(use_slot_map ? "id lookup (slot map) 		%.3fs\n" : "id lookup (hashmap) 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+		free(ids);
+		ANR_DS_FREE(&ids_map);
+		ANR_DS_FREE(&slot_map);
+	}
+
+	// Sorted table built with one merge, then random lookups. Built without optimisation, as the Makefile 
+	// does, plain binary search wins at both sizes. The eytzinger copy only wins at -O2 with tables far 
+	// past the last level cache, 1.6-2x faster with 10M and 64M ints.
+	int sorted_counts[] = {SORTED_COUNT, SCALE_COUNT};
+	int sorted_max = SORTED_COUNT > SCALE_COUNT ? SORTED_COUNT : SCALE_COUNT;
+	int* sorted_ids = malloc(sorted_max*sizeof(int));
+	for (int i = 0; i < sorted_max; i++) sorted_ids[i] = i*3;
+	for (int c = 0; c < 2; c++)
+	{
+		for (uint8_t eytzinger = 0; eytzinger < 2; eytzinger++)
+		{
+			anr_sorted_array sarr = anr_sorted_array_create_ex(sizeof(int), 1, compare_int, eytzinger, NULL);
+			anr_sorted_array_merge_sorted(&sarr, sorted_ids, sorted_counts[c]);
+			for (int i = 0; i <= sorted_counts[c] / 16; i++) ANR_DS_FIND_BY(&sarr, &sorted_ids[0]); // Enough lookups to build the eytzinger copy.
+			t = clock();
+			for (int i = 0; i < SORTED_COUNT; i++)
+			{
+				int key = (int)(((uint64_t)i*7919) % sorted_counts[c])*3;
+				assert((int)ANR_DS_FIND_BY(&sarr, &key) == key/3);
+			}
+			printf(eytzinger ? "sorted array lookup (eytz, %dK) 	%.3fs\n" : "sorted array lookup (%dK) 	%.3fs\n", sorted_counts[c]/1000, ((double)(clock() - t))/CLOCKS_PER_SEC); 
+			ANR_DS_FREE(&sarr);
+		}
+	}
+	free(sorted_ids);
+
+	// 16 byte records, sorted on a 32 bit key.
+	anr_array records = ANR_DS_ARRAY(sizeof(record), SORTED_COUNT);
+	for (uint32_t i = 0; i < SORTED_COUNT; i++)
+	{
+		record r = {(int32_t)(((uint64_t)i*2654435761u) % SORTED_COUNT) - SORTED_COUNT/2, i, 0, 0};
+		ANR_DS_ADD(&records, &r);
+	}
+	anr_array records_copy = ANR_DS_ARRAY(sizeof(record), SORTED_COUNT);
+	ANR_DS_ADD_RANGE(&records_copy, records.data, SORTED_COUNT);
+	t = clock();
+	anr_array_sort(&records_copy, compare_record);
+	printf("array sort (qsort) 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+	t = clock();
+	anr_array_sort_by_key(&records, offsetof(record, key), ANR_KEY_I32);
+	printf("array sort_by_key (radix) 	%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+	assert(memcmp(records.data, records_copy.data, (size_t)SORTED_COUNT*sizeof(record)) == 0);
+	ANR_DS_FREE(&records);
+	ANR_DS_FREE(&records_copy);
+
+	// Startup: refill a hashmap from scratch or map a saved copy.
+	t = clock();
+	hashmap = ANR_DS_HASHMAP(sizeof(int), 1024);
+	for (int i = 0; i < SCALE_COUNT; i++) ANR_DS_ADD(&hashmap, &i);
+	printf("hashmap rebuild (%dM) 		%.3fs\n", SCALE_COUNT/1000000, ((double)(clock() - t))/CLOCKS_PER_SEC); 
+	assert(anr_ds_save(&hashmap, "bin/bench_snapshot.anr"));
+	ANR_DS_FREE(&hashmap);
+	t = clock();
+	anr_mapped* mapped = anr_ds_open_mapped("bin/bench_snapshot.anr");
+	assert(mapped && ANR_DS_LENGTH(&mapped->ds.hashmap) == SCALE_COUNT);
+	printf("hashmap open mapped (%dM) 	%.3fs\n", SCALE_COUNT/1000000, ((double)(clock() - t))/CLOCKS_PER_SEC); 
+	assert(*(int*)ANR_DS_FIND_AT(&mapped->ds.hashmap, SCALE_COUNT/2) == SCALE_COUNT/2);
+	anr_ds_close_mapped(mapped);
+	remove("bin/bench_snapshot.anr");
+
+	t = clock();
+	hashtable = ANR_DS_HASHTABLE(sizeof(kv), sizeof(int), NULL);
+	lookup_test((anr_ds*)&hashtable);
+	printf("hashtable lookup 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	// Many short lived containers, libc vs arena.
+	t = clock();
+	for (int r = 0; r < 2000; r++)
+	{
+		list = ANR_DS_LINKED_LIST(sizeof(int));
+		array = ANR_DS_ARRAY(sizeof(int), 1);
+		hashmap = ANR_DS_HASHMAP(sizeof(int), 20);
+		for (int i = 0; i < 100; i++) {
+			ANR_DS_ADD(&list, &i);
+			ANR_DS_ADD(&array, &i);
+			ANR_DS_ADD(&hashmap, &i);
+		}
+		ANR_DS_FREE(&list);
+		ANR_DS_FREE(&array);
+		ANR_DS_FREE(&hashmap);
+	}
+	printf("short lived (libc) 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
+	t = clock();
+	anr_arena arena = anr_arena_create(1 << 16);
+	anr_allocator allocator = anr_arena_allocator(&arena);
+	for (int r = 0; r < 2000; r++)
+	{
+		list = anr_linked_list_create_ex(sizeof(int), &allocator);
+		array = anr_array_create_ex(sizeof(int), 1, ANR_ARRAY_POLICY_DEFAULT, &allocator);
+		hashmap = anr_hashmap_create_ex(sizeof(int), 20, &allocator);
+		for (int i = 0; i < 100; i++) {
+			ANR_DS_ADD(&list, &i);
+			ANR_DS_ADD(&array, &i);
+			ANR_DS_ADD(&hashmap, &i);
+		}
+		anr_arena_reset(&arena);
+	}
+	anr_arena_free(&arena);
+	printf("short lived (arena) 		%.3fs\n", ((double)(clock() - t))/CLOCKS_PER_SEC); 
+
 	return 0;
 }
 
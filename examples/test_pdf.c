@@ -234,9 +234,62 @@ static anr_pdf_page create_page_3(anr_pdf* pdf)
 	return pageref;
 }
 
+// Counts blocks handed out by alloc and calls to free, a realloc only resizes a block and is not counted.
+// Allocs fail once budget blocks were handed out, reallocs fail while fail_realloc is set.
+typedef struct
+{
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t budget;
+	char fail_realloc;
+} alloc_counter;
+
+static void* counting_alloc(void* ctx, size_t size)
+{
+	alloc_counter* counter = ctx;
+	if (counter->allocs == counter->budget) return NULL;
+	counter->allocs++;
+	return malloc(size);
+}
+static void* failing_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) { (void)old_size; return ((alloc_counter*)ctx)->fail_realloc ? NULL : realloc(ptr, new_size); }
+static void counting_free(void* ctx, void* ptr) { ((alloc_counter*)ctx)->frees++; free(ptr); }
+
+static void test_allocator()
+{
+	alloc_counter counter = {0, 0, UINT32_MAX, 0};
+	anr_allocator allocator = {counting_alloc, failing_realloc, counting_free, &counter};
+	anr_pdf* pdf = anr_pdf_document_begin_ex(&allocator);
+	anr_pdf_page_begin(pdf, ANR_PDF_PAGE_SIZE_A4);
+	anr_pdf_add_text(pdf, "Allocated with a custom allocator", 50, 700, anr_pdf_txt_conf_default(pdf));
+	anr_pdf_page_end(pdf);
+	anr_pdf_document_end(pdf);
+	assert(anr_pdf_write_to_file(pdf, "bin/test_pdf_allocator.pdf"));
+	anr_pdf_document_free(pdf);
+	assert(counter.allocs == 3 && counter.frees == 3);
+
+	// Running out of memory in begin releases what was allocated.
+	counter = (alloc_counter){0, 0, 2, 0};
+	assert(anr_pdf_document_begin_ex(&allocator) == NULL);
+	assert(counter.frees == counter.allocs);
+
+	// A body that cannot grow drops the writes and the document is not written.
+	counter = (alloc_counter){0, 0, UINT32_MAX, 1};
+	pdf = anr_pdf_document_begin_ex(&allocator);
+	uint32_t size = (ANR_PDF_BUFFER_RESERVE / 3) + 1;
+	unsigned char* pixels = calloc((size_t)size * 3, 1);
+	anr_pdf_embed_image(pdf, pixels, size*3, size, 1, 8);
+	assert(pdf->out_of_memory);
+	free(pixels);
+	anr_pdf_document_end(pdf);
+	assert(!anr_pdf_write_to_file(pdf, "bin/test_pdf_oom.pdf"));
+	anr_pdf_document_free(pdf);
+	assert(counter.frees == counter.allocs);
+}
 
 int main()
 {
+	test_allocator();
+
 	anr_pdf* pdf = anr_pdf_document_begin();
 	anr_pdf_document_add_information_dictionary(pdf, 
 		"Simple text document", "Aldrik", "Cool Banana's", 
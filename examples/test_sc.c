@@ -74,6 +74,53 @@ void test_file(char* str)
 	free(iso_buffer);
 }
 
+// Counts blocks handed out by alloc and calls to free, a realloc only resizes a block and is not counted.
+// Allocs fail once budget blocks were handed out.
+typedef struct
+{
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t budget;
+} alloc_counter;
+
+static void* counting_alloc(void* ctx, size_t size)
+{
+	alloc_counter* counter = ctx;
+	if (counter->allocs == counter->budget) return NULL;
+	counter->allocs++;
+	return malloc(size);
+}
+static void* uncounted_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) { (void)ctx; (void)old_size; return realloc(ptr, new_size); }
+static void counting_free(void* ctx, void* ptr) { ((alloc_counter*)ctx)->frees++; free(ptr); }
+
+void test_allocator(char* str)
+{
+	FILE* file = fopen(str, "rb");
+	fseek(file, 0, SEEK_END);
+	int size = ftell(file);
+	rewind(file);
+	unsigned char* buffer = malloc(size);
+	fread(buffer, 1, size, file);
+	fclose(file);
+
+	alloc_counter counter = {0, 0, UINT32_MAX};
+	anr_allocator allocator = {counting_alloc, uncounted_realloc, counting_free, &counter};
+	uint32_t out;
+	uint8_t* compressed_data = anr_sc_deflate_ex(buffer, size, &out, &allocator);
+	uint8_t* decompressed_data = anr_sc_inflate_ex(compressed_data, out, &out, &allocator);
+	assert(out == size);
+	assert(memcmp(buffer, decompressed_data, out) == 0);
+	assert(counter.allocs == 2);
+	allocator.free(allocator.ctx, compressed_data);
+	allocator.free(allocator.ctx, decompressed_data);
+	assert(counter.frees == 2);
+
+	counter.budget = counter.allocs;
+	assert(anr_sc_deflate_ex(buffer, size, &out, &allocator) == NULL);
+	assert(anr_sc_inflate_ex(buffer, size, &out, &allocator) == NULL);
+	free(buffer);
+}
+
 int main(int argc, char** argv)
 { 
 	//test_small();
@@ -82,6 +129,7 @@ int main(int argc, char** argv)
 	test_file("res/cid2code.txt");
 	test_file("res/small.txt");
 	test_file("res/test.txt");
+	test_allocator("res/small.txt");
 
 	#if 0
 	test_file("test_data.c");
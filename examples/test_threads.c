@@ -0,0 +1,411 @@
+#define ANR_DATA_IMPLEMENTATION
+#define ANR_DATA_THREADS
+#define ANR_DATA_MMAP
+#include "../anr_data.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define OP_COUNT 2000000
+#define QUEUE_CAPACITY 1024
+
+// Producers push disjoint ranges of values, consumers pop until all values are taken.
+// The sum of popped values checks that nothing was lost or handed out twice.
+typedef struct
+{
+	anr_mpmc_queue* queue;
+	anr_deque* deque; // Baseline: a deque behind a mutex.
+	pthread_mutex_t* lock;
+	uint32_t first;
+	uint32_t count;
+	uint64_t sum;
+} worker;
+
+static void push_mpmc(worker* w, uint32_t value)
+{
+	while (!anr_mpmc_queue_try_push(w->queue, &value)) sched_yield();
+}
+
+static uint8_t pop_mpmc(worker* w, uint32_t* value)
+{
+	return anr_mpmc_queue_try_pop(w->queue, value);
+}
+
+static void push_locked(worker* w, uint32_t value)
+{
+	for (;;)
+	{
+		pthread_mutex_lock(w->lock);
+		uint8_t added = w->deque->length < QUEUE_CAPACITY && ANR_DS_ADD(w->deque, &value) != -1;
+		pthread_mutex_unlock(w->lock);
+		if (added) return;
+		sched_yield();
+	}
+}
+
+static uint8_t pop_locked(worker* w, uint32_t* value)
+{
+	pthread_mutex_lock(w->lock);
+	uint8_t popped = w->deque->length > 0;
+	if (popped) {
+		*value = *(uint32_t*)ANR_DS_FIND_AT(w->deque, 0);
+		ANR_DS_REMOVE_AT(w->deque, 0);
+	}
+	pthread_mutex_unlock(w->lock);
+	return popped;
+}
+
+static void* producer(void* arg)
+{
+	worker* w = arg;
+	for (uint32_t i = 0; i < w->count; i++) w->lock ? push_locked(w, w->first + i) : push_mpmc(w, w->first + i);
+	return NULL;
+}
+
+static void* consumer(void* arg)
+{
+	worker* w = arg;
+	uint32_t value;
+	for (uint32_t i = 0; i < w->count;)
+	{
+		if (w->lock ? pop_locked(w, &value) : pop_mpmc(w, &value)) {
+			w->sum += value;
+			i++;
+		}
+		else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static double now()
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Returns transfers per second, every value is pushed and popped once.
+static double run(uint32_t producers, uint32_t consumers, uint8_t locked)
+{
+	anr_mpmc_queue queue = ANR_DS_MPMC_QUEUE(sizeof(uint32_t), QUEUE_CAPACITY);
+	anr_deque deque = ANR_DS_DEQUE(sizeof(uint32_t), QUEUE_CAPACITY);
+	pthread_mutex_t lock;
+	pthread_mutex_init(&lock, NULL);
+
+	pthread_t threads[64];
+	worker workers[64];
+	uint32_t thread_count = producers + consumers;
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		uint8_t is_producer = i < producers;
+		uint32_t n = is_producer ? producers : consumers;
+		uint32_t nr = is_producer ? i : i - producers;
+		uint32_t first = (uint32_t)((uint64_t)OP_COUNT * nr / n);
+		workers[i] = (worker){&queue, &deque, locked ? &lock : NULL, first, (uint32_t)((uint64_t)OP_COUNT * (nr+1) / n) - first, 0};
+	}
+
+	double start = now();
+	for (uint32_t i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, i < producers ? producer : consumer, &workers[i]);
+	uint64_t sum = 0;
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		pthread_join(threads[i], NULL);
+		sum += workers[i].sum;
+	}
+	double seconds = now() - start;
+
+	assert(sum == (uint64_t)OP_COUNT * (OP_COUNT-1) / 2);
+	assert(ANR_DS_LENGTH(&queue) == 0);
+	ANR_DS_FREE(&queue);
+	ANR_DS_FREE(&deque);
+	pthread_mutex_destroy(&lock);
+	return OP_COUNT / seconds;
+}
+
+#define KEY_COUNT 100000
+#define MIX_OPS 1000000 // Per thread, so perfect scaling multiplies ops/s by the thread count.
+
+typedef struct
+{
+	uint32_t key;
+	uint32_t value;
+} kv;
+
+// Read heavy mix: 95% get, 5% put. Puts go to twice the preloaded key range so shards grow while readers run.
+typedef struct
+{
+	anr_concurrent_hashtable* table;
+	anr_hashtable* locked_table; // Baseline: one table behind a rwlock.
+	pthread_rwlock_t* lock;
+	uint64_t seed;
+	uint32_t found;
+} mix_worker;
+
+static uint64_t next_rand(uint64_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static void* mix(void* arg)
+{
+	mix_worker* w = arg;
+	for (uint32_t i = 0; i < MIX_OPS; i++)
+	{
+		uint64_t r = next_rand(&w->seed);
+		kv entry = {(uint32_t)(r >> 32) % (KEY_COUNT*2), 0};
+		if (r % 100 < 5) {
+			entry.value = entry.key*3;
+			if (w->lock) {
+				pthread_rwlock_wrlock(w->lock);
+				ANR_DS_ADD(w->locked_table, &entry);
+				pthread_rwlock_unlock(w->lock);
+			}
+			else {
+				anr_concurrent_hashtable_put(w->table, &entry);
+			}
+			continue;
+		}
+
+		uint8_t found;
+		if (w->lock) {
+			pthread_rwlock_rdlock(w->lock);
+			uint32_t index = ANR_DS_FIND_BY(w->locked_table, &entry.key);
+			found = index != -1;
+			if (found) entry = *(kv*)ANR_DS_FIND_AT(w->locked_table, index);
+			pthread_rwlock_unlock(w->lock);
+		}
+		else {
+			found = anr_concurrent_hashtable_get(w->table, &entry.key, &entry);
+		}
+		if (found) {
+			assert(entry.value == entry.key*3);
+			w->found++;
+		}
+	}
+	return NULL;
+}
+
+static double run_mix(uint32_t thread_count, uint8_t locked)
+{
+	anr_concurrent_hashtable table = ANR_DS_CONCURRENT_HASHTABLE(sizeof(kv), sizeof(uint32_t), NULL);
+	anr_hashtable locked_table = ANR_DS_HASHTABLE(sizeof(kv), sizeof(uint32_t), NULL);
+	pthread_rwlock_t lock;
+	pthread_rwlock_init(&lock, NULL);
+	for (uint32_t i = 0; i < KEY_COUNT; i++)
+	{
+		kv entry = {i, i*3};
+		locked ? ANR_DS_ADD(&locked_table, &entry) : ANR_DS_ADD(&table, &entry);
+	}
+
+	pthread_t threads[64];
+	mix_worker workers[64];
+	for (uint32_t i = 0; i < thread_count; i++) workers[i] = (mix_worker){&table, &locked_table, locked ? &lock : NULL, 0x9E3779B97F4A7C15ULL * (i+1), 0};
+
+	double start = now();
+	for (uint32_t i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, mix, &workers[i]);
+	for (uint32_t i = 0; i < thread_count; i++) pthread_join(threads[i], NULL);
+	double seconds = now() - start;
+
+	ANR_DS_FREE(&table);
+	ANR_DS_FREE(&locked_table);
+	pthread_rwlock_destroy(&lock);
+	return (double)MIX_OPS * thread_count / seconds;
+}
+
+#define PARALLEL_COUNT 200000
+#define TRANSFORM_COUNT 2000000
+
+static void mark(void* data, uint32_t index, void* ctx)
+{
+	uint8_t* seen = ctx;
+	seen[*(uint32_t*)data]++; // Every value is visited by exactly one thread.
+}
+
+static void sum_reduce(void* acc, void* data, uint32_t index, void* ctx)
+{
+	*(uint64_t*)acc += *(uint32_t*)data;
+}
+
+static void sum_combine(void* acc, const void* other, void* ctx)
+{
+	*(uint64_t*)acc += *(const uint64_t*)other;
+}
+
+static void check_parallel(void* ds, uint32_t count, uint32_t thread_count)
+{
+	uint8_t* seen = calloc(count, 1);
+	anr_ds_parallel_for(ds, mark, seen, thread_count);
+	for (uint32_t i = 0; i < count; i++) assert(seen[i] == 1);
+	free(seen);
+
+	uint64_t sum = 0;
+	anr_ds_parallel_reduce(ds, sum_reduce, sum_combine, NULL, &sum, sizeof(sum), thread_count);
+	assert(sum == (uint64_t)count*(count-1)/2);
+}
+
+static void test_parallel(uint32_t thread_count)
+{
+	anr_array array = ANR_DS_ARRAY(sizeof(uint32_t), 64);
+	anr_hashmap hashmap = ANR_DS_HASHMAP(sizeof(uint32_t), 64);
+	anr_linked_list list = ANR_DS_LINKED_LIST(sizeof(uint32_t));
+	anr_sequence sequence = ANR_DS_SEQUENCE(sizeof(uint32_t));
+	for (uint32_t i = 0; i < PARALLEL_COUNT; i++)
+	{
+		ANR_DS_ADD(&array, &i);
+		ANR_DS_ADD(&hashmap, &i);
+		ANR_DS_ADD(&list, &i);
+		ANR_DS_ADD(&sequence, &i);
+	}
+	check_parallel(&array, PARALLEL_COUNT, thread_count);
+	check_parallel(&hashmap, PARALLEL_COUNT, thread_count);
+	check_parallel(&list, PARALLEL_COUNT, thread_count);
+	check_parallel(&sequence, PARALLEL_COUNT, thread_count);
+
+	ANR_DS_FREE(&array);
+	ANR_DS_FREE(&hashmap);
+	ANR_DS_FREE(&list);
+	ANR_DS_FREE(&sequence);
+}
+
+// A few hundred cycles of math per element, enough to hide the cost of splitting the work.
+static void transform(void* data, uint32_t index, void* ctx)
+{
+	float* value = data;
+	float x = *value;
+	for (uint32_t i = 0; i < 32; i++) x = x*0.999f + 1.0f / (1.0f + x*x);
+	*value = x;
+}
+
+static double run_transform(anr_array* array, uint32_t thread_count)
+{
+	double start = now();
+	if (thread_count == 0) {
+		ANR_ITERATE(iter, array) { transform(iter.data, iter.index, NULL); }
+	}
+	else {
+		anr_ds_parallel_for(array, transform, NULL, thread_count);
+	}
+	return now() - start;
+}
+
+#define SORT_COUNT 4000000
+
+typedef struct
+{
+	uint32_t key;
+	uint32_t id;
+	uint64_t payload;
+} record;
+
+static int compare_record(const void* a, const void* b)
+{
+	const record* x = a;
+	const record* y = b;
+	if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+	return (x->id > y->id) - (x->id < y->id);
+}
+
+static anr_array make_records()
+{
+	anr_array records = ANR_DS_ARRAY(sizeof(record), SORT_COUNT);
+	uint64_t seed = 0x2545F4914F6CDD1DULL;
+	for (uint32_t i = 0; i < SORT_COUNT; i++)
+	{
+		record r = {(uint32_t)(next_rand(&seed) % SORT_COUNT), i, i};
+		ANR_DS_ADD(&records, &r);
+	}
+	return records;
+}
+
+// Returns seconds, thread_count 0 sorts with anr_array_sort.
+static double run_sort(const anr_array* sorted, uint32_t thread_count)
+{
+	anr_array records = make_records();
+	double start = now();
+	if (thread_count == 0) anr_array_sort(&records, compare_record);
+	else assert(anr_array_parallel_sort(&records, compare_record, thread_count));
+	double seconds = now() - start;
+	if (sorted) assert(memcmp(records.data, sorted->data, (size_t)SORT_COUNT*sizeof(record)) == 0);
+	ANR_DS_FREE(&records);
+	return seconds;
+}
+
+// A file backed array sorts in place, the scratch buffer comes from the heap.
+static void test_file_sort(const anr_array* sorted, uint32_t thread_count)
+{
+	const char* path = "bin/test_file_sort.anr";
+	remove(path);
+	anr_array records = make_records();
+	anr_array file = anr_array_create_file(path, sizeof(record), SORT_COUNT, ANR_ACCESS_SEQUENTIAL);
+	assert(file.data && ANR_DS_ADD_RANGE(&file, records.data, SORT_COUNT));
+	assert(anr_array_parallel_sort(&file, compare_record, thread_count));
+	assert(memcmp(file.data, sorted->data, (size_t)SORT_COUNT*sizeof(record)) == 0);
+	ANR_DS_FREE(&file);
+	ANR_DS_FREE(&records);
+	remove(path);
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t max_threads = argc > 1 ? atoi(argv[1]) : 4;
+	if (max_threads < 1) max_threads = 1;
+	if (max_threads > 32) max_threads = 32; // Producers plus consumers have to fit in 64 threads.
+
+	printf("producers consumers 	mpmc queue 	mutex deque\n");
+	for (uint32_t producers = 1; producers <= max_threads; producers *= 2)
+	{
+		for (uint32_t consumers = 1; consumers <= max_threads; consumers *= 2)
+		{
+			double mpmc = run(producers, consumers, 0);
+			double locked = run(producers, consumers, 1);
+			printf("%9d %9d 	%6.2fM ops/s 	%6.2fM ops/s\n", producers, consumers, mpmc / 1e6, locked / 1e6);
+		}
+	}
+
+	printf("\nthreads 	concurrent hashtable 	rwlock hashtable (95%% get, 5%% put)\n");
+	double single = 0;
+	for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		double sharded = run_mix(threads, 0);
+		double locked = run_mix(threads, 1);
+		if (threads == 1) single = sharded;
+		printf("%7d 	%6.2fM ops/s (%4.1fx) 	%6.2fM ops/s\n", threads, sharded / 1e6, sharded / single, locked / 1e6);
+	}
+
+	for (uint32_t threads = 1; threads <= max_threads; threads *= 2) test_parallel(threads);
+
+	anr_array values = ANR_DS_ARRAY(sizeof(float), TRANSFORM_COUNT);
+	for (uint32_t i = 0; i < TRANSFORM_COUNT; i++)
+	{
+		float value = (float)(i % 1000);
+		ANR_DS_ADD(&values, &value);
+	}
+	double serial = run_transform(&values, 0);
+	printf("\nthreads 	parallel for (serial iterate %.3fs)\n", serial);
+	for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		double seconds = run_transform(&values, threads);
+		printf("%7d 	%.3fs (%4.1fx)\n", threads, seconds, serial / seconds);
+	}
+	ANR_DS_FREE(&values);
+
+	anr_array sorted = make_records();
+	assert(anr_array_sort_by_key(&sorted, offsetof(record, key), ANR_KEY_U32));
+	serial = run_sort(&sorted, 0);
+	printf("\nthreads 	parallel sort %dM records (qsort %.3fs)\n", SORT_COUNT/1000000, serial);
+	for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		double seconds = run_sort(&sorted, threads);
+		printf("%7d 	%.3fs (%4.1fx)\n", threads, seconds, serial / seconds);
+	}
+	test_file_sort(&sorted, max_threads);
+	ANR_DS_FREE(&sorted);
+	anr_ds_parallel_shutdown();
+	return 0;
+}